@@ -0,0 +1,810 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "levcan.h"
+#include "levcan_internal.h"
+#include "levcan_objects.h"
+#include "levcan_slab.h"
+#include "levcan_timer.h"
+#include "levcan_trace.h"
+#include "can_hal.h"
+#include "levcan_harness.h"
+
+//Protocol checks on hal/Virtual: wire format and end-to-end results of protocol features. Every check prints
+//one JSON line {"check":"window","ok":1,...}, failed conditions go to stderr. Exit code is number of failed checks.
+//Build with EXTRA=-DLEVCAN_MAX_FRAME=64 for CAN FD.
+//Usage: levcan_check [check name prefix...]
+
+#define CHECK_NODES 2
+#define CHECK_LOG 4096
+#define CHECK_MAX 8192
+#define CHECK_MSG 0x100
+#define CHECK_PUB 0x110
+#define CHECK_COS 0x111
+#define CHECK_REQ 0x118
+#define CHECK_MAP 0x120
+#define CHECK_FIELD 0x130
+#define CHECK_INDEX 0x140
+#define CHECK_TIMERS 64
+//frames logged by driver wrapper, address claim and other system traffic is skipped
+#define CHECK_LOGGED(msgID) ((msgID) >= CHECK_MSG && (msgID) < CHECK_MSG + 0x40)
+#define CHECK_SLAB 32
+#define CHECK_SLAB_SIZE 60
+
+typedef struct {
+	lc_msgBuffered Frame;
+	uint64_t Time;
+} checkFrame_t;
+
+typedef struct {
+	checkFrame_t Frames[CHECK_LOG];
+	uint32_t Count;
+} checkLog_t;
+
+typedef struct {
+	lc_timer_t Timer;
+	uint32_t Fired;
+	uint32_t FiredAt;
+} checkTimer_t;
+
+//PRIVATE FUNCTIONS
+int checkEnabled(const char *name);
+void checkBus(void);
+void checkResult(const char *name, const char *format, ...);
+int checkCondition(int condition, const char *text, int line);
+int checkTraced(LC_NodeDescriptor_t *node, uint32_t since, uint8_t event, int32_t position);
+uint8_t checkValidLength(uint8_t length);
+int checkTransfer(int tcp, uint32_t size);
+void checkReceive(LC_NodeDescriptor_t *node, LC_Header_t header, void *data, int32_t size);
+void checkPublished(LC_NodeDescriptor_t *node, LC_Header_t header, void *data, int32_t size);
+void checkBroadcast(LC_NodeDescriptor_t *node, LC_Header_t header, void *data, int32_t size);
+void checkResponse(LC_NodeDescriptor_t *node, LC_Request_t *request, LC_Return_t status, uint8_t source, void *data, int32_t size);
+void checkTimerFired(void *context, lc_timer_t *timer);
+int doneOnline(void);
+int doneChanged(void);
+int doneTXIdle(void);
+void checkWindow(void);
+void checkAnnounce(void);
+void checkReject(void);
+void checkPublish(void);
+void checkPadding(void);
+void checkMapSend(void);
+void checkChangeOfState(void);
+void checkRequests(void);
+void checkObjectIndex(void);
+void checkTimerWheel(void);
+void checkSlab(void);
+
+//EXTERN FUNCTIONS
+extern uint8_t framePad(void *data, uint8_t length);
+extern uint8_t frameLength(const lc_msgBuffered *msg);
+extern LC_ObjectRecord_t findObjectRecord(LC_NodeDescriptor_t *node, uint16_t messageID, int32_t size, uint8_t read_write, uint8_t nodeID);
+extern void indexPublish(LC_NodeDescriptor_t *node, lc_objIndex_t *index);
+
+//condition is counted and printed with its source line
+#define check(condition) checkCondition((condition) != 0, #condition, __LINE__)
+
+//PRIVATE VARIABLES
+const LC_DriverCalls_t *checkBusDrivers[CHECK_NODES];
+checkLog_t checkLogs[CHECK_NODES];
+char **checkFilter;
+int checkFilterSize;
+int checkFailed; //conditions failed in current check
+int checkFailedTotal; //failed checks
+
+char checkTx[CHECK_MAX];
+char checkRx[CHECK_MAX];
+int32_t rxSize;
+uint32_t pubCount, cosCount, cosWait;
+int16_t pubValue, cosValue, cosReceived, cosSnapshot;
+uint8_t mapU8, mapRxU8;
+uint16_t mapU16, mapRxU16;
+uint32_t mapU32, mapRxU32;
+LC_Return_t requestStatus;
+uint8_t requestSource;
+int32_t requestSize;
+uint32_t broadcastCount;
+char broadcastData[4];
+uint32_t indexData[8];
+checkTimer_t checkTimers[CHECK_TIMERS];
+uint32_t checkTimerLate;
+
+// @formatter:off
+const LC_MapField_t checkFields[] = {
+		{ CHECK_FIELD, 1 }, { CHECK_FIELD + 1, 2 }, { CHECK_FIELD + 2, 4 },
+};
+//9 bytes, doesn't fit classic frame
+const LC_MapField_t checkFieldsLong[] = {
+		{ CHECK_FIELD + 2, 4 }, { CHECK_FIELD + 2, 4 }, { CHECK_FIELD, 1 },
+};
+const LC_Map_t checkMaps[] = {
+		{ CHECK_MAP, 3, checkFields },
+		{ CHECK_MAP + 1, 3, checkFieldsLong },
+};
+//sender filters, variable sizes, record arrays and repeated MsgID, lookups are compared with linear search
+const LC_ObjectRecord_t checkIndexRecords[] = {
+		{ 10, { .Readable = 1 }, 2, &indexData[0] },
+		{ 11, { .Readable = 1 }, 2, &indexData[1] },
+		{ LC_Broadcast_Address, { .Writable = 1 }, -8, &indexData[2] },
+		{ 12, { .Writable = 1 }, 4, &indexData[3] },
+};
+const LC_Object_t checkIndexObjects[] = {
+		{ CHECK_INDEX, { .Readable = 1 }, 4, &indexData[0] },
+		{ CHECK_INDEX, { .Writable = 1 }, -16, &indexData[1] },
+		{ CHECK_INDEX + 1, { .Readable = 1 }, 0, &indexData[2] },
+		{ CHECK_INDEX + 1, { .Writable = 1 }, 2, &indexData[3] },
+		{ CHECK_INDEX + 2, { .Record = 1 }, 4, (void*) checkIndexRecords },
+		{ CHECK_INDEX + 2, { .Readable = 1 }, -4, &indexData[4] },
+		{ CHECK_INDEX + 3, { .Writable = 1 }, INT32_MIN, &indexData[5] },
+		{ CHECK_INDEX + 3, { .Record = 1 }, 1, (void*) &checkIndexRecords[3] },
+		{ CHECK_INDEX + 4, { .Record = 1 }, 0, (void*) checkIndexRecords },
+		{ CHECK_INDEX + 4, { .Readable = 1 }, 1, &indexData[6] },
+		{ CHECK_INDEX + 4, { .Readable = 1, .Writable = 1 }, -1, &indexData[7] },
+		{ CHECK_INDEX + 6, { .Readable = 1 }, 2, &indexData[0] },
+		{ CHECK_INDEX, { .Readable = 1 }, 8, &indexData[2] },
+};
+const LC_Object_t checkSenderObjects[] = {
+		{ CHECK_FIELD, { .Readable = 1 }, 1, &mapU8 },
+		{ CHECK_FIELD + 1, { .Readable = 1 }, 2, &mapU16 },
+		{ CHECK_FIELD + 2, { .Readable = 1 }, 4, &mapU32 },
+		{ CHECK_PUB, { .Readable = 1 }, 2, &pubValue },
+		{ CHECK_COS, { .Readable = 1 }, 2, &cosValue },
+		{ CHECK_REQ, { .Writable = 1, .Function = 1 }, 4, (intptr_t*) checkBroadcast },
+};
+const LC_Object_t checkReceiverObjects[] = {
+		{ CHECK_MSG, { .TCP = 1, .Writable = 1, .Function = 1 }, -CHECK_MAX, (intptr_t*) checkReceive },
+		{ CHECK_MSG + 1, { .Writable = 1, .Function = 1 }, -CHECK_MAX, (intptr_t*) checkReceive },
+		{ CHECK_FIELD, { .Writable = 1 }, 1, &mapRxU8 },
+		{ CHECK_FIELD + 1, { .Writable = 1 }, 2, &mapRxU16 },
+		{ CHECK_FIELD + 2, { .Writable = 1 }, 4, &mapRxU32 },
+		{ CHECK_PUB, { .Writable = 1, .Function = 1 }, 2, (intptr_t*) checkPublished },
+		{ CHECK_COS, { .Writable = 1, .Function = 1 }, 2, (intptr_t*) checkPublished },
+		{ CHECK_REQ, { .Readable = 1 }, 4, checkTx },
+};
+// @formatter:on
+
+/// Driver wrapper, logs frames taken by virtual bus port
+#define checkDriver(port) \
+	LC_Return_t checkSend##port(LC_HeaderPacked_t header, uint32_t *data, uint8_t length) { \
+		LC_Return_t result = checkBusDrivers[port]->Send(header, data, length); \
+		if (result == LC_Ok && CHECK_LOGGED(header.MsgID) && checkLogs[port].Count < CHECK_LOG) { \
+			checkFrame_t *entry = &checkLogs[port].Frames[checkLogs[port].Count++]; \
+			entry->Frame.header = header; \
+			entry->Frame.length = length; \
+			if (data && length) \
+				memcpy(entry->Frame.data, data, length); \
+			entry->Time = VBus_Time(); \
+		} \
+		return result; \
+	} \
+	uint16_t checkSendBatch##port(const lc_msgBuffered *frames, uint16_t count) { \
+		uint16_t sent = 0; \
+		while (sent < count && checkSend##port(frames[sent].header, (uint32_t*) frames[sent].data, frames[sent].length) == LC_Ok) \
+			sent++; \
+		return sent; \
+	} \
+	LC_Return_t checkFilter##port(LC_HeaderPacked_t *reg, LC_HeaderPacked_t *mask, uint16_t count) { \
+		return checkBusDrivers[port]->Filter(reg, mask, count); \
+	} \
+	LC_Return_t checkTxHalfFull##port(void) { \
+		return checkBusDrivers[port]->TxHalfFull(); \
+	}
+#define checkDriverCalls(port) { checkSend##port, checkFilter##port, checkTxHalfFull##port, checkSendBatch##port }
+
+checkDriver(0)
+checkDriver(1)
+const LC_DriverCalls_t checkDrivers[CHECK_NODES] = { checkDriverCalls(0), checkDriverCalls(1) };
+
+VBus_Config_t checkConfig = { .Bitrate = 1000000, .DataBitrate = 4000000, .AutoRecovery = 1 };
+
+int main(int argc, char **argv) {
+	checkFilter = &argv[1];
+	checkFilterSize = argc - 1;
+	for (int i = 0; i < CHECK_MAX; i++)
+		checkTx[i] = (char) (i * 7 + (i >> 8));
+
+	printf("{\"check\":\"config\",\"max_frame\":%u,\"window\":%u,\"rx_maxsize\":%u}\n", LEVCAN_MAX_FRAME, LEVCAN_TCP_WINDOW, LEVCAN_RX_MAXSIZE);
+	if (checkEnabled("window"))
+		checkWindow();
+	if (checkEnabled("announce"))
+		checkAnnounce();
+	if (checkEnabled("reject"))
+		checkReject();
+	if (checkEnabled("padding"))
+		checkPadding();
+	if (checkEnabled("maps"))
+		checkMapSend();
+	if (checkEnabled("publish"))
+		checkPublish();
+	if (checkEnabled("change_of_state"))
+		checkChangeOfState();
+	if (checkEnabled("requests"))
+		checkRequests();
+	if (checkEnabled("object_index"))
+		checkObjectIndex();
+	if (checkEnabled("timer_wheel"))
+		checkTimerWheel();
+	if (checkEnabled("slab"))
+		checkSlab();
+	return checkFailedTotal;
+}
+
+int checkEnabled(const char *name) {
+	if (checkFilterSize == 0)
+		return 1;
+	for (int i = 0; i < checkFilterSize; i++)
+		if (strncmp(name, checkFilter[i], strlen(checkFilter[i])) == 0)
+			return 1;
+	return 0;
+}
+
+/// Restarts bus with sender node 0 and receiver node 1, both online, logs cleared
+void checkBus(void) {
+	harnessBus(&checkConfig);
+	for (int i = 0; i < CHECK_NODES; i++) {
+		LC_NodeDescriptor_t *node = &nodes[i];
+		harnessNode(i, "Check", 0x2000 + i);
+		checkBusDrivers[i] = node->Driver;
+		node->Driver = &checkDrivers[i];
+		node->ShortName.NodeID = 10 + i;
+		if (i == 0) {
+			node->Objects = (void*) checkSenderObjects;
+			node->ObjectsSize = sizeof(checkSenderObjects) / sizeof(checkSenderObjects[0]);
+		} else {
+			node->Objects = (void*) checkReceiverObjects;
+			node->ObjectsSize = sizeof(checkReceiverObjects) / sizeof(checkReceiverObjects[0]);
+		}
+		node->Maps = checkMaps;
+		node->MapsSize = sizeof(checkMaps) / sizeof(checkMaps[0]);
+		LC_CreateNode(node);
+	}
+	check(harnessRun(doneOnline, 2000));
+	memset(checkLogs, 0, sizeof(checkLogs));
+	rxCount = 0;
+}
+
+/// Prints check line and counts it if some condition failed
+/// @param name
+/// @param format Extra JSON fields with leading comma, printf format
+void checkResult(const char *name, const char *format, ...) {
+	va_list args;
+	printf("{\"check\":\"%s\"", name);
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf(",\"ok\":%d}\n", checkFailed == 0);
+	if (checkFailed)
+		checkFailedTotal++;
+	checkFailed = 0;
+}
+
+int checkCondition(int condition, const char *text, int line) {
+	if (condition == 0) {
+		fprintf(stderr, "levcan_check.c:%d: failed: %s\n", line, text);
+		checkFailed++;
+	}
+	return condition;
+}
+
+/// Looks for event in trace ring, recorded after trace head was at since
+/// @param position Expected event position, -1 - any
+/// @return Number of matching records
+int checkTraced(LC_NodeDescriptor_t *node, uint32_t since, uint8_t event, int32_t position) {
+	LC_TraceRecord_t records[LEVCAN_TRACE_SIZE];
+	uint32_t count = LC_TraceRead(node, records, LEVCAN_TRACE_SIZE, 0);
+	uint32_t fresh = node->TxRxObjects.TraceHead - since;
+	int found = 0;
+	for (uint32_t i = (fresh < count) ? count - fresh : 0; i < count; i++)
+		if (records[i].Event == event && (position < 0 || records[i].Position == position))
+			found++;
+	return found;
+}
+
+/// @return 1 if length is valid classic or CAN FD data length
+uint8_t checkValidLength(uint8_t length) {
+	static const uint8_t fdLength[] = { 12, 16, 20, 24, 32, 48, 64 };
+	if (length <= 8)
+		return 1;
+	for (unsigned i = 0; i < sizeof(fdLength); i++)
+		if (fdLength[i] == length && length <= LEVCAN_MAX_FRAME)
+			return 1;
+	return 0;
+}
+
+/// Sends one message from node 0 to node 1 and compares received data
+/// @return 1 if received complete and unchanged
+int checkTransfer(int tcp, uint32_t size) {
+	LC_ObjectRecord_t rec = { .NodeID = nodes[1].ShortName.NodeID, .Size = size, .Address = checkTx, .Attributes.TCP = tcp };
+	rxWait = rxCount + 1;
+	rxSize = -1;
+	if (LC_SendMessage(&nodes[0], &rec, tcp ? CHECK_MSG : CHECK_MSG + 1) != LC_Ok)
+		return 0;
+	if (harnessRun(harnessReceived, 3000) == 0)
+		return 0;
+	//sender keeps transfer till final acknowledge, lost one is asked again after LEVCAN_COMM_TIMEOUT
+	if (tcp && harnessRun(doneTXIdle, 3000) == 0)
+		return 0;
+	return rxSize == (int32_t) size && memcmp(checkRx, checkTx, size) == 0;
+}
+
+void checkReceive(LC_NodeDescriptor_t *node, LC_Header_t header, void *data, int32_t size) {
+	rxSize = size;
+	if (size > 0 && size <= CHECK_MAX)
+		memcpy(checkRx, data, size);
+	rxCount++;
+}
+
+void checkPublished(LC_NodeDescriptor_t *node, LC_Header_t header, void *data, int32_t size) {
+	if (size != 2)
+		return;
+	if (header.MsgID == CHECK_PUB)
+		pubCount++;
+	else {
+		memcpy(&cosReceived, data, 2);
+		cosCount++;
+	}
+}
+
+void checkBroadcast(LC_NodeDescriptor_t *node, LC_Header_t header, void *data, int32_t size) {
+	if (size == sizeof(broadcastData) && header.Target == LC_Broadcast_Address) {
+		memcpy(broadcastData, data, size);
+		broadcastCount++;
+	}
+}
+
+void checkResponse(LC_NodeDescriptor_t *node, LC_Request_t *request, LC_Return_t status, uint8_t source, void *data, int32_t size) {
+	requestStatus = status;
+	requestSource = source;
+	requestSize = size;
+	if (size > 0 && size <= CHECK_MAX)
+		memcpy(checkRx, data, size);
+	rxCount++;
+}
+
+int doneOnline(void) {
+	return harnessOnline() && nodes[0].ShortName.NodeID != nodes[1].ShortName.NodeID && LC_GetNode(&nodes[0], nodes[1].ShortName.NodeID).ExtTransfer;
+}
+
+int doneChanged(void) {
+	return cosCount >= cosWait;
+}
+
+int doneTXIdle(void) {
+	return nodes[0].TxRxObjects.objTXbuf_start == 0;
+}
+
+/// Windowed TCP: announce grants window, credits stay in RTR length, frame sequence is continuous,
+/// data is intact with and without frame loss
+void checkWindow(void) {
+	//smallest multi-frame transfer, partial and full windows
+	const uint32_t sizes[] = { LEVCAN_MAX_FRAME + 1, LEVCAN_MAX_FRAME * 8, 500, 4096 };
+	checkBus();
+	uint32_t frames = 0, ctsMax = 0;
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		memset(checkLogs, 0, sizeof(checkLogs));
+		check(checkTransfer(1, sizes[s]));
+		checkLog_t *tx = &checkLogs[0], *rx = &checkLogs[1];
+		//sender: announce, then data frames numbered from 0
+		check(tx->Count > 1);
+		lc_msgBuffered *announce = &tx->Frames[0].Frame;
+		check(announce->header.RTS_CTS && announce->header.EoM == 0 && announce->header.Parity && announce->length == 5);
+		check(((uint8_t*) announce->data)[0] == LEVCAN_TCP_WINDOW);
+		uint32_t bytes = 0;
+		uint8_t sequence = 0;
+		for (uint32_t i = 1; i < tx->Count; i++) {
+			lc_msgBuffered *frame = &tx->Frames[i].Frame;
+			check(frame->header.Request == 0 && frame->header.RTS_CTS == 0);
+			check(((uint8_t*) frame->data)[0] == sequence++);
+			bytes += frameLength(frame) - 1;
+			frames++;
+		}
+		check(bytes == sizes[s]);
+		check(tx->Count && tx->Frames[tx->Count - 1].Frame.header.EoM);
+		//receiver: grant of full window, acknowledges never above it, end of message last
+		uint32_t grants = 0;
+		for (uint32_t i = 0; i < rx->Count; i++) {
+			lc_msgBuffered *cts = &rx->Frames[i].Frame;
+			check(cts->header.Request);
+			check(cts->length <= LEVCAN_TCP_WINDOW);
+			if (cts->length > ctsMax)
+				ctsMax = cts->length;
+			if (i == 0 && cts->header.RTS_CTS && cts->length == LEVCAN_TCP_WINDOW)
+				grants++;
+		}
+		check(grants == 1);
+		check(rx->Count && rx->Frames[rx->Count - 1].Frame.header.EoM);
+	}
+	check(harnessRun(doneTXIdle, 100));
+
+	//lost frames on both sides are repeated, nothing is delivered corrupted
+	VBus_Faults_t lossy = { .Loss = 0.05f };
+	VBus_SetFaults(0, lossy);
+	VBus_SetFaults(1, lossy);
+	LC_Statistics_t stats;
+	LC_GetStatistics(&nodes[0], 0, 0, 1);
+	int delivered = 0;
+	for (int i = 0; i < 20; i++)
+		delivered += checkTransfer(1, 1000);
+	LC_GetStatistics(&nodes[0], &stats, 0, 0);
+	check(delivered == 20);
+	check(stats.Retransmits > 0);
+	VBus_SetFaults(0, (VBus_Faults_t ) { 0 });
+	VBus_SetFaults(1, (VBus_Faults_t ) { 0 });
+	checkResult("window", ",\"frames\":%u,\"cts_max\":%u,\"lossy_delivered\":%d,\"retransmits\":%u", frames, ctsMax, delivered, stats.Retransmits);
+}
+
+/// UDP multi-frame transfer to node with extended transfer support starts with length announce
+void checkAnnounce(void) {
+	checkBus();
+	uint32_t head = nodes[1].TxRxObjects.TraceHead;
+	check(checkTransfer(0, 300));
+	lc_msgBuffered *announce = &checkLogs[0].Frames[0].Frame;
+	uint8_t *bytes = (uint8_t*) announce->data;
+	check(checkLogs[0].Count > 1);
+	check(announce->header.RTS_CTS && announce->header.EoM == 0 && announce->header.Parity == 0 && announce->length == 5);
+	check((bytes[1] | bytes[2] << 8 | bytes[3] << 16 | (uint32_t) bytes[4] << 24) == 300);
+	//receiver allocated announced size
+	check(checkTraced(&nodes[1], head, LC_TraceRXStart, 300) == 1);
+	check(checkTraced(&nodes[1], head, LC_TraceRXDone, 300) == 1);
+	//UDP has no acknowledge
+	check(checkLogs[1].Count == 0);
+	uint32_t frames = checkLogs[0].Count;
+	//single frame message has no announce
+	memset(checkLogs, 0, sizeof(checkLogs));
+	check(checkTransfer(0, 8));
+	check(checkLogs[0].Count == 1 && checkLogs[0].Frames[0].Frame.header.EoM);
+	checkResult("announce", ",\"frames\":%u", frames);
+}
+
+/// Announce above LEVCAN_RX_MAXSIZE: TCP sender is rejected and stops at once, UDP one is ignored
+void checkReject(void) {
+	const uint32_t size = LEVCAN_RX_MAXSIZE + 1000;
+	checkBus();
+	uint32_t head = nodes[0].TxRxObjects.TraceHead;
+	LC_Statistics_t stats;
+	LC_GetStatistics(&nodes[0], 0, 0, 1);
+	uint64_t start = VBus_Time();
+	check(checkTransfer(1, size) == 0);
+	check(rxCount == 0);
+	//receiver answers with EoM + CTS
+	check(checkLogs[1].Count == 1);
+	lc_msgBuffered *reject = &checkLogs[1].Frames[0].Frame;
+	check(reject->header.Request && reject->header.EoM && reject->header.RTS_CTS);
+	check(checkTraced(&nodes[0], head, LC_TraceTXRejected, -1) == 1);
+	//sender deleted transfer without waiting for timeout
+	uint64_t ms = 0;
+	for (uint32_t i = 0; i < checkLogs[0].Count; i++)
+		ms = (checkLogs[0].Frames[i].Time - start) / 1000000;
+	check(ms < LEVCAN_COMM_TIMEOUT);
+	check(nodes[0].TxRxObjects.objTXbuf_start == 0);
+	LC_GetStatistics(&nodes[0], &stats, 0, 0);
+	check(stats.TXTimeouts == 0);
+	//only announce and frames already queued went out
+	check(checkLogs[0].Count <= 1 + LEVCAN_TCP_WINDOW);
+
+	memset(checkLogs, 0, sizeof(checkLogs));
+	check(checkTransfer(0, size) == 0);
+	check(rxCount == 0);
+	check(checkLogs[1].Count == 0);
+	check(nodes[1].TxRxObjects.objRXbuf_start == 0);
+	checkResult("reject", ",\"size\":%u,\"last_frame_ms\":%u", size, (uint32_t) ms);
+}
+
+/// CAN FD frames are padded to valid data length and unpadded back, classic frames stay as is
+void checkPadding(void) {
+	lc_msgBuffered frame;
+	for (uint8_t length = 0; length < LEVCAN_MAX_FRAME; length++) {
+		memset(frame.data, 0xAA, sizeof(frame.data));
+		frame.length = framePad(frame.data, length);
+		check(checkValidLength(frame.length));
+		check(frame.length >= length && frame.length <= LEVCAN_MAX_FRAME);
+		check(frameLength(&frame) == length);
+		if (length <= 8)
+			check(frame.length == length);
+	}
+	//every frame on wire has valid length, both directions
+	checkBus();
+	uint32_t padded = 0;
+	for (int tcp = 0; tcp < 2; tcp++) {
+		memset(checkLogs, 0, sizeof(checkLogs));
+		check(checkTransfer(tcp, 1000));
+		for (int n = 0; n < CHECK_NODES; n++)
+			for (uint32_t i = 0; i < checkLogs[n].Count; i++) {
+				check(checkValidLength(checkLogs[n].Frames[i].Frame.length));
+				padded += (checkLogs[n].Frames[i].Frame.length > 8);
+			}
+	}
+#if LEVCAN_MAX_FRAME > 8
+	check(padded > 0);
+#else
+	check(padded == 0);
+#endif
+	checkResult("padding", ",\"fd_frames\":%u", padded);
+}
+
+/// Map fields are packed from sender dictionary and written to receiver one
+void checkMapSend(void) {
+	checkBus();
+	mapU8 = 0x5A;
+	mapU16 = 0xBEEF;
+	mapU32 = 0x12345678;
+	mapRxU8 = 0;
+	mapRxU16 = 0;
+	mapRxU32 = 0;
+	check(LC_SendMap(&nodes[0], CHECK_MAP, nodes[1].ShortName.NodeID, LC_Priority_Mid) == LC_Ok);
+	harnessWait(5);
+	check(mapRxU8 == mapU8 && mapRxU16 == mapU16 && mapRxU32 == mapU32);
+	//one frame of packed size
+	check(checkLogs[0].Count == 1 && checkLogs[0].Frames[0].Frame.length == 7);
+	check(LC_SendMap(&nodes[0], CHECK_MAP + 1, nodes[1].ShortName.NodeID, LC_Priority_Mid) == LC_ObjectError);
+	check(LC_SendMap(&nodes[0], CHECK_MAP + 2, nodes[1].ShortName.NodeID, LC_Priority_Mid) == LC_ObjectError);
+	checkResult("maps", "");
+}
+
+/// Cyclic entry keeps its period and stops at once when disabled
+void checkPublish(void) {
+	LC_PublishEntry_t entries[] = {
+			{ .MsgID = CHECK_PUB, .Period = 10, .Priority = LC_Priority_Low },
+	};
+	checkBus();
+	entries[0].Target = nodes[1].ShortName.NodeID;
+	pubCount = 0;
+	nodes[0].Publish = entries;
+	nodes[0].PublishSize = sizeof(entries) / sizeof(entries[0]);
+	check(LC_PublishStart(&nodes[0]) == LC_Ok);
+	harnessWait(360);
+	uint32_t cycles = pubCount;
+	//10 ms period
+	check(cycles >= 35 && cycles <= 37);
+	//disabled entry stops at once
+	entries[0].Period = 0;
+	check(LC_PublishStart(&nodes[0]) == LC_Ok);
+	harnessWait(250);
+	check(pubCount == cycles);
+	nodes[0].Publish = 0;
+	nodes[0].PublishSize = 0;
+	checkResult("publish", ",\"cyclic\":%u", cycles);
+}
+
+/// Change-of-state entry sends on change above deadband, not sooner than inhibit time, and keep-alive at period
+void checkChangeOfState(void) {
+	LC_PublishEntry_t entries[] = {
+			{ .MsgID = CHECK_COS, .Period = 200, .Priority = LC_Priority_Low, .Snapshot = &cosSnapshot, .Inhibit = 5, .DeadbandType = LC_Deadband_Int16,
+					.Deadband = 2 },
+	};
+	checkBus();
+	entries[0].Target = nodes[1].ShortName.NodeID;
+	cosCount = 0;
+	cosValue = 100;
+	nodes[0].Publish = entries;
+	nodes[0].PublishSize = sizeof(entries) / sizeof(entries[0]);
+	check(LC_PublishStart(&nodes[0]) == LC_Ok);
+	//first check sends at once
+	harnessWait(50);
+	check(cosCount == 1 && cosReceived == 100);
+	//within deadband
+	cosValue += 2;
+	harnessWait(50);
+	check(cosCount == 1);
+	cosWait = 2;
+	cosValue += 3;
+	check(harnessRun(doneChanged, 10) && cosReceived == 105);
+	//next change waits for inhibit time
+	cosValue += 3;
+	harnessWait(2);
+	check(cosCount == 2);
+	cosWait = 3;
+	check(harnessRun(doneChanged, 10) && cosReceived == 108);
+	//keep-alive only
+	harnessWait(250);
+	check(cosCount == 4);
+	//disabled entry stops at once
+	entries[0].Period = 0;
+	check(LC_PublishStart(&nodes[0]) == LC_Ok);
+	cosValue += 100;
+	harnessWait(250);
+	check(cosCount == 4);
+	nodes[0].Publish = 0;
+	nodes[0].PublishSize = 0;
+	checkResult("change_of_state", ",\"sent\":%u", cosCount);
+}
+
+/// Async request is completed by data addressed to requester: response, empty reply for missing object or timeout
+/// of absent node. Broadcast of same MsgID from target goes to dictionary and leaves request pending
+void checkRequests(void) {
+	LC_Request_t request = { .Callback = checkResponse };
+	const char broadcast[4] = { 'B', 'C', 'S', 'T' };
+	checkBus();
+	uint8_t server = nodes[1].ShortName.NodeID;
+	//response
+	rxWait = rxCount + 1;
+	check(LC_SendRequestAsync(&nodes[0], &request, server, CHECK_REQ, 50) == LC_Ok);
+	check(harnessRun(harnessReceived, 50));
+	check(requestStatus == LC_Ok && requestSource == server && requestSize == 4 && memcmp(checkRx, checkTx, 4) == 0);
+	//responder without object sends empty message
+	rxWait = rxCount + 1;
+	check(LC_SendRequestAsync(&nodes[0], &request, server, CHECK_REQ + 1, 50) == LC_Ok);
+	check(harnessRun(harnessReceived, 50));
+	check(requestStatus == LC_ObjectError && requestSource == server && requestSize == 0);
+	//nobody answers
+	uint64_t start = VBus_Time();
+	rxWait = rxCount + 1;
+	check(LC_SendRequestAsync(&nodes[0], &request, server + 1, CHECK_REQ, 20) == LC_Ok);
+	check(harnessRun(harnessReceived, 100));
+	uint32_t timeout = (VBus_Time() - start) / 1000000;
+	//request may start late in network manager tick
+	check(requestStatus == LC_Timeout && timeout >= 19 && timeout <= 21);
+	//target broadcasts same object while request is pending, broadcast goes first on bus
+	LC_ObjectRecord_t rec = { .NodeID = LC_Broadcast_Address, .Size = sizeof(broadcast), .Address = (void*) broadcast };
+	broadcastCount = 0;
+	rxWait = rxCount + 1;
+	check(LC_SendMessage(&nodes[1], &rec, CHECK_REQ) == LC_Ok);
+	check(LC_SendRequestAsync(&nodes[0], &request, server, CHECK_REQ, 50) == LC_Ok);
+	check(harnessRun(harnessReceived, 50));
+	check(requestStatus == LC_Ok && requestSize == 4 && memcmp(checkRx, checkTx, 4) == 0);
+	check(broadcastCount == 1 && memcmp(broadcastData, broadcast, sizeof(broadcast)) == 0);
+	//completed request has no late timeout
+	harnessWait(60);
+	check(rxCount == rxWait);
+	checkResult("requests", ",\"timeout_ms\":%u,\"broadcasts\":%u", timeout, broadcastCount);
+}
+
+/// Indexed lookup returns same record as linear search for every MsgID, size, direction and sender, also for
+/// system object registered by service after LC_CreateNode
+void checkObjectIndex(void) {
+	const int32_t sizes[] = { -1, 0, 1, 2, 3, 4, 5, 8, 9, 16, 17, 512 };
+	const uint8_t senders[] = { 10, 11, 12, 13, LC_Broadcast_Address };
+	uint32_t lookups = 0, found = 0, different = 0;
+	checkBus();
+	LC_NodeDescriptor_t *node = &nodes[0];
+	node->Objects = (void*) checkIndexObjects;
+	node->ObjectsSize = sizeof(checkIndexObjects) / sizeof(checkIndexObjects[0]);
+	check(LC_UpdateObjectIndex(node) == LC_Ok && node->ObjectIndex != 0);
+	//late service object, published index is rebuilt by lc_indexSystemObjects
+	LC_Object_t *late = lc_registerSystemObjects(node, 1);
+	check(late != 0);
+	late->MsgID = LC_SYS_Events;
+	late->Attributes.Writable = 1;
+	late->Size = -LEVCAN_OBJECT_DATASIZE;
+	late->Address = checkRx;
+	lc_indexSystemObjects(node);
+	check(node->ObjectIndex != 0 && findObjectRecord(node, LC_SYS_Events, 4, 1, 11).Address == checkRx);
+	for (uint32_t id = CHECK_INDEX - 1; id <= LC_SYS_End; id++) {
+		if (id == CHECK_INDEX + 8)
+			id = LC_SYS_NodeName;
+		for (int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+			for (uint8_t rw = 0; rw < 2; rw++) //read, write
+				for (int n = 0; n < sizeof(senders); n++) {
+					LC_ObjectRecord_t indexed = findObjectRecord(node, id, sizes[s], rw, senders[n]);
+					lc_objIndex_t *index = node->ObjectIndex;
+					node->ObjectIndex = 0;
+					LC_ObjectRecord_t linear = findObjectRecord(node, id, sizes[s], rw, senders[n]);
+					node->ObjectIndex = index;
+					lookups++;
+					//missed linear search leaves fields of last candidate, only address is defined
+					if (linear.Address == 0)
+						different += (indexed.Address != 0);
+					else {
+						found++;
+						different += (indexed.Address != linear.Address || indexed.Size != linear.Size
+								|| indexed.Attributes.Attributes != linear.Attributes.Attributes || indexed.NodeID != linear.NodeID);
+					}
+				}
+	}
+	check(different == 0);
+	check(found > 0 && found < lookups);
+	checkResult("object_index", ",\"lookups\":%u,\"found\":%u", lookups, found);
+}
+
+void checkTimerFired(void *context, lc_timer_t *timer) {
+	lc_timerWheel_t *wheel = context;
+	checkTimer_t *owner = timer->Owner;
+	owner->Fired++;
+	owner->FiredAt = wheel->Now;
+	if (wheel->Now != timer->Expires)
+		checkTimerLate++;
+}
+
+/// Timers expire exactly at their tick, both when advanced by one tick and by lc_timerNext steps,
+/// stopped and restarted timers don't fire at old time
+void checkTimerWheel(void) {
+	lc_timerWheel_t wheel;
+	uint32_t delays[CHECK_TIMERS];
+	for (int pass = 0; pass < 2; pass++) {
+		lc_timerInit(&wheel);
+		//wheel position not aligned to slots
+		lc_timerAdvance(&wheel, 12345 + pass * 777, 0);
+		uint32_t start = wheel.Now;
+		checkTimerLate = 0;
+		for (int i = 0; i < CHECK_TIMERS; i++) {
+			//near, slot borders, second level and longer than both levels
+			static const uint32_t fixed[] = { 0, 1, 2, LC_TIMER_SLOTS - 1, LC_TIMER_SLOTS, LC_TIMER_SLOTS + 1, LC_TIMER_SLOTS * LC_TIMER_SLOTS - 1,
+					LC_TIMER_SLOTS * LC_TIMER_SLOTS, LC_TIMER_SLOTS * LC_TIMER_SLOTS + 1, 5000 };
+			delays[i] = (i < 10) ? fixed[i] : (uint32_t) (i * 2654435761u) % 6000;
+			lc_timerSetup(&checkTimers[i].Timer, checkTimerFired, &checkTimers[i]);
+			checkTimers[i].Fired = 0;
+			lc_timerStart(&wheel, &checkTimers[i].Timer, delays[i]);
+		}
+		//stopped one never fires, restarted one fires at new time only
+		lc_timerStop(&wheel, &checkTimers[11].Timer);
+		lc_timerStart(&wheel, &checkTimers[12].Timer, 100);
+		delays[12] = 100;
+		uint32_t steps = 0;
+		while (wheel.Now - start < 7000) {
+			uint32_t next = pass ? lc_timerNext(&wheel) : 1;
+			if (next == LC_TIMER_IDLE)
+				break;
+			check(next > 0);
+			lc_timerAdvance(&wheel, next, &wheel);
+			steps++;
+		}
+		for (int i = 0; i < CHECK_TIMERS; i++) {
+			if (i == 11) {
+				check(checkTimers[i].Fired == 0);
+				continue;
+			}
+			check(checkTimers[i].Fired == 1);
+			check(checkTimers[i].FiredAt - start == (delays[i] ? delays[i] : 1));
+		}
+		check(checkTimerLate == 0);
+		check(lc_timerNext(&wheel) == LC_TIMER_IDLE);
+		if (pass)
+			checkResult("timer_wheel", ",\"tickless_steps\":%u", steps);
+	}
+}
+
+/// Blocks come from the smallest fitting pool, larger pools take over, then lcmalloc. Blocks don't overlap
+void checkSlab(void) {
+	void *blocks[CHECK_SLAB];
+	LC_SlabStats_t before[LC_SlabClasses], after[LC_SlabClasses];
+	LC_ResetSlabStats();
+	LC_GetSlabStats(before);
+	//nodes of previous checks could hold some blocks
+	uint32_t free = 0;
+	int fit = -1;
+	for (int c = 0; c < LC_SlabClasses; c++)
+		if (before[c].Size >= CHECK_SLAB_SIZE) {
+			free += before[c].Blocks - before[c].Used;
+			if (fit < 0 || before[c].Size < before[fit].Size)
+				fit = c;
+		}
+	check(free < CHECK_SLAB);
+	for (int i = 0; i < CHECK_SLAB; i++) {
+		blocks[i] = lc_slabAlloc(CHECK_SLAB_SIZE);
+		check(blocks[i] != 0);
+		memset(blocks[i], i, CHECK_SLAB_SIZE);
+	}
+	uint32_t pooled = 0, broken = 0;
+	for (int i = 0; i < CHECK_SLAB; i++) {
+		uint8_t *bytes = blocks[i];
+		for (int k = 0; k < CHECK_SLAB_SIZE; k++)
+			broken += (bytes[k] != i);
+		pooled += lc_slabOwns(blocks[i]);
+	}
+	check(broken == 0);
+	check(pooled == free);
+	LC_GetSlabStats(after);
+	for (int c = 0; c < LC_SlabClasses; c++)
+		check(after[c].Used == ((after[c].Size >= CHECK_SLAB_SIZE) ? after[c].Blocks : before[c].Used));
+	//fallbacks are counted by smallest fitting class
+	check(after[fit].Fallbacks == CHECK_SLAB - free);
+	for (int i = 0; i < CHECK_SLAB; i++)
+		lc_slabFree(blocks[i]);
+	LC_GetSlabStats(after);
+	for (int c = 0; c < LC_SlabClasses; c++)
+		check(after[c].Used == before[c].Used);
+	//freed block is reused from smallest pool
+	void *again = lc_slabAlloc(CHECK_SLAB_SIZE);
+	LC_GetSlabStats(after);
+	check(lc_slabOwns(again) && after[fit].Used == before[fit].Used + 1);
+	lc_slabFree(again);
+	//larger than any pool
+	void *large = lc_slabAlloc(2000);
+	check(large != 0 && lc_slabOwns(large) == 0);
+	lc_slabFree(large);
+	checkResult("slab", ",\"pooled\":%u,\"fallbacks\":%u", pooled, CHECK_SLAB - pooled);
+}
@@ -0,0 +1,60 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#pragma once
+
+//Protocol check configuration: bare-metal paths, dynamic memory with small slab pools, trace ring
+//for protocol events and low RX size limit, so rejects are cheap to provoke
+
+//user functions for critical sections
+#define lc_enable_irq()
+#define lc_disable_irq()
+
+#define LC_EXPORT
+//Memory packing, compiler specific
+#define LEVCAN_PACKED __attribute__((packed))
+//platform specific, define how many bytes in uint8_t
+#define LEVCAN_MIN_BYTE_SIZE 1
+
+#define LEVCAN_USE_INT64
+#define LEVCAN_USE_DOUBLE
+#define LEVCAN_USE_FLOAT
+
+//Max own created nodes
+#define LEVCAN_MAX_OWN_NODES 4
+//max saved nodes short names (used for search)
+#define LEVCAN_MAX_TABLE_NODES 16
+
+//Above-driver buffer size. Used to store CAN messages before calling network manager
+#define LEVCAN_TX_SIZE 64
+#define LEVCAN_RX_SIZE 256
+
+//Default size for malloc, data size for file i/o
+#define LEVCAN_OBJECT_DATASIZE 64
+#define LEVCAN_FILE_DATASIZE 512
+
+//external malloc functions
+#define lcmalloc malloc
+#define lcfree free
+#define lcdelay(ms)
+
+//larger announced transfers are rejected
+#define LEVCAN_RX_MAXSIZE 4096
+
+//pools smaller than check allocations, fallbacks are checked too
+#define LEVCAN_SLAB_OBJECTS 8
+#define LEVCAN_SLAB_64 8
+#define LEVCAN_SLAB_256 4
+#define LEVCAN_SLAB_512 2
+
+//protocol events are read back from trace ring
+#define LEVCAN_TRACE_SIZE 256
+
+//network manager runs in next harness step after new work
+void harness_wakeup(void *node);
+#define LC_NetworkManagerWakeup(node) harness_wakeup(node)
@@ -0,0 +1,555 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "levcan.h"
+#include "levcan_objects.h"
+#include "levcan_paramserver.h"
+#include "levcan_paramclient.h"
+#include "levcan_fileclient.h"
+#include "levcan_fileserver.h"
+#include "can_hal.h"
+#include "levcan_harness.h"
+
+//End-to-end protocol benchmark on hal/Virtual. Time is simulated, results depend on library and bus model
+//only, not on host load, so runs can be compared between versions. Every result is one JSON object per line:
+//{"bench":"udp_latency","size":8,...}, host CPU time spent by bench is "cpu_ms". Exit code is 1 if any result
+//lost or corrupted data, missed responses or claims. With -l or -e fault injection only transfers that repeat
+//lost frames are judged: TCP, files and address claim.
+//Usage: levcan_bench [-b bitrate] [-d data bitrate] [-l loss] [-e errors] [bench name prefix...]
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+#define BENCH_MAX_PAYLOAD 4096
+#define BENCH_MSG 0x100
+#define BENCH_FILE_SIZE 16384
+//readable objects of different size from BENCH_MSG + 2, then one missing
+#define BENCH_READABLE 8
+
+typedef struct {
+	uint16_t Size;
+	uint16_t Item;
+	uint16_t In;
+	uint16_t Count;
+	char Data[];
+} benchQueue_t;
+
+typedef struct {
+	char Name[32];
+	char *Data;
+	uint32_t Size;
+	uint32_t Position;
+	uint8_t Open;
+} benchFile_t;
+
+//PRIVATE FUNCTIONS
+void benchBus(int count, uint8_t sameID);
+int benchEnabled(const char *name);
+void benchReceive(LC_NodeDescriptor_t *node, LC_Header_t header, void *data, int32_t size);
+void benchUdpLatency(void);
+void benchThroughput(void);
+void benchParameters(void);
+void benchFiles(void);
+void benchRequests(void);
+void benchAddressClaim(void);
+void benchResponse(LC_NodeDescriptor_t *node, LC_Request_t *request, LC_Return_t status, uint8_t source, void *data, int32_t size);
+int doneClaimed(void);
+double cpuMs(clock_t start);
+
+//PRIVATE VARIABLES
+VBus_Config_t benchConfig = { .Bitrate = 1000000, .AutoRecovery = 1 };
+VBus_Faults_t benchFaults;
+char **benchFilter;
+int benchFilterSize;
+int benchFailed; //results with lost or corrupted data
+uint8_t benchLossy; //fault injection, UDP results may lose data
+
+char benchTx[BENCH_MAX_PAYLOAD];
+char benchRx[BENCH_FILE_SIZE];
+volatile uint32_t rxErrors;
+volatile uint64_t rxTime;
+LC_Request_t benchRequest[BENCH_READABLE + 1];
+volatile uint32_t requestStatus[LC_InitError + 1];
+
+benchFile_t ramFiles[4];
+
+uint32_t dirValues[24];
+const LCP_Uint32_t dirDescriptor = { 0, 1000000, 1 };
+// @formatter:off
+const LCPS_Entry_t PD_Bench0[] = {
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[0], dirDescriptor, "Parameter 0", "%u"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[1], dirDescriptor, "Parameter 1", "%u"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[2], dirDescriptor, "Parameter 2", "%u"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[3], dirDescriptor, "Parameter 3", "%u"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[4], dirDescriptor, "Parameter 4", "%u"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[5], dirDescriptor, "Parameter 5", "%u"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[6], dirDescriptor, "Parameter 6", "%u"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[7], dirDescriptor, "Parameter 7", "%u"),
+};
+const LCPS_Entry_t PD_Bench1[] = {
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[8], dirDescriptor, "Motor current limit", "%u mA"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[9], dirDescriptor, "Motor regen current limit", "%u mA"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[10], dirDescriptor, "Battery voltage cutoff", "%u mV"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[11], dirDescriptor, "Battery voltage limit", "%u mV"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[12], dirDescriptor, "Speed limit", "%u km/h"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[13], dirDescriptor, "Wheel circumference", "%u mm"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[14], dirDescriptor, "Throttle ramp", "%u ms"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[15], dirDescriptor, "Brake ramp", "%u ms"),
+};
+const LCPS_Entry_t PD_Bench2[] = {
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[16], dirDescriptor, "Mode", "Off\nEco\nNormal\nSport"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[17], dirDescriptor, "Assist level 1", "%u %%"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[18], dirDescriptor, "Assist level 2", "%u %%"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[19], dirDescriptor, "Assist level 3", "%u %%"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[20], dirDescriptor, "Assist level 4", "%u %%"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[21], dirDescriptor, "Assist level 5", "%u %%"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[22], dirDescriptor, "Pedal sensor filter", "%u Hz"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, dirValues[23], dirDescriptor, "Pedal sensor timeout", "%u ms"),
+};
+const LCPS_Directory_t benchDirectories[] = {
+		directory(PD_Bench0, 0, LCP_AccessLvl_Any, "Bench device"),
+		directory(PD_Bench1, 0, LCP_AccessLvl_Any, "Motor"),
+		directory(PD_Bench2, 0, LCP_AccessLvl_Any, "Pedal assist"),
+};
+
+const LC_Object_t benchObjects[] = {
+		{ BENCH_MSG, { .TCP = 1, .Writable = 1, .Function = 1 }, -BENCH_MAX_PAYLOAD, (intptr_t*) benchReceive },
+		{ BENCH_MSG + 1, { .TCP = 0, .Writable = 1, .Function = 1 }, -BENCH_MAX_PAYLOAD, (intptr_t*) benchReceive },
+		{ BENCH_MSG + 2, { .Readable = 1 }, 2, benchTx },
+		{ BENCH_MSG + 3, { .Readable = 1 }, 4, benchTx },
+		{ BENCH_MSG + 4, { .Readable = 1 }, 4, benchTx },
+		{ BENCH_MSG + 5, { .Readable = 1 }, 8, benchTx },
+		{ BENCH_MSG + 6, { .Readable = 1 }, 8, benchTx },
+		{ BENCH_MSG + 7, { .Readable = 1 }, 16, benchTx },
+		{ BENCH_MSG + 8, { .Readable = 1 }, 64, benchTx },
+		{ BENCH_MSG + 9, { .Readable = 1, .TCP = 1 }, 256, benchTx },
+};
+// @formatter:on
+
+int main(int argc, char **argv) {
+	int opt;
+	while ((opt = getopt(argc, argv, "b:d:l:e:")) != -1) {
+		switch (opt) {
+		case 'b':
+			benchConfig.Bitrate = atoi(optarg);
+			break;
+		case 'd':
+			benchConfig.DataBitrate = atoi(optarg);
+			break;
+		case 'l':
+			benchFaults.Loss = atof(optarg);
+			break;
+		case 'e':
+			benchFaults.Errors = atof(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-b bitrate] [-d data bitrate] [-l loss] [-e errors] [bench...]\n", argv[0]);
+			return 2;
+		}
+	}
+	benchLossy = (benchFaults.Loss > 0 || benchFaults.Errors > 0);
+	benchFilter = &argv[optind];
+	benchFilterSize = argc - optind;
+	for (int i = 0; i < BENCH_MAX_PAYLOAD; i++)
+		benchTx[i] = (char) (i * 7 + (i >> 8));
+
+	printf("{\"bench\":\"config\",\"version\":\"%s\",\"bitrate\":%u,\"data_bitrate\":%u,\"max_frame\":%u,\"loss\":%g,\"errors\":%g,"
+			"\"step_us\":%u,\"manager_us\":%u}\n", BENCH_VERSION, benchConfig.Bitrate,
+			benchConfig.DataBitrate ? benchConfig.DataBitrate : benchConfig.Bitrate, LEVCAN_MAX_FRAME, benchFaults.Loss, benchFaults.Errors,
+			HARNESS_STEP, HARNESS_MANAGER);
+	if (benchEnabled("udp_latency"))
+		benchUdpLatency();
+	if (benchEnabled("throughput"))
+		benchThroughput();
+	if (benchEnabled("parameters"))
+		benchParameters();
+	if (benchEnabled("files"))
+		benchFiles();
+	if (benchEnabled("requests"))
+		benchRequests();
+	if (benchEnabled("address_claim"))
+		benchAddressClaim();
+	return benchFailed ? 1 : 0;
+}
+
+int benchEnabled(const char *name) {
+	if (benchFilterSize == 0)
+		return 1;
+	for (int i = 0; i < benchFilterSize; i++)
+		if (strncmp(name, benchFilter[i], strlen(benchFilter[i])) == 0)
+			return 1;
+	return 0;
+}
+
+/// Restarts bus with new nodes. Node 0 is client, node 1 runs parameter and file servers
+/// @param count Nodes
+/// @param sameID All nodes start with same default ID and have to solve conflict
+void benchBus(int count, uint8_t sameID) {
+	harnessBus(&benchConfig);
+	for (int i = 0; i < count; i++) {
+		LC_NodeDescriptor_t *node = &nodes[i];
+		VBus_SetFaults(harnessNode(i, "Bench", 0x1000 + i), benchFaults);
+		node->ShortName.NodeID = sameID ? 10 : 10 + i;
+		node->Objects = (void*) benchObjects;
+		node->ObjectsSize = sizeof(benchObjects) / sizeof(benchObjects[0]);
+		if (i == 0) {
+			LCP_ParameterClientInit(node);
+			LC_FileClientInit(node);
+		} else if (i == 1) {
+			node->Directories = (void*) benchDirectories;
+			node->DirectoriesSize = sizeof(benchDirectories) / sizeof(benchDirectories[0]);
+			LCP_ParameterServerInit(node, 0);
+			LC_FileServerInit(node);
+		}
+		LC_CreateNode(node);
+	}
+}
+
+void* bench_queueCreate(uint16_t length, uint16_t itemSize) {
+	benchQueue_t *queue = calloc(1, sizeof(benchQueue_t) + length * itemSize);
+	if (queue) {
+		queue->Size = length;
+		queue->Item = itemSize;
+	}
+	return queue;
+}
+
+void bench_queueReset(void *queue) {
+	((benchQueue_t*) queue)->Count = 0;
+}
+
+int bench_queueSend(void *queue, const void *item) {
+	benchQueue_t *q = queue;
+	if (q->Count == q->Size)
+		return 0;
+	memcpy(&q->Data[q->In * q->Item], item, q->Item);
+	q->In = (q->In + 1) % q->Size;
+	q->Count++;
+	return 1;
+}
+
+int bench_queueReceive(void *queue, void *item, uint32_t ms) {
+	benchQueue_t *q = queue;
+	//blocking receive outside managers is the only place where simulated time goes on
+	for (uint32_t waited = 0; q->Count == 0; waited += HARNESS_STEP) {
+		if (harnessInside || waited >= ms * 1000)
+			return 0;
+		harnessStep();
+	}
+	uint16_t out = (q->In + q->Size - q->Count) % q->Size;
+	memcpy(item, &q->Data[out * q->Item], q->Item);
+	q->Count--;
+	return 1;
+}
+
+void benchReceive(LC_NodeDescriptor_t *node, LC_Header_t header, void *data, int32_t size) {
+	if (size < 0 || size > BENCH_MAX_PAYLOAD || (size && memcmp(data, benchTx, size)))
+		rxErrors++;
+	rxTime = VBus_Time();
+	rxCount++;
+}
+
+void benchResponse(LC_NodeDescriptor_t *node, LC_Request_t *request, LC_Return_t status, uint8_t source, void *data, int32_t size) {
+	//context is expected size
+	if (status == LC_Ok && (size != (intptr_t) request->Context || memcmp(data, benchTx, size)))
+		rxErrors++;
+	requestStatus[status]++;
+	rxTime = VBus_Time();
+	rxCount++;
+}
+
+int doneClaimed(void) {
+	if (harnessOnline() == 0)
+		return 0;
+	for (int i = 0; i < nodesSize; i++) {
+		for (int k = i + 1; k < nodesSize; k++)
+			if (nodes[i].ShortName.NodeID == nodes[k].ShortName.NodeID)
+				return 0;
+		//everyone knows everyone
+		int known = 0;
+		uint16_t pos = 0;
+		for (LC_NodeShortName_t n = LC_GetActiveNodes(&nodes[i], &pos); n.NodeID != LC_Broadcast_Address; n = LC_GetActiveNodes(&nodes[i], &pos))
+			if (n.NodeID != nodes[i].ShortName.NodeID)
+				known++;
+		if (known != nodesSize - 1)
+			return 0;
+	}
+	return 1;
+}
+
+double cpuMs(clock_t start) {
+	return (double) (clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
+
+void benchUdpLatency(void) {
+	const uint16_t sizes[] = { 1, 4, 8 };
+	const int repeat = 100;
+
+	benchBus(2, 0);
+	harnessRun(harnessOnline, 2000);
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		clock_t cpu = clock();
+		LC_ObjectRecord_t rec = { .NodeID = nodes[1].ShortName.NodeID, .Size = sizes[s], .Address = benchTx };
+		uint64_t min = UINT64_MAX, max = 0, sum = 0;
+		int lost = 0;
+		for (int r = 0; r < repeat; r++) {
+			//spread sending over network manager period
+			for (int phase = (r * 37) % (HARNESS_MANAGER / HARNESS_STEP); phase > 0; phase--)
+				harnessStep();
+			rxCount = 0;
+			rxWait = 1;
+			uint64_t start = VBus_Time();
+			if (LC_SendMessage(&nodes[0], &rec, BENCH_MSG + 1) != LC_Ok || harnessRun(harnessReceived, 100) == 0) {
+				lost++;
+				continue;
+			}
+			uint64_t latency = rxTime - start;
+			sum += latency;
+			if (latency < min)
+				min = latency;
+			if (latency > max)
+				max = latency;
+		}
+		int got = repeat - lost;
+		benchFailed += (lost && !benchLossy);
+		printf("{\"bench\":\"udp_latency\",\"size\":%u,\"count\":%d,\"lost\":%d,\"min_us\":%.1f,\"avg_us\":%.1f,\"max_us\":%.1f,\"cpu_ms\":%.1f}\n",
+				sizes[s], repeat, lost, got ? min / 1000.0 : 0, got ? sum / 1000.0 / got : 0, max / 1000.0, cpuMs(cpu));
+	}
+}
+
+void benchThroughput(void) {
+	const uint16_t sizes[] = { 16, 64, 256, 1024, 4096 };
+
+	benchBus(2, 0);
+	harnessRun(harnessOnline, 2000);
+	for (int tcp = 0; tcp < 2; tcp++)
+		for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+			clock_t cpu = clock();
+			LC_ObjectRecord_t rec = { .NodeID = nodes[1].ShortName.NodeID, .Size = sizes[s], .Address = benchTx, .Attributes.TCP = tcp };
+			int count = BENCH_FILE_SIZE / sizes[s];
+			int lost = 0;
+			VBus_Stats_t before, after;
+			VBus_GetStats(&before, 0, 0);
+			rxCount = 0;
+			rxErrors = 0;
+			//one message at time, next one sent as soon as previous received
+			for (int i = 0; i < count; i++) {
+				rxWait = rxCount + 1;
+				while (LC_SendMessage(&nodes[0], &rec, tcp ? BENCH_MSG : BENCH_MSG + 1) != LC_Ok)
+					harnessStep();
+				//lost UDP message is not repeated, give up after its own bus time
+				if (harnessRun(harnessReceived, tcp ? 2000 : 10 + sizes[s] / 16) == 0)
+					lost++;
+			}
+			VBus_GetStats(&after, 0, 0);
+			double seconds = (after.Time - before.Time) / 1e9;
+			uint64_t bytes = (uint64_t) (count - lost) * sizes[s];
+			benchFailed += ((lost || rxErrors) && (tcp || !benchLossy));
+			printf("{\"bench\":\"throughput\",\"protocol\":\"%s\",\"size\":%u,\"count\":%d,\"lost\":%d,\"errors\":%u,\"ms\":%.3f,"
+					"\"bytes_per_s\":%.0f,\"frames\":%u,\"error_frames\":%u,\"bus_load\":%.3f,\"efficiency\":%.3f,\"cpu_ms\":%.1f}\n",
+					tcp ? "tcp" : "udp", sizes[s], count, lost, rxErrors, seconds * 1000, bytes / seconds, after.Frames - before.Frames,
+					after.ErrorFrames - before.ErrorFrames, (double) (after.Busy - before.Busy) / (after.Time - before.Time),
+					bytes * 8.0 / (after.Bits - before.Bits), cpuMs(cpu));
+		}
+}
+
+void benchParameters(void) {
+	benchBus(2, 0);
+	harnessRun(harnessOnline, 2000);
+	clock_t cpu = clock();
+	uint64_t start = VBus_Time();
+	uint8_t server = nodes[1].ShortName.NodeID;
+	int directories = 0, entries = 0, errors = 0;
+	//same walk as configuration GUI does: directory info, then every entry of it
+	for (uint16_t d = 0;; d++) {
+		LCPC_Directory_t dir;
+		if (LCP_RequestDirectory(&nodes[0], server, d, &dir) != LC_Ok)
+			break;
+		directories++;
+		for (uint16_t e = 0; e < dir.Size; e++) {
+			LCPC_Entry_t entry;
+			if (LCP_RequestEntry(&nodes[0], server, d, e, &entry) == LC_Ok && entry.Name)
+				entries++;
+			else
+				errors++;
+			LCP_CleanEntry(&entry);
+		}
+		LCP_CleanDirectory(&dir);
+	}
+	double ms = (VBus_Time() - start) / 1e6;
+	benchFailed += ((errors || directories == 0) && !benchLossy);
+	printf("{\"bench\":\"parameters\",\"directories\":%d,\"entries\":%d,\"errors\":%d,\"ms\":%.3f,\"entry_ms\":%.3f,\"cpu_ms\":%.1f}\n", directories, entries,
+			errors, ms, entries ? ms / entries : 0, cpuMs(cpu));
+}
+
+void benchFiles(void) {
+	benchBus(2, 0);
+	harnessRun(harnessOnline, 2000);
+	uint8_t server = nodes[1].ShortName.NodeID;
+	for (int write = 1; write >= 0; write--) {
+		clock_t cpu = clock();
+		uint64_t start = VBus_Time();
+		uint32_t done = 0;
+		LC_FileResult_t result = LC_FileOpen(&nodes[0], "bench.bin", write ? LC_FA_Write | LC_FA_CreateAlways : LC_FA_Read, server);
+		if (result == LC_FR_Ok) {
+			if (write) {
+				//pattern repeated
+				for (uint32_t pos = 0; pos < BENCH_FILE_SIZE && result == LC_FR_Ok; pos += done)
+					result = LC_FileWrite(&nodes[0], benchTx, BENCH_MAX_PAYLOAD, &done);
+				done = (result == LC_FR_Ok) ? BENCH_FILE_SIZE : 0;
+			} else {
+				memset(benchRx, 0, sizeof(benchRx));
+				result = LC_FileRead(&nodes[0], benchRx, BENCH_FILE_SIZE, &done);
+				for (uint32_t pos = 0; pos < done && result == LC_FR_Ok; pos += BENCH_MAX_PAYLOAD)
+					if (memcmp(&benchRx[pos], benchTx, BENCH_MAX_PAYLOAD))
+						result = LC_FR_NetworkError;
+			}
+			LC_FileClose(&nodes[0], server);
+		}
+		double seconds = (VBus_Time() - start) / 1e9;
+		benchFailed += (result != LC_FR_Ok || done != BENCH_FILE_SIZE);
+		printf("{\"bench\":\"files\",\"operation\":\"%s\",\"bytes\":%u,\"result\":%d,\"ms\":%.3f,\"bytes_per_s\":%.0f,\"cpu_ms\":%.1f}\n",
+				write ? "write" : "read", done, result, seconds * 1000, seconds > 0 ? done / seconds : 0, cpuMs(cpu));
+	}
+}
+
+void benchRequests(void) {
+	benchBus(2, 0);
+	harnessRun(harnessOnline, 2000);
+	uint8_t server = nodes[1].ShortName.NodeID;
+	//sequential is what polling display does without sleeps, concurrent keeps all requests pending
+	for (int concurrent = 0; concurrent < 3; concurrent++) {
+		clock_t cpu = clock();
+		//third pass: node that doesn't exist, only timeout
+		int count = (concurrent < 2) ? BENCH_READABLE + 1 : 1;
+		uint8_t target = (concurrent < 2) ? server : server + 1;
+		memset((void*) requestStatus, 0, sizeof(requestStatus));
+		rxCount = 0;
+		rxErrors = 0;
+		uint64_t start = VBus_Time();
+		for (int i = 0; i < count; i++) {
+			LC_Request_t *request = &benchRequest[i];
+			request->Callback = benchResponse;
+			request->Context = (void*) (intptr_t) ((i < BENCH_READABLE) ? benchObjects[2 + i].Size : 0);
+			rxWait = concurrent ? count : rxCount + 1;
+			if (LC_SendRequestAsync(&nodes[0], request, target, BENCH_MSG + 2 + i, 100) != LC_Ok)
+				rxWait--;
+			if (concurrent == 0)
+				harnessRun(harnessReceived, 200);
+		}
+		harnessRun(harnessReceived, 200);
+		//every readable object answered, missing one reported, request to absent node times out
+		if (concurrent < 2)
+			benchFailed += (requestStatus[LC_Ok] != BENCH_READABLE || requestStatus[LC_ObjectError] != 1 || requestStatus[LC_Timeout] || rxErrors) && !benchLossy;
+		else
+			benchFailed += (requestStatus[LC_Timeout] != 1 || requestStatus[LC_Ok] || rxErrors) && !benchLossy;
+		printf("{\"bench\":\"requests\",\"mode\":\"%s\",\"count\":%d,\"ok\":%u,\"no_object\":%u,\"timeouts\":%u,\"errors\":%u,\"ms\":%.3f,"
+				"\"cpu_ms\":%.1f}\n", concurrent == 2 ? "timeout" : concurrent ? "concurrent" : "sequential", count, requestStatus[LC_Ok],
+				requestStatus[LC_ObjectError], requestStatus[LC_Timeout], rxErrors, (rxTime - start) / 1e6, cpuMs(cpu));
+	}
+}
+
+void benchAddressClaim(void) {
+	const uint8_t counts[] = { 2, 4, 8, 16 };
+
+	for (int sameID = 0; sameID < 2; sameID++)
+		for (unsigned c = 0; c < sizeof(counts) / sizeof(counts[0]) && counts[c] <= VBUS_PORTS; c++) {
+			clock_t cpu = clock();
+			benchBus(counts[c], sameID);
+			int ok = harnessRun(doneClaimed, 10000);
+			VBus_Stats_t stats;
+			VBus_GetStats(&stats, 0, 0);
+			benchFailed += !ok;
+			printf("{\"bench\":\"address_claim\",\"nodes\":%u,\"same_id\":%d,\"ok\":%d,\"ms\":%.3f,\"frames\":%u,\"error_frames\":%u,\"cpu_ms\":%.1f}\n",
+					counts[c], sameID, ok, stats.Time / 1e6, stats.Frames, stats.ErrorFrames, cpuMs(cpu));
+		}
+}
+
+//file server storage
+LC_FileResult_t lcfopen(void **file, char *name, LC_FileAccess_t mode) {
+	benchFile_t *found = 0, *empty = 0;
+	for (unsigned i = 0; i < sizeof(ramFiles) / sizeof(ramFiles[0]); i++) {
+		if (ramFiles[i].Name[0] == 0) {
+			if (empty == 0)
+				empty = &ramFiles[i];
+		} else if (strcmp(ramFiles[i].Name, name) == 0)
+			found = &ramFiles[i];
+	}
+	if (found == 0) {
+		if ((mode & (LC_FA_CreateNew | LC_FA_CreateAlways | LC_FA_OpenAlways)) == 0)
+			return LC_FR_NoFile;
+		if (empty == 0)
+			return LC_FR_TooManyOpenFiles;
+		found = empty;
+		strncpy(found->Name, name, sizeof(found->Name) - 1);
+	} else if (mode & LC_FA_CreateNew)
+		return LC_FR_Exist;
+	if (found->Open)
+		return LC_FR_Locked;
+	if (mode & LC_FA_CreateAlways)
+		found->Size = 0;
+	found->Position = ((mode & LC_FA_OpenAppend) == LC_FA_OpenAppend) ? found->Size : 0;
+	found->Open = 1;
+	*file = found;
+	return LC_FR_Ok;
+}
+
+LC_FileResult_t lcfclose(void *file) {
+	((benchFile_t*) file)->Open = 0;
+	return LC_FR_Ok;
+}
+
+LC_FileResult_t lcfread(void *file, char *buffer, uint32_t btr, uint32_t *br) {
+	benchFile_t *f = file;
+	if (btr > f->Size - f->Position)
+		btr = f->Size - f->Position;
+	memcpy(buffer, &f->Data[f->Position], btr);
+	f->Position += btr;
+	*br = btr;
+	return LC_FR_Ok;
+}
+
+LC_FileResult_t lcfwrite(void *file, const char *buffer, uint32_t btw, uint32_t *bw) {
+	benchFile_t *f = file;
+	*bw = 0;
+	if (f->Position + btw > f->Size) {
+		char *data = realloc(f->Data, f->Position + btw);
+		if (data == 0)
+			return LC_FR_Denied;
+		f->Data = data;
+		f->Size = f->Position + btw;
+	}
+	memcpy(&f->Data[f->Position], buffer, btw);
+	f->Position += btw;
+	*bw = btw;
+	return LC_FR_Ok;
+}
+
+LC_FileResult_t lcflseek(void *file, uint32_t position) {
+	benchFile_t *f = file;
+	f->Position = (position > f->Size) ? f->Size : position;
+	return LC_FR_Ok;
+}
+
+LC_FileResult_t lcftruncate(void *file) {
+	benchFile_t *f = file;
+	f->Size = f->Position;
+	return LC_FR_Ok;
+}
+
+uint32_t lcftell(void *file) {
+	return ((benchFile_t*) file)->Position;
+}
+
+uint32_t lcfsize(void *file) {
+	return ((benchFile_t*) file)->Size;
+}
+
+void LC_FileServerOnReceive(void) {
+	//LC_FileServer is called from harnessStep
+}
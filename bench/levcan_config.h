@@ -0,0 +1,85 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#pragma once
+
+//Benchmark configuration, single thread on hal/Virtual. Queues are cooperative: blocking receive
+//outside of managers advances simulated time, see levcan_bench.c
+
+//user functions for critical sections
+#define lc_enable_irq()
+#define lc_disable_irq()
+
+#define LC_EXPORT
+//Memory packing, compiler specific
+#define LEVCAN_PACKED __attribute__((packed))
+//platform specific, define how many bytes in uint8_t
+#define LEVCAN_MIN_BYTE_SIZE 1
+
+#define LEVCAN_USE_INT64
+#define LEVCAN_USE_DOUBLE
+#define LEVCAN_USE_FLOAT
+
+#define LEVCAN_FILECLIENT
+#define LEVCAN_FILESERVER
+#define LEVCAN_FILE_TIMEOUT 500
+#define LEVCAN_PARAMETERS_SERVER
+#define LEVCAN_PARAMETERS_CLIENT
+
+//Max own created nodes, one per virtual bus port
+#define LEVCAN_MAX_OWN_NODES 16
+//max saved nodes short names (used for search)
+#define LEVCAN_MAX_TABLE_NODES 64
+
+//Above-driver buffer size. Used to store CAN messages before calling network manager
+#define LEVCAN_TX_SIZE 64
+#define LEVCAN_RX_SIZE 256
+//CAN FD frame data length, build with -DLEVCAN_MAX_FRAME=64 to measure FD
+//#define LEVCAN_MAX_FRAME 64
+
+//Default size for malloc, data size for file i/o
+#define LEVCAN_OBJECT_DATASIZE 64
+#define LEVCAN_FILE_DATASIZE 512
+
+//external malloc functions
+#define lcmalloc malloc
+#define lcfree free
+#define lcdelay(ms) harnessWait(ms)
+void harnessWait(uint32_t ms);
+
+//parameter client and RTOS variant of file client need queues
+#define LEVCAN_USE_RTOS_QUEUE
+void* bench_queueCreate(uint16_t length, uint16_t itemSize);
+void bench_queueReset(void *queue);
+int bench_queueSend(void *queue, const void *item);
+int bench_queueReceive(void *queue, void *item, uint32_t ms);
+
+#define LC_QueueCreate(length, itemSize) bench_queueCreate(length, itemSize)
+#define LC_QueueDelete(queue) free(queue)
+#define LC_QueueReset(queue) bench_queueReset(queue)
+#define LC_QueueSendToBack(queue, buffer, ttwait) bench_queueSend(queue, buffer)
+#define LC_QueueSendToBackISR(queue, item, yieldNeeded) bench_queueSend(queue, item)
+#define LC_QueueReceive(queue, buffer, ttwait) bench_queueReceive(queue, buffer, ttwait)
+#define LC_RTOSYieldISR(yield) (void) (yield)
+#define YieldNeeded_t int
+
+//network manager task woken up for new TX work, runs in next harness step
+void harness_wakeup(void *node);
+#define LC_NetworkManagerWakeup(node) harness_wakeup(node)
+
+//file server storage, RAM files in levcan_bench.c
+#include "levcan_filedef.h"
+LC_FileResult_t lcfopen(void **file, char *name, LC_FileAccess_t mode);
+LC_FileResult_t lcfclose(void *file);
+LC_FileResult_t lcfread(void *file, char *buffer, uint32_t btr, uint32_t *br);
+LC_FileResult_t lcfwrite(void *file, const char *buffer, uint32_t btw, uint32_t *bw);
+LC_FileResult_t lcflseek(void *file, uint32_t position);
+LC_FileResult_t lcftruncate(void *file);
+uint32_t lcftell(void *file);
+uint32_t lcfsize(void *file);
+void LC_FileServerOnReceive(void);
@@ -0,0 +1,135 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include <string.h>
+#include "levcan.h"
+#include "levcan_objects.h"
+#include "levcan_harness.h"
+#ifdef LEVCAN_FILESERVER
+#include "levcan_fileserver.h"
+#endif
+
+//PUBLIC VARIABLES
+LC_NodeDescriptor_t nodes[VBUS_PORTS];
+int nodesSize;
+uint32_t harnessInside;
+volatile uint32_t rxCount, rxWait;
+
+//PRIVATE VARIABLES
+uint32_t harnessUs;
+uint8_t harnessWoken[VBUS_PORTS]; //LC_NetworkManagerWakeup called, manager runs without waiting for period
+
+/// Restarts virtual bus without nodes
+/// @param config
+void harnessBus(const VBus_Config_t *config) {
+	//previous nodes are just abandoned, there is no node delete call
+	VBus_Init(config);
+	harnessUs = 0;
+	nodesSize = 0;
+	memset(harnessWoken, 0, sizeof(harnessWoken));
+}
+
+/// Attaches node to virtual bus with debug device short name. Caller sets ID, objects and services, then LC_CreateNode
+/// @param index Node in nodes[]
+/// @param name
+/// @param serial First serial number word
+/// @return Bus port
+int harnessNode(int index, const char *name, uint32_t serial) {
+	LC_NodeDescriptor_t *node = &nodes[index];
+	memset(node, 0, sizeof(LC_NodeDescriptor_t));
+	LC_InitNodeDescriptor(node);
+	int port = VBus_Attach(node);
+	node->NodeName = (char*) name;
+	node->ShortName.ManufacturerCode = 0x1BC;
+	node->ShortName.DeviceType = LC_Device_Debug;
+	node->Serial[0] = serial;
+	if (index >= nodesSize)
+		nodesSize = index + 1;
+	return port;
+}
+
+/// @param node
+/// @return Index in nodes[], -1 if node is not from harness
+int harnessIndex(void *node) {
+	int index = (LC_NodeDescriptor_t*) node - nodes;
+	if (index < 0 || index >= VBUS_PORTS)
+		return -1;
+	return index;
+}
+
+/// One receive managers period, network managers called every HARNESS_MANAGER or right after wakeup
+void harnessStep(void) {
+	harnessInside++;
+	VBus_Run(HARNESS_STEP);
+	for (int i = 0; i < nodesSize; i++)
+		LC_ReceiveManager(&nodes[i]);
+	harnessUs += HARNESS_STEP;
+	if (harnessUs >= HARNESS_MANAGER) {
+		harnessUs -= HARNESS_MANAGER;
+		for (int i = 0; i < nodesSize; i++) {
+			harnessWoken[i] = 0;
+			LC_NetworkManager(&nodes[i], HARNESS_MANAGER / 1000);
+#ifdef LEVCAN_FILESERVER
+			if (nodes[i].ShortName.FileServer)
+				LC_FileServer(&nodes[i], HARNESS_MANAGER / 1000);
+#endif
+		}
+	} else {
+		for (int i = 0; i < nodesSize; i++) {
+			if (harnessWoken[i] == 0)
+				continue;
+			harnessWoken[i] = 0;
+			LC_NetworkManager(&nodes[i], 0);
+		}
+	}
+	harnessInside--;
+}
+
+/// Advances simulation till condition or timeout
+/// @param done Condition
+/// @param ms Timeout
+/// @return 1 if done
+int harnessRun(int (*done)(void), uint32_t ms) {
+	for (uint64_t end = VBus_Time() + (uint64_t) ms * 1000000; VBus_Time() < end;) {
+		if (done())
+			return 1;
+		harnessStep();
+	}
+	return done();
+}
+
+/// Advances simulation, returns at once if called from managers
+/// @param ms
+void harnessWait(uint32_t ms) {
+	if (harnessInside)
+		return;
+	for (uint32_t i = 0; i < ms * 1000 / HARNESS_STEP; i++)
+		harnessStep();
+}
+
+/// @return 1 if every node is online
+int harnessOnline(void) {
+	for (int i = 0; i < nodesSize; i++)
+		if (nodes[i].State != LCNodeState_Online)
+			return 0;
+	return 1;
+}
+
+/// @return 1 if rxCount reached rxWait
+int harnessReceived(void) {
+	return rxCount >= rxWait;
+}
+
+/// Network manager task notification, see LC_NetworkManagerWakeup
+/// @param node
+void harness_wakeup(void *node) {
+	int index = harnessIndex(node);
+	if (index >= 0)
+		harnessWoken[index] = 1;
+}
+
+/// Simulated ms counter for LEVCAN_CLOCK
+/// @return ms since bus start
+uint32_t harness_clock(void) {
+	return VBus_Time() / 1000000;
+}
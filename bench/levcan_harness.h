@@ -0,0 +1,31 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "levcan.h"
+#include "can_hal.h"
+
+//Virtual bus harness shared by levcan_bench, levcan_check and levcan_sim: node table, fixed step run of
+//receive and network managers, network manager wakeup and simulated clock. Compiled with config of each tool.
+
+//receive managers period, us
+#define HARNESS_STEP 10
+//network manager and file server period, us
+#define HARNESS_MANAGER 1000
+
+extern LC_NodeDescriptor_t nodes[VBUS_PORTS];
+extern int nodesSize;
+extern uint32_t harnessInside; //managers running, cooperative waits return at once
+extern volatile uint32_t rxCount, rxWait;
+
+void harnessBus(const VBus_Config_t *config);
+int harnessNode(int index, const char *name, uint32_t serial);
+int harnessIndex(void *node);
+void harnessStep(void);
+int harnessRun(int (*done)(void), uint32_t ms);
+void harnessWait(uint32_t ms);
+int harnessOnline(void);
+int harnessReceived(void);
+void harness_wakeup(void *node);
+uint32_t harness_clock(void);
@@ -0,0 +1,45 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#pragma once
+
+//Micro-benchmark configuration: default bare-metal paths, lock-free RX FIFO and dynamic memory.
+//Same file can be used for Cortex-M build, replace critical sections and malloc
+
+//user functions for critical sections
+#define lc_enable_irq()
+#define lc_disable_irq()
+
+#define LC_EXPORT
+//Memory packing, compiler specific
+#define LEVCAN_PACKED __attribute__((packed))
+//platform specific, define how many bytes in uint8_t
+#define LEVCAN_MIN_BYTE_SIZE 1
+
+#define LEVCAN_USE_INT64
+#define LEVCAN_USE_DOUBLE
+#define LEVCAN_USE_FLOAT
+#define LEVCAN_PARAMETERS_SERVER
+
+//Max own created nodes
+#define LEVCAN_MAX_OWN_NODES 1
+//max saved nodes short names (used for search)
+#define LEVCAN_MAX_TABLE_NODES 64
+
+//Above-driver buffer size. Used to store CAN messages before calling network manager
+#define LEVCAN_TX_SIZE 64
+#define LEVCAN_RX_SIZE 256
+
+//Default size for malloc, data size for file i/o
+#define LEVCAN_OBJECT_DATASIZE 64
+#define LEVCAN_FILE_DATASIZE 512
+
+//external malloc functions
+#define lcmalloc malloc
+#define lcfree free
+#define lcdelay(ms)
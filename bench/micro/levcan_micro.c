@@ -0,0 +1,410 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "levcan.h"
+#include "levcan_paramserver.h"
+#include "levcan_slab.h"
+
+//Micro-benchmarks of protocol inner loops. Every kernel is timed alone, untimed setup runs between
+//samples; after warmup MICRO_SAMPLES samples are sorted and printed per operation as JSON line:
+//{"bench":"find_object","transfers":10,"ops":64,"unit":"ns","min":..,"p50":..,"p90":..,"p99":..,"max":..,"mean":..}
+//Counter read overhead, median of empty kernel, is subtracted.
+//Cortex-M: build with -DMICRO_CYCLES="DWT->CYCCNT" -DMICRO_UNIT=\"cycles\" -DMICRO_NO_MAIN, enable DWT
+//cycle counter and call LC_MicroRun() from firmware, printf should be retargeted
+
+#ifndef MICRO_CYCLES
+#include <time.h>
+#define MICRO_CYCLES microNanoseconds()
+#define MICRO_UNIT "ns"
+uint32_t microNanoseconds(void);
+#endif
+#ifndef MICRO_UNIT
+#define MICRO_UNIT "cycles"
+#endif
+#ifndef MICRO_SAMPLES
+#define MICRO_SAMPLES 201
+#endif
+#ifndef MICRO_WARMUP
+#define MICRO_WARMUP 20
+#endif
+#define MICRO_LOOKUPS 64
+#define MICRO_OBJECTS 500
+#define MICRO_TRANSFERS 100
+#define MICRO_FRAMES 64
+#define MICRO_MSG 0x200
+
+typedef uint32_t (*microKernel_t)(uint32_t param);
+typedef void (*microSetup_t)(uint32_t param);
+
+//PRIVATE FUNCTIONS
+void microMeasure(const char *name, const char *paramName, uint32_t param, microSetup_t setup, microKernel_t kernel);
+void microPrint(uint32_t value100);
+int microCompare(const void *a, const void *b);
+void microNode(void);
+uint32_t kernelEmpty(uint32_t param);
+uint32_t kernelHeaderPack(uint32_t param);
+uint32_t kernelHeaderUnpack(uint32_t param);
+void setupReceiveHandler(uint32_t param);
+uint32_t kernelReceiveHandler(uint32_t param);
+void setupReceiveManager(uint32_t param);
+uint32_t kernelReceiveManager(uint32_t param);
+void setupFindObjectRecord(uint32_t param);
+void setupFindObjectLinear(uint32_t param);
+uint32_t kernelFindObjectRecord(uint32_t param);
+void setupFindObject(uint32_t param);
+uint32_t kernelFindObject(uint32_t param);
+void setupTX(uint32_t param);
+uint32_t kernelTX(uint32_t param);
+void setupRX(uint32_t param);
+uint32_t kernelRX(uint32_t param);
+uint32_t kernelParse(uint32_t param);
+uint32_t kernelPrint(uint32_t param);
+void LC_MicroRun(void);
+
+//EXTERN FUNCTIONS
+extern LC_ObjectRecord_t findObjectRecord(LC_NodeDescriptor_t *node, uint16_t messageID, int32_t size, uint8_t read_write, uint8_t nodeID);
+extern void indexPublish(LC_NodeDescriptor_t *node, lc_objIndex_t *index);
+extern lc_objBuffered* findObject(LC_NodeDescriptor_t *node, uint8_t direction, uint16_t msgID, uint8_t target, uint8_t source);
+extern void insertObject(LC_NodeDescriptor_t *node, lc_objBuffered *obj, uint8_t direction);
+extern uint16_t objectTXproceed(LC_NodeDescriptor_t *node, lc_objBuffered *object, lc_msgBuffered *request, int timeout);
+extern uint16_t objectRXproceed(LC_NodeDescriptor_t *node, lc_objBuffered *object, lc_msgBuffered *msg);
+
+//PRIVATE VARIABLES
+uint32_t microSamples[MICRO_SAMPLES];
+uint32_t microOverhead;
+volatile uint32_t microSink;
+
+LC_Return_t microSend(LC_HeaderPacked_t header, uint32_t *data, uint8_t length) {
+	return LC_Ok;
+}
+uint16_t microSendBatch(const lc_msgBuffered *frames, uint16_t count) {
+	return count;
+}
+LC_Return_t microFilter(LC_HeaderPacked_t *reg, LC_HeaderPacked_t *mask, uint16_t count) {
+	return LC_Ok;
+}
+LC_Return_t microTxHalfFull(void) {
+	return LC_BufferEmpty;
+}
+const LC_DriverCalls_t microDriver = { microSend, microFilter, microTxHalfFull, microSendBatch };
+
+LC_NodeDescriptor_t microNodeData;
+LC_Object_t microObjects[MICRO_OBJECTS];
+uint32_t microVariable;
+char microRxBuffer[MICRO_FRAMES * LEVCAN_MAX_FRAME];
+char microTxBuffer[MICRO_FRAMES * LEVCAN_MAX_FRAME];
+lc_objBuffered microTransfers[MICRO_TRANSFERS];
+lc_objBuffered microTransfer;
+lc_msgBuffered microFrames[MICRO_FRAMES];
+LC_HeaderPacked_t microHeaders[MICRO_LOOKUPS];
+
+uint32_t paramU32;
+int32_t paramDecimal;
+float paramFloat;
+uint32_t paramEnum;
+uint8_t paramBool;
+// @formatter:off
+const LCPS_Entry_t microEntries[] = {
+		pstd(LCP_AccessLvl_Any, LCP_Normal, paramU32, ((LCP_Uint32_t ) { 0, 100000, 1 }), "Speed limit", "%u km/h"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, paramDecimal, ((LCP_Decimal32_t ) { 0, 60000, 10, 3 }), "Battery cutoff", "%s V"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, paramFloat, ((LCP_Float_t ) { -10, 100, 0.5 }), "Pressure scale", "%.1f Nm/V"),
+		pstd(LCP_AccessLvl_Any, LCP_Normal, paramEnum, ((LCP_Enum_t ) { 0, 4 }), "Mode", "Off\nEco\nNormal\nSport"),
+		pbool(LCP_AccessLvl_Any, LCP_Normal, paramBool, "Lights", 0),
+};
+// @formatter:on
+const LCPS_Directory_t microDirectory = directory(microEntries, 0, LCP_AccessLvl_Any, "Micro");
+const char *microValues[] = { "12345", "48.250", "12.5", "Normal", "ON" };
+const char *microTypes[] = { "uint32", "decimal32", "float", "enum", "bool" };
+
+#ifndef MICRO_NO_MAIN
+int main(void) {
+	LC_MicroRun();
+	return 0;
+}
+
+uint32_t microNanoseconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t) now.tv_sec * 1000000000u + now.tv_nsec;
+}
+#endif
+
+/// Runs all kernels, results printed as JSON lines
+void LC_MicroRun(void) {
+	const uint16_t objects[] = { 10, 50, 100, 500 };
+	const uint16_t transfers[] = { 1, 10, 50, 100 };
+
+	microNode();
+	microOverhead = 0;
+	microMeasure("overhead", 0, 0, 0, kernelEmpty);
+	microOverhead = microSamples[MICRO_SAMPLES / 2];
+
+	microMeasure("header_pack", 0, 0, 0, kernelHeaderPack);
+	microMeasure("header_unpack", 0, 0, 0, kernelHeaderUnpack);
+	microMeasure("receive_handler", 0, 0, setupReceiveHandler, kernelReceiveHandler);
+	microMeasure("receive_manager", 0, 0, setupReceiveManager, kernelReceiveManager);
+	for (unsigned i = 0; i < sizeof(objects) / sizeof(objects[0]); i++)
+		microMeasure("find_object_record", "objects", objects[i], setupFindObjectRecord, kernelFindObjectRecord);
+	//same without MsgID index, linear search
+	for (unsigned i = 0; i < sizeof(objects) / sizeof(objects[0]); i++)
+		microMeasure("find_object_record_linear", "objects", objects[i], setupFindObjectLinear, kernelFindObjectRecord);
+	microNodeData.ObjectsSize = 10;
+	LC_UpdateObjectIndex(&microNodeData);
+	for (unsigned i = 0; i < sizeof(transfers) / sizeof(transfers[0]); i++)
+		microMeasure("find_object", "transfers", transfers[i], setupFindObject, kernelFindObject);
+	for (uint32_t tcp = 0; tcp < 2; tcp++) {
+		microMeasure("object_tx_proceed", "tcp", tcp, setupTX, kernelTX);
+		microMeasure("object_rx_proceed", "tcp", tcp, setupRX, kernelRX);
+	}
+	for (uint32_t i = 0; i < microDirectory.Size; i++) {
+		microMeasure("parse_parameter_value", "entry", i, 0, kernelParse);
+		microMeasure("print_param", "entry", i, 0, kernelPrint);
+	}
+}
+
+/// Times kernel MICRO_WARMUP + MICRO_SAMPLES times, prints percentiles per operation
+/// @param name Bench name
+/// @param paramName Parameter name for output, 0 - no parameter
+/// @param param Passed to setup and kernel
+/// @param setup Called before every kernel call, not timed. Can be 0
+/// @param kernel Returns operations done
+void microMeasure(const char *name, const char *paramName, uint32_t param, microSetup_t setup, microKernel_t kernel) {
+	uint32_t ops = 1;
+	uint64_t sum = 0;
+
+	for (int i = -MICRO_WARMUP; i < MICRO_SAMPLES; i++) {
+		if (setup)
+			setup(param);
+		uint32_t start = MICRO_CYCLES;
+		ops = kernel(param);
+		uint32_t time = MICRO_CYCLES - start;
+		time = (time > microOverhead) ? time - microOverhead : 0;
+		if (i >= 0)
+			microSamples[i] = time;
+	}
+	qsort(microSamples, MICRO_SAMPLES, sizeof(microSamples[0]), microCompare);
+	for (int i = 0; i < MICRO_SAMPLES; i++)
+		sum += microSamples[i];
+	if (ops == 0)
+		ops = 1;
+
+	printf("{\"bench\":\"%s\",", name);
+	if (paramName)
+		printf("\"%s\":%lu,", paramName, (unsigned long) param);
+	if (kernel == kernelParse || kernel == kernelPrint)
+		printf("\"type\":\"%s\",", microTypes[param]);
+	printf("\"ops\":%lu,\"samples\":%d,\"unit\":\"%s\"", (unsigned long) ops, MICRO_SAMPLES, MICRO_UNIT);
+	//nearest rank percentiles
+	const char *names[] = { "min", "p50", "p90", "p99", "max" };
+	const uint16_t ranks[] = { 0, 50, 90, 99, 100 };
+	for (int i = 0; i < 5; i++) {
+		printf(",\"%s\":", names[i]);
+		microPrint((uint64_t) microSamples[(MICRO_SAMPLES - 1) * ranks[i] / 100] * 100 / ops);
+	}
+	printf(",\"mean\":");
+	microPrint(sum * 100 / MICRO_SAMPLES / ops);
+	printf("}\n");
+}
+
+/// Fixed point output, no float printf needed on MCU
+/// @param value100 Value * 100
+void microPrint(uint32_t value100) {
+	printf("%lu.%02lu", (unsigned long) (value100 / 100), (unsigned long) (value100 % 100));
+}
+
+int microCompare(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+	return (x > y) - (x < y);
+}
+
+/// Online node on dummy driver, every frame sent is accepted at once
+void microNode(void) {
+	LC_NodeDescriptor_t *node = &microNodeData;
+	LC_InitNodeDescriptor(node);
+	node->Driver = &microDriver;
+	node->ShortName.NodeID = 10;
+	node->Serial[0] = 1;
+	for (int i = 0; i < MICRO_OBJECTS; i++) {
+		microObjects[i].MsgID = MICRO_MSG + i * 3;
+		microObjects[i].Attributes.Writable = 1;
+		microObjects[i].Attributes.Readable = 1;
+		microObjects[i].Size = sizeof(microVariable);
+		microObjects[i].Address = &microVariable;
+	}
+	//multi-frame target
+	microObjects[0].Size = sizeof(microRxBuffer);
+	microObjects[0].Address = microRxBuffer;
+	node->Objects = microObjects;
+	node->ObjectsSize = 10;
+	LC_CreateNode(node);
+	node->State = LCNodeState_Online;
+	for (int i = 0; i < MICRO_LOOKUPS; i++) {
+		LC_Header_t header = { .MsgID = MICRO_MSG + i, .Source = 20 + i % 50, .Target = 10, .Priority = i & 3, .RTS_CTS = 1, .EoM = 1 };
+		microHeaders[i] = LC_HeaderPack(header);
+	}
+	for (int i = 0; i < (int) sizeof(microTxBuffer); i++)
+		microTxBuffer[i] = i;
+}
+
+uint32_t kernelEmpty(uint32_t param) {
+	return 1;
+}
+
+uint32_t kernelHeaderPack(uint32_t param) {
+	uint32_t sink = 0;
+	for (int i = 0; i < MICRO_LOOKUPS; i++) {
+		LC_Header_t header = { .MsgID = MICRO_MSG + i, .Source = i, .Target = 10, .Priority = i & 3, .EoM = i & 1 };
+		sink += LC_HeaderPack(header).ToUint32;
+	}
+	microSink = sink;
+	return MICRO_LOOKUPS;
+}
+
+uint32_t kernelHeaderUnpack(uint32_t param) {
+	uint32_t sink = 0;
+	for (int i = 0; i < MICRO_LOOKUPS; i++)
+		sink += LC_HeaderUnpack(microHeaders[i]).MsgID;
+	microSink = sink;
+	return MICRO_LOOKUPS;
+}
+
+void setupReceiveHandler(uint32_t param) {
+	microNodeData.TxRxObjects.rxFIFO_in = 0;
+	microNodeData.TxRxObjects.rxFIFO_out = 0;
+}
+
+uint32_t kernelReceiveHandler(uint32_t param) {
+	uint32_t data[2] = { 1, 2 };
+	//single frame UDP, interrupt side only
+	for (int i = 0; i < MICRO_LOOKUPS; i++)
+		LC_ReceiveHandler(&microNodeData, microHeaders[i], data, 4);
+	return MICRO_LOOKUPS;
+}
+
+void setupReceiveManager(uint32_t param) {
+	setupReceiveHandler(param);
+	uint32_t data[2] = { 1, 2 };
+	for (int i = 0; i < MICRO_LOOKUPS; i++) {
+		LC_HeaderPacked_t header = microHeaders[i];
+		header.MsgID = MICRO_MSG + (i % 10) * 3;
+		LC_ReceiveHandler(&microNodeData, header, data, 4);
+	}
+}
+
+uint32_t kernelReceiveManager(uint32_t param) {
+	//dispatch of single frame messages to dictionary
+	LC_ReceiveManager(&microNodeData);
+	return MICRO_LOOKUPS;
+}
+
+void setupFindObjectRecord(uint32_t param) {
+	microNodeData.ObjectsSize = param;
+	LC_UpdateObjectIndex(&microNodeData);
+}
+
+void setupFindObjectLinear(uint32_t param) {
+	microNodeData.ObjectsSize = param;
+	LC_UpdateObjectIndex(&microNodeData);
+	//as if index didn't fit
+	indexPublish(&microNodeData, 0);
+}
+
+uint32_t kernelFindObjectRecord(uint32_t param) {
+	uint32_t sink = 0;
+	for (uint32_t i = 0; i < MICRO_LOOKUPS; i++) {
+		uint16_t index = (i * 37) % param;
+		//1 - write, received data
+		sink += (intptr_t) findObjectRecord(&microNodeData, MICRO_MSG + index * 3, sizeof(microVariable), 1, 20).Address;
+	}
+	microSink = sink;
+	return MICRO_LOOKUPS;
+}
+
+void setupFindObject(uint32_t param) {
+	LC_NodeDescriptor_t *node = &microNodeData;
+	node->TxRxObjects.objRXbuf_start = 0;
+	node->TxRxObjects.objRXbuf_end = 0;
+	memset(node->TxRxObjects.objRXhash, 0, sizeof(node->TxRxObjects.objRXhash));
+	for (uint32_t i = 0; i < param; i++) {
+		lc_objBuffered *obj = &microTransfers[i];
+		memset(obj, 0, sizeof(lc_objBuffered));
+		obj->Header.MsgID = MICRO_MSG + i % 10;
+		obj->Header.Source = 20 + i / 10;
+		obj->Header.Target = 10;
+		insertObject(node, obj, LC_RX);
+	}
+}
+
+uint32_t kernelFindObject(uint32_t param) {
+	uint32_t sink = 0;
+	for (uint32_t i = 0; i < MICRO_LOOKUPS; i++) {
+		uint32_t k = (i * 37) % param;
+		sink += (intptr_t) findObject(&microNodeData, LC_RX, MICRO_MSG + k % 10, 10, 20 + k / 10);
+	}
+	microSink = sink;
+	return MICRO_LOOKUPS;
+}
+
+void setupTX(uint32_t param) {
+	lc_objBuffered *obj = &microTransfer;
+	memset(obj, 0, sizeof(lc_objBuffered));
+	obj->Header.MsgID = MICRO_MSG;
+	obj->Header.Source = 10;
+	obj->Header.Target = 20;
+	obj->Pointer = microTxBuffer;
+	obj->Length = sizeof(microTxBuffer);
+	obj->FrameSize = LEVCAN_MAX_FRAME;
+	obj->Flags.TCP = param;
+	obj->Credits = UINT8_MAX;
+}
+
+uint32_t kernelTX(uint32_t param) {
+	//UDP sends bursts, TCP a frame per call as if every CTS came in time
+	while (microTransfer.Header.EoM == 0)
+		objectTXproceed(&microNodeData, &microTransfer, 0, 0);
+	return MICRO_FRAMES;
+}
+
+void setupRX(uint32_t param) {
+	lc_objBuffered *obj = &microTransfer;
+	memset(obj, 0, sizeof(lc_objBuffered));
+	obj->Header.MsgID = MICRO_MSG;
+	obj->Header.Source = 20;
+	obj->Header.Target = 10;
+	obj->Length = sizeof(microRxBuffer);
+	obj->Pointer = lc_slabAlloc(obj->Length);
+	obj->FrameSize = LEVCAN_MAX_FRAME;
+	obj->Flags.TCP = param;
+	for (int i = 0; i < MICRO_FRAMES; i++) {
+		lc_msgBuffered *msg = &microFrames[i];
+		msg->header = obj->Header;
+		msg->header.RTS_CTS = (i == 0);
+		msg->header.EoM = (i == MICRO_FRAMES - 1);
+		msg->header.Parity = param ? (~i & 1) : 0;
+		msg->length = LEVCAN_MAX_FRAME;
+		memcpy(msg->data, &microTxBuffer[i * LEVCAN_MAX_FRAME], LEVCAN_MAX_FRAME);
+	}
+}
+
+uint32_t kernelRX(uint32_t param) {
+	//last frame delivers message to dictionary, TCP sends CTS for every frame
+	for (int i = 0; i < MICRO_FRAMES; i++)
+		objectRXproceed(&microNodeData, &microTransfer, &microFrames[i]);
+	return MICRO_FRAMES;
+}
+
+uint32_t kernelParse(uint32_t param) {
+	char *end;
+	LCP_ParseParameterValue(&microEntries[param], 0, microValues[param], &end);
+	return 1;
+}
+
+uint32_t kernelPrint(uint32_t param) {
+	char buffer[256];
+	LCP_PrintParam(buffer, &microDirectory, param);
+	microSink = buffer[0];
+	return 1;
+}
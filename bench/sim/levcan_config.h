@@ -0,0 +1,54 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#pragma once
+
+//Network simulator configuration: bare-metal paths, dynamic memory, node table for full network
+//and trace ring used to count address claim events
+
+//user functions for critical sections
+#define lc_enable_irq()
+#define lc_disable_irq()
+
+#define LC_EXPORT
+//Memory packing, compiler specific
+#define LEVCAN_PACKED __attribute__((packed))
+//platform specific, define how many bytes in uint8_t
+#define LEVCAN_MIN_BYTE_SIZE 1
+
+#define LEVCAN_USE_INT64
+#define LEVCAN_USE_DOUBLE
+#define LEVCAN_USE_FLOAT
+
+//Max own created nodes
+#define LEVCAN_MAX_OWN_NODES 1
+//max saved nodes short names (used for search), every other node of 126 addresses
+#define LEVCAN_MAX_TABLE_NODES 128
+
+//Above-driver buffer size. Used to store CAN messages before calling network manager
+#define LEVCAN_TX_SIZE 64
+#define LEVCAN_RX_SIZE 256
+
+//Default size for malloc, data size for file i/o
+#define LEVCAN_OBJECT_DATASIZE 64
+#define LEVCAN_FILE_DATASIZE 512
+
+//Address claim events are read from trace ring after every manager call
+#define LEVCAN_TRACE_SIZE 256
+
+//external malloc functions
+#define lcmalloc malloc
+#define lcfree free
+#define lcdelay(ms)
+
+//tickless nodes are scheduled by simulator
+void sim_wakeup(void *node);
+#define LC_NetworkManagerWakeup(node) sim_wakeup(node)
+//simulated time in ms, stamps frames received while tickless node sleeps
+uint32_t harness_clock(void);
+#define LEVCAN_CLOCK() harness_clock()
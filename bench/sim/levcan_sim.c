@@ -0,0 +1,477 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "levcan.h"
+#include "levcan_objects.h"
+#include "levcan_trace.h"
+#include "can_hal.h"
+#include "levcan_harness.h"
+
+//Discrete-event simulator of a large network on hal/Virtual. Nodes power up together and run on virtual clock:
+//simulation jumps from one event to next - frame end on bus, network manager call, power up or sample,
+//so idle time costs nothing and minutes of network life take seconds. Received frames go to receive manager
+//at frame end, network managers get simulated time passed since their previous call.
+//Address claim and node table events are counted from each node trace ring. Output is JSON lines:
+//{"sim":"config",...}, {"sim":"window",...} with -v, {"sim":"result",...}
+//Usage: levcan_sim [-n nodes] [-t seconds] [-s power up spread ms] [-p manager period ms, 0 - tickless]
+//                  [-i hash|same|unique] [-b bitrate] [-l loss] [-e errors] [-r seed] [-v]
+
+#ifndef SIM_VERSION
+#define SIM_VERSION "unknown"
+#endif
+#define SIM_MAX_NODES 125
+//convergence check period till network converged, ns
+#define SIM_CHECK 10000000ULL
+//after convergence, ns
+#define SIM_CHECK_STABLE 1000000000ULL
+//bus load window, ns
+#define SIM_WINDOW 100000000ULL
+#define SIM_MS 1000000ULL
+
+typedef enum {
+	simPowerUp, simManager, simCheck, simWindow
+} simEventType_t;
+
+typedef struct {
+	uint64_t Time; //ns
+	uint32_t Order; //insertion order, equal times are handled first in first out
+	uint32_t Generation; //simManager, stale if node rescheduled since
+	uint16_t Node;
+	uint8_t Type;
+} simEvent_t;
+
+typedef enum {
+	simIDHash, simIDSame, simIDUnique
+} simIDMode_t;
+
+typedef struct {
+	uint64_t PowerAt; //ns
+	uint64_t LastManager; //ns, simulated time already given to network manager
+	uint64_t NextManager; //ns, UINT64_MAX - not scheduled
+	uint64_t OnlineAt; //ns, first time online
+	uint32_t Generation;
+	uint32_t FramesRX; //receive manager runs when node statistics change
+	uint32_t TraceHead; //records counted
+	uint8_t Powered;
+} simNode_t;
+
+//PRIVATE FUNCTIONS
+void simPush(uint64_t time, uint8_t type, uint16_t node, uint32_t generation);
+simEvent_t simPop(void);
+int simBefore(const simEvent_t *a, const simEvent_t *b);
+void simPowerOn(int index);
+void simManagerCall(int index);
+void simSchedule(int index, uint64_t time);
+void simReceive(void);
+void simTrace(int index);
+int simConverged(void);
+void simCheckEvent(void);
+void simWindowEvent(void);
+uint32_t simRandom(void);
+double cpuMs(clock_t start);
+
+//PRIVATE VARIABLES
+VBus_Config_t simConfig = { .Bitrate = 1000000, .AutoRecovery = 1 };
+VBus_Faults_t simFaults;
+uint32_t simNodesCount = SIM_MAX_NODES;
+uint32_t simSeconds = 600;
+uint32_t simSpread = 10; //ms
+uint32_t simPeriod = 10; //ms, 0 - LC_NetworkManagerTickless
+simIDMode_t simIDMode = simIDHash;
+uint32_t simSeed = 1;
+uint8_t simVerbose;
+
+simNode_t simNodes[SIM_MAX_NODES];
+
+simEvent_t *simHeap;
+uint32_t simHeapSize, simHeapCapacity, simOrder;
+uint32_t simRandomState;
+
+//results
+uint32_t simEvents[LC_TraceEvents];
+uint32_t simEventsStable[LC_TraceEvents]; //after convergence
+uint32_t simTraceLost;
+uint64_t simConvergedAt; //0 - not yet
+uint32_t simNoID; //nodes left without address when converged
+uint64_t simWindowBusy, simPeakBusy, simClaimBusy;
+uint64_t simManagerCalls, simReceiveCalls;
+
+int main(int argc, char **argv) {
+	int opt;
+	while ((opt = getopt(argc, argv, "n:t:s:p:i:b:l:e:r:v")) != -1) {
+		switch (opt) {
+		case 'n':
+			simNodesCount = atoi(optarg);
+			break;
+		case 't':
+			simSeconds = atoi(optarg);
+			break;
+		case 's':
+			simSpread = atoi(optarg);
+			break;
+		case 'p':
+			simPeriod = atoi(optarg);
+			break;
+		case 'i':
+			if (strcmp(optarg, "same") == 0)
+				simIDMode = simIDSame;
+			else if (strcmp(optarg, "unique") == 0)
+				simIDMode = simIDUnique;
+			else
+				simIDMode = simIDHash;
+			break;
+		case 'b':
+			simConfig.Bitrate = atoi(optarg);
+			break;
+		case 'l':
+			simFaults.Loss = atof(optarg);
+			break;
+		case 'e':
+			simFaults.Errors = atof(optarg);
+			break;
+		case 'r':
+			simSeed = atoi(optarg);
+			break;
+		case 'v':
+			simVerbose = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n nodes] [-t seconds] [-s spread ms] [-p period ms] [-i hash|same|unique] [-b bitrate] [-l loss] [-e errors] [-r seed] [-v]\n",
+					argv[0]);
+			return 2;
+		}
+	}
+	if (simNodesCount < 2 || simNodesCount > SIM_MAX_NODES) {
+		fprintf(stderr, "nodes 2..%d\n", SIM_MAX_NODES);
+		return 2;
+	}
+	const char *const modes[] = { "hash", "same", "unique" };
+	printf("{\"sim\":\"config\",\"version\":\"%s\",\"nodes\":%u,\"seconds\":%u,\"spread_ms\":%u,\"period_ms\":%u,\"id\":\"%s\",\"bitrate\":%u,"
+			"\"loss\":%g,\"errors\":%g,\"seed\":%u}\n", SIM_VERSION, simNodesCount, simSeconds, simSpread, simPeriod, modes[simIDMode], simConfig.Bitrate,
+			simFaults.Loss, simFaults.Errors, simSeed);
+
+	clock_t cpu = clock();
+	simRandomState = simSeed ? simSeed : 1;
+	simConfig.Seed = simRandom();
+	harnessBus(&simConfig);
+	for (uint32_t i = 0; i < simNodesCount; i++) {
+		simNodes[i].PowerAt = (simSpread ? simRandom() % (simSpread * 1000) : 0) * 1000ULL;
+		simNodes[i].NextManager = UINT64_MAX;
+		simPush(simNodes[i].PowerAt, simPowerUp, i, 0);
+	}
+	simPush(SIM_CHECK, simCheck, 0, 0);
+	simPush(SIM_WINDOW, simWindow, 0, 0);
+
+	//event loop, bus events go first
+	uint64_t end = (uint64_t) simSeconds * 1000 * SIM_MS;
+	while (1) {
+		uint64_t bus = VBus_NextEvent();
+		if (bus <= simHeap[0].Time && bus <= end) {
+			VBus_RunUntil(bus);
+			simReceive();
+			continue;
+		}
+		if (simHeap[0].Time > end)
+			break;
+		simEvent_t event = simPop();
+		VBus_RunUntil(event.Time);
+		switch (event.Type) {
+		case simPowerUp:
+			simPowerOn(event.Node);
+			break;
+		case simManager:
+			if (event.Generation == simNodes[event.Node].Generation)
+				simManagerCall(event.Node);
+			break;
+		case simCheck:
+			simCheckEvent();
+			break;
+		case simWindow:
+			simWindowEvent();
+			break;
+		}
+	}
+	VBus_RunUntil(end);
+	int stable = simConverged();
+
+	VBus_Stats_t stats;
+	VBus_GetStats(&stats, 0, 0);
+	uint64_t lastOnline = 0;
+	for (uint32_t i = 0; i < simNodesCount; i++)
+		if (simNodes[i].OnlineAt > lastOnline)
+			lastOnline = simNodes[i].OnlineAt;
+	double cpuTime = cpuMs(cpu);
+	double claimLoad = 0;
+	if (simConvergedAt)
+		claimLoad = (double) simClaimBusy / simConvergedAt;
+	//node table churn: entries added, replaced and deleted
+	uint32_t churn = simEvents[LC_TraceNodeNew] + simEvents[LC_TraceNodeReplaced] + simEvents[LC_TraceNodeLost] + simEvents[LC_TraceSerialLost];
+	uint32_t churnStable = simEventsStable[LC_TraceNodeNew] + simEventsStable[LC_TraceNodeReplaced] + simEventsStable[LC_TraceNodeLost]
+			+ simEventsStable[LC_TraceSerialLost];
+	printf("{\"sim\":\"result\",\"nodes\":%u,\"seconds\":%u,\"converged\":%d,\"converge_ms\":%.1f,\"last_online_ms\":%.1f,\"stable\":%d,\"no_id\":%u,"
+			"\"claims\":%u,\"collisions\":%u,\"id_lost\":%u,\"churn\":%u,\"churn_stable\":%u,\"node_lost\":%u,\"node_lost_stable\":%u,"
+			"\"frames\":%u,\"error_frames\":%u,\"load\":%.4f,\"peak_load\":%.4f,\"claim_load\":%.4f,"
+			"\"manager_calls\":%llu,\"receive_calls\":%llu,\"trace_lost\":%u,\"cpu_ms\":%.1f,\"speedup\":%.0f}\n", simNodesCount, simSeconds,
+			simConvergedAt != 0, simConvergedAt / 1e6, lastOnline / 1e6, stable, simNoID, simEvents[LC_TraceDiscovery] + simEvents[LC_TraceClaim],
+			simEvents[LC_TraceIDCollision] + simEvents[LC_TraceIDLost], simEvents[LC_TraceIDLost], churn, churnStable,
+			simEvents[LC_TraceNodeLost], simEventsStable[LC_TraceNodeLost], stats.Frames, stats.ErrorFrames,
+			stats.Time ? (double) stats.Busy / stats.Time : 0, (double) simPeakBusy / SIM_WINDOW, claimLoad,
+			(unsigned long long) simManagerCalls, (unsigned long long) simReceiveCalls, simTraceLost, cpuTime,
+			cpuTime > 0 ? stats.Time / 1e6 / cpuTime : 0);
+	return 0;
+}
+
+/// Adds event to binary heap
+/// @param time ns
+/// @param type simEventType_t
+/// @param node Node index
+/// @param generation Node generation for simManager
+void simPush(uint64_t time, uint8_t type, uint16_t node, uint32_t generation) {
+	if (simHeapSize == simHeapCapacity) {
+		simHeapCapacity = simHeapCapacity ? simHeapCapacity * 2 : 256;
+		simHeap = realloc(simHeap, sizeof(simEvent_t) * simHeapCapacity);
+		if (simHeap == 0) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	simEvent_t event = { .Time = time, .Order = simOrder++, .Generation = generation, .Node = node, .Type = type };
+	uint32_t pos = simHeapSize++;
+	while (pos) {
+		uint32_t parent = (pos - 1) / 2;
+		if (simBefore(&simHeap[parent], &event))
+			break;
+		simHeap[pos] = simHeap[parent];
+		pos = parent;
+	}
+	simHeap[pos] = event;
+}
+
+/// Takes earliest event, heap is never empty: check and window events reschedule themselves
+/// @return
+simEvent_t simPop(void) {
+	simEvent_t top = simHeap[0];
+	simEvent_t last = simHeap[--simHeapSize];
+	uint32_t pos = 0;
+	while (1) {
+		uint32_t child = pos * 2 + 1;
+		if (child >= simHeapSize)
+			break;
+		if (child + 1 < simHeapSize && simBefore(&simHeap[child + 1], &simHeap[child]))
+			child++;
+		if (simBefore(&last, &simHeap[child]))
+			break;
+		simHeap[pos] = simHeap[child];
+		pos = child;
+	}
+	simHeap[pos] = last;
+	return top;
+}
+
+int simBefore(const simEvent_t *a, const simEvent_t *b) {
+	if (a->Time != b->Time)
+		return a->Time < b->Time;
+	return a->Order < b->Order;
+}
+
+/// Connects node to bus and creates it, like power on
+/// @param index
+void simPowerOn(int index) {
+	LC_NodeDescriptor_t *node = &nodes[index];
+	simNode_t *sim = &simNodes[index];
+
+	VBus_SetFaults(harnessNode(index, "Simulated", 0x1000 + index), simFaults);
+	if (simIDMode == simIDSame)
+		node->ShortName.NodeID = 10;
+	else if (simIDMode == simIDUnique)
+		node->ShortName.NodeID = 1 + index;
+	//simIDHash keeps LC_Broadcast_Address, LC_CreateNode takes ID from serial number hash
+	node->Serial[1] = simSeed;
+	sim->Powered = 1;
+	sim->LastManager = VBus_Time();
+	LC_CreateNode(node);
+	simTrace(index);
+	simSchedule(index, VBus_Time() + (simPeriod ? simPeriod * SIM_MS : 0));
+}
+
+/// Runs network manager with simulated time passed since previous call, schedules next call
+/// @param index
+void simManagerCall(int index) {
+	LC_NodeDescriptor_t *node = &nodes[index];
+	simNode_t *sim = &simNodes[index];
+	//whole milliseconds, rest is given next time
+	uint32_t ms = (VBus_Time() - sim->LastManager) / SIM_MS;
+	sim->LastManager += ms * SIM_MS;
+	sim->NextManager = UINT64_MAX;
+	simManagerCalls++;
+	if (simPeriod) {
+		LC_NetworkManager(node, ms);
+		simSchedule(index, VBus_Time() + simPeriod * SIM_MS);
+	} else {
+		uint32_t next = LC_NetworkManagerTickless(node, ms);
+		//task would yield at least one tick
+		if (next == 0)
+			next = 1;
+		if (next != LC_NoDeadline)
+			simSchedule(index, sim->LastManager + next * SIM_MS);
+	}
+	if (node->State == LCNodeState_Online && sim->OnlineAt == 0)
+		sim->OnlineAt = VBus_Time();
+	simTrace(index);
+}
+
+/// Moves network manager call of node, older scheduled call is dropped
+/// @param index
+/// @param time ns
+void simSchedule(int index, uint64_t time) {
+	simNode_t *sim = &simNodes[index];
+	if (time < VBus_Time())
+		time = VBus_Time();
+	sim->Generation++;
+	sim->NextManager = time;
+	simPush(time, simManager, index, sim->Generation);
+}
+
+/// Library found new work for network manager of tickless node
+/// @param node
+void sim_wakeup(void *node) {
+	int index = harnessIndex(node);
+	if (simPeriod || index < 0 || index >= SIM_MAX_NODES || simNodes[index].Powered == 0)
+		return;
+	if (simNodes[index].NextManager > VBus_Time())
+		simSchedule(index, VBus_Time());
+}
+
+/// Receive managers of nodes that got frames
+void simReceive(void) {
+	for (uint32_t i = 0; i < simNodesCount; i++) {
+		if (simNodes[i].Powered == 0 || simNodes[i].FramesRX == nodes[i].TxRxObjects.Statistics.FramesRX)
+			continue;
+		simNodes[i].FramesRX = nodes[i].TxRxObjects.Statistics.FramesRX;
+		LC_ReceiveManager(&nodes[i]);
+		simReceiveCalls++;
+		simTrace(i);
+	}
+}
+
+/// Counts new trace records of node
+/// @param index
+void simTrace(int index) {
+	LC_NodeDescriptor_t *node = &nodes[index];
+	uint32_t head = node->TxRxObjects.TraceHead;
+	uint32_t count = head - simNodes[index].TraceHead;
+	if (count == 0)
+		return;
+	simNodes[index].TraceHead = head;
+	if (count > LEVCAN_TRACE_SIZE) {
+		simTraceLost += count - LEVCAN_TRACE_SIZE;
+		count = LEVCAN_TRACE_SIZE;
+	}
+	LC_TraceRecord_t records[LEVCAN_TRACE_SIZE];
+	count = LC_TraceRead(node, records, count, 0);
+	for (uint32_t i = 0; i < count; i++) {
+		if (records[i].Event >= LC_TraceEvents)
+			continue;
+		simEvents[records[i].Event]++;
+		if (simConvergedAt)
+			simEventsStable[records[i].Event]++;
+	}
+}
+
+/// Every node powered and online or left without free address, addresses unique,
+/// node tables hold all online nodes and nothing else
+/// @return 1 if converged
+int simConverged(void) {
+	int16_t owner[LC_Broadcast_Address + 1];
+	uint32_t online = 0, noID = 0;
+	for (int i = 0; i <= LC_Broadcast_Address; i++)
+		owner[i] = -1;
+	for (uint32_t i = 0; i < simNodesCount; i++) {
+		LC_NodeDescriptor_t *node = &nodes[i];
+		if (simNodes[i].Powered == 0)
+			return 0;
+		if (node->State == LCNodeState_Online && node->ShortName.NodeID < LC_Null_Address) {
+			if (owner[node->ShortName.NodeID] >= 0)
+				return 0;
+			owner[node->ShortName.NodeID] = i;
+			online++;
+		} else if (node->State == LCNodeState_WaitingClaim && node->ShortName.NodeID == LC_Null_Address && node->LastID == LC_Null_Address)
+			noID++;
+		else
+			return 0;
+	}
+	for (uint32_t i = 0; i < simNodesCount; i++) {
+		LC_NodeDescriptor_t *node = &nodes[i];
+		if (node->ShortName.NodeID >= LC_Null_Address)
+			continue;
+		uint32_t known = 0;
+		uint16_t pos = 0;
+		for (LC_NodeShortName_t n = LC_GetActiveNodes(node, &pos); n.NodeID != LC_Broadcast_Address; n = LC_GetActiveNodes(node, &pos)) {
+			if (n.NodeID == node->ShortName.NodeID)
+				continue;
+			int16_t other = owner[n.NodeID];
+			if (other < 0 || nodes[other].ShortName.ToUint32[0] != n.ToUint32[0] || nodes[other].ShortName.ToUint32[1] != n.ToUint32[1])
+				return 0;
+			known++;
+		}
+		if (known != online - 1)
+			return 0;
+	}
+	simNoID = noID;
+	return 1;
+}
+
+void simCheckEvent(void) {
+	if (simConvergedAt == 0) {
+		if (simConverged())
+			simConvergedAt = VBus_Time();
+		else {
+			VBus_Stats_t stats;
+			VBus_GetStats(&stats, 0, 0);
+			simClaimBusy = stats.Busy;
+		}
+	} else if (simVerbose && simConverged() == 0)
+		printf("{\"sim\":\"unstable\",\"t_ms\":%.0f}\n", VBus_Time() / 1e6);
+	simPush(VBus_Time() + (simConvergedAt ? SIM_CHECK_STABLE : SIM_CHECK), simCheck, 0, 0);
+}
+
+/// Bus load of last window
+void simWindowEvent(void) {
+	VBus_Stats_t stats;
+	VBus_GetStats(&stats, 0, 0);
+	uint64_t busy = stats.Busy - simWindowBusy;
+	simWindowBusy = stats.Busy;
+	//frame time is counted when it starts
+	if (busy > SIM_WINDOW)
+		busy = SIM_WINDOW;
+	if (busy > simPeakBusy)
+		simPeakBusy = busy;
+	if (simVerbose) {
+		uint32_t online = 0;
+		for (uint32_t i = 0; i < simNodesCount; i++)
+			if (simNodes[i].Powered && nodes[i].State == LCNodeState_Online)
+				online++;
+		printf("{\"sim\":\"window\",\"t_ms\":%.0f,\"load\":%.4f,\"online\":%u,\"frames\":%u}\n", VBus_Time() / 1e6, (double) busy / SIM_WINDOW, online,
+				stats.Frames);
+	}
+	simPush(VBus_Time() + SIM_WINDOW, simWindow, 0, 0);
+}
+
+uint32_t simRandom(void) {
+	//xorshift32
+	uint32_t x = simRandomState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	simRandomState = x;
+	return x;
+}
+
+double cpuMs(clock_t start) {
+	return (double) (clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
@@ -41,7 +41,7 @@
 
 //Above-driver buffer size. Used to store CAN messages before calling network manager
 #define LEVCAN_TX_SIZE 20
-#define LEVCAN_RX_SIZE 30
+#define LEVCAN_RX_SIZE 32
 #define LEVCAN_NO_TX_QUEUE
 
 //enable parameters and setup receive buffer size
@@ -81,7 +81,7 @@ const uint32_t paramDirectoriesSize = sizeof(pDirectories) / sizeof(pDirectories
 LC_NodeDescriptor_t node_data;
 LC_NodeDescriptor_t *mynode;
 //functions to call CAN driver
-const LC_DriverCalls_t nodeDrv = { LC_HAL_Send, LC_HAL_CreateFilterMasks, LC_HAL_TxHalfFull };
+const LC_DriverCalls_t nodeDrv = { LC_HAL_Send, LC_HAL_CreateFilterMasks, LC_HAL_TxHalfFull, LC_HAL_SendBatch };
 
 void nwrk_manager(void *pvParameters);
 #ifdef LEVCAN_USE_RTOS_QUEUE
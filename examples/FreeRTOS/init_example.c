@@ -33,6 +33,7 @@ struct {
 LC_Obj_ThrottleV_t throttle_input = { 0 };
 LC_Obj_BrakeV_t brake_input = { 0 };
 LC_Obj_ActiveFunctions_t activefunc_out = { 0 };
+LC_Obj_ActiveFunctions_t activefunc_sent; //change-of-state snapshot for node_publish
 
 //#### Object dictionary. used for transfer between nodes ####
 // You can receive data (.Writable) to your variables using levcan objects or send data on request (.Readable)
@@ -42,12 +43,35 @@ const LC_Object_t node_obj[] = { //
 		{ LC_Obj_ThrottleV, { .TCP = 0, .Writable = 1 }, sizeof(throttle_input), (intptr_t*) &throttle_input }, //
 		{ LC_Obj_BrakeV, 	{ .TCP = 0, .Writable = 1 }, sizeof(brake_input), 	(intptr_t*) &brake_input }, //
 		{ 1, { .TCP = 0, .Readable = 1, .Writable = 1 }, sizeof(UserVariables.Data1), (intptr_t*) &UserVariables.Data1 }, //
+		//send active functions to everyone, see node_publish
+		{ LC_Obj_ActiveFunctions, { .TCP = 0, .Readable = 1 }, sizeof(activefunc_out), (intptr_t*) &activefunc_out }, //
 														//any size up to n
 		{ LC_SYS_DeviceName, { .TCP = 1, .Writable = 1 }, -sizeof(UserVariables.String), (intptr_t*) &UserVariables.String }, //
 };
 // @formatter:on
 const uint16_t node_obj_size = sizeof(node_obj) / sizeof(node_obj[0]);
 
+//#### Cyclic and change-of-state sending, LC_NetworkManager sends readable objects on schedule ####
+// @formatter:off
+LC_PublishEntry_t node_publish[] = { //
+		//on change, checked every 10ms, keep-alive every 1s. Phase picked automatically to spread bus load
+		{ LC_Obj_ActiveFunctions, 1000, LC_PublishAutoPhase, LC_Priority_Mid, LC_Broadcast_Address, &activefunc_sent, 10, LC_Deadband_Exact }, //
+		{ 1, 1000, LC_PublishAutoPhase, LC_Priority_Low, LC_Broadcast_Address }, //
+};
+// @formatter:on
+
+//#### Packed objects, throttle and brake voltage received in one frame and written to node_obj ####
+// Sender declares same map and sends it by LC_SendMap or its publish table
+// @formatter:off
+const LC_MapField_t map_throttle_brake[] = { //
+		{ LC_Obj_ThrottleV, sizeof(LC_Obj_ThrottleV_t) }, //
+		{ LC_Obj_BrakeV, 	sizeof(LC_Obj_BrakeV_t) }, //
+};
+const LC_Map_t node_maps[] = { //
+		{ 2, sizeof(map_throttle_brake) / sizeof(map_throttle_brake[0]), map_throttle_brake }, //
+};
+// @formatter:on
+
 //#### Parameters configuration, for GUI access ####
 // Parameters used to configure your device through display.
 // Describe variables, set limits, name and formatting
@@ -76,8 +100,9 @@ const uint32_t paramDirectoriesSize = sizeof(pDirectories) / sizeof(pDirectories
 
 LC_NodeDescriptor_t node_data;
 LC_NodeDescriptor_t *mynode;
+TaskHandle_t lc_network_task;
 //functions to call CAN driver
-const LC_DriverCalls_t nodeDrv = { LC_HAL_Send, LC_HAL_CreateFilterMasks, LC_HAL_TxHalfFull };
+const LC_DriverCalls_t nodeDrv = { LC_HAL_Send, LC_HAL_CreateFilterMasks, LC_HAL_TxHalfFull, LC_HAL_SendBatch };
 
 void nwrk_manager(void *pvParameters);
 #ifdef LEVCAN_USE_RTOS_QUEUE
@@ -123,6 +148,10 @@ void Init_LEVCAN(void) {
 	//assing node objects and its size
 	mynode->Objects = (void*) node_obj;
 	mynode->ObjectsSize = node_obj_size;
+	mynode->Publish = node_publish;
+	mynode->PublishSize = sizeof(node_publish) / sizeof(node_publish[0]);
+	mynode->Maps = node_maps;
+	mynode->MapsSize = sizeof(node_maps) / sizeof(node_maps[0]);
 
 	//since we have configuration for our device, set configurable bit and assign parameters
 	mynode->Directories = (void*) pDirectories;
@@ -132,7 +161,7 @@ void Init_LEVCAN(void) {
 	LC_CreateNode(mynode);
 
 	//run network manager task, basically it updates at 100-1000hz rate
-	xTaskCreate(nwrk_manager, "LC", configMINIMAL_STACK_SIZE, NULL, OS_PRIORITY_LOW, (TaskHandle_t*) NULL);
+	xTaskCreate(nwrk_manager, "LC", configMINIMAL_STACK_SIZE, NULL, OS_PRIORITY_LOW, &lc_network_task);
 
 	//As example request all device names in network
 	//last one will be stored in UserVariables.String
@@ -144,18 +173,28 @@ void nwrk_manager(void *pvParameters) {
 #ifdef LEVCAN_USE_RTOS_QUEUE
 	xTaskCreate(can_RXmanager, "CRX", configMINIMAL_STACK_SIZE, NULL, OS_PRIORITY_LOW, (TaskHandle_t*) NULL);
 	xTaskCreate(can_TXmanager, "CTX", configMINIMAL_STACK_SIZE, NULL, OS_PRIORITY_MID, (TaskHandle_t*) NULL);
-	const int updrate = 100;
+	//receive runs in own task, sleep till next timeout or new transfer (LC_NetworkManagerWakeup in levcan_config.h)
+	TickType_t last = xTaskGetTickCount();
+	uint32_t rest = 0; //tick part shorter than 1 ms, carried so manager time keeps up with LEVCAN_CLOCK
+	while (1) {
+		TickType_t now = xTaskGetTickCount();
+		uint32_t passed = (uint32_t) (now - last) * 1000 + rest;
+		rest = passed % configTICK_RATE_HZ;
+		uint32_t next = LC_NetworkManagerTickless(mynode, passed / configTICK_RATE_HZ);
+		last = now;
+		if (next > 1000)
+			next = 1000;
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(next));
+	}
 #else
 	const int updrate = 1000;
-#endif
 	while (1) {
 		LC_NetworkManager(mynode, configTICK_RATE_HZ / 1000);
-#ifndef LEVCAN_USE_RTOS_QUEUE
 		LC_ReceiveManager(mynode);
-#endif
 		static uint32_t prev_upd_time_sp = 0;
 		vTaskDelayUntil(&prev_upd_time_sp, configTICK_RATE_HZ / updrate); //100hz CAN
 	}
+#endif
 }
 
 #ifdef LEVCAN_USE_RTOS_QUEUE
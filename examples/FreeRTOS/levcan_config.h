@@ -7,6 +7,7 @@
 #include "FreeRTOS.h"
 #include "queue.h"
 #include "semphr.h"
+#include "task.h"
 #endif
 
 #pragma once
@@ -31,6 +32,8 @@ static inline void lc_disable_irq(void) {
 //You can re-define trace_printf function
 //#define trace_printf printf
 #endif
+//Binary trace ring per node, records (power of two). Read with LC_TraceRead or LC_TraceDump, decode with tools/levcan_trace.py
+//#define LEVCAN_TRACE_SIZE 256
 
 //define to use simple file io operations
 #define LEVCAN_FILECLIENT
@@ -60,7 +63,9 @@ static inline void lc_disable_irq(void) {
 
 //Above-driver buffer size. Used to store CAN messages before calling network manager
 #define LEVCAN_TX_SIZE 20
-#define LEVCAN_RX_SIZE 30
+#define LEVCAN_RX_SIZE 32
+//CAN FD frame data length (12, 16, 20, 24, 32, 48 or 64) to nodes that support it, default 8 - classic CAN only
+//#define LEVCAN_MAX_FRAME 64
 
 //Default size for malloc, maximum size for static mem, data size for file i/o
 #define LEVCAN_OBJECT_DATASIZE 64
@@ -72,11 +77,18 @@ static inline void lc_disable_irq(void) {
 #ifdef LEVCAN_MEM_STATIC
 //Maximum TX/RX objects at one time. Excl. UDP data <=8byte, this receives in fast mode
 #define LEVCAN_OBJECT_SIZE 20
+//Dictionary records indexed for MsgID search (objects + record array elements), 0 - linear search
+#define LEVCAN_OBJECT_INDEX_SIZE 64
 #else
 //external malloc functions
 #define lcmalloc pvPortMalloc
 #define lcfree vPortFree
 #define lcdelay vTaskDelay
+//Preallocated blocks for TX/RX objects and 64/256/512 byte payloads, lcmalloc used when empty
+#define LEVCAN_SLAB_OBJECTS 8
+#define LEVCAN_SLAB_64 8
+#define LEVCAN_SLAB_256 4
+#define LEVCAN_SLAB_512 2
 
 //enable to use RTOS managed queues
 //#define LEVCAN_USE_RTOS_QUEUE
@@ -103,6 +115,12 @@ static inline void lc_disable_irq(void) {
 
 #define LC_RTOSYieldISR(yield) portYIELD_FROM_ISR(yield)
 #define YieldNeeded_t BaseType_t
+
+//network task sleeps till next timeout, see LC_NetworkManagerTickless
+extern TaskHandle_t lc_network_task;
+#define LC_NetworkManagerWakeup(node) do { if (lc_network_task) xTaskNotifyGive(lc_network_task); } while (0)
+//ms counter for stamps taken while network task sleeps, wraps evenly when configTICK_RATE_HZ divides 1000
+#define LEVCAN_CLOCK() ((uint32_t) ((uint64_t) xTaskGetTickCount() * 1000 / configTICK_RATE_HZ))
 #else
 
 #endif
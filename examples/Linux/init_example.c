@@ -0,0 +1,84 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+// include main levcan.h and hal
+#include "levcan.h"
+#include "can_hal.h"
+#include "levcan_objects.h"
+
+//Build with "LEVCAN/source" and "LEVCAN/hal/Linux", from this folder:
+//gcc -I. -I../../source -I../../hal/Linux init_example.c ../../hal/Linux/can_hal.c ../../source/levcan.c ../../source/levcan_address.c
+//	../../source/levcan_slab.c ../../source/levcan_timer.c ../../source/levcan_trace.c ../../source/levcan_fileclient.c -lpthread -lm
+//Virtual interface for tests without hardware:
+//sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+
+//library critical sections may nest, recursive lock
+pthread_mutex_t lc_irq_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+char device_name[128];
+
+// @formatter:off
+const LC_Object_t node_obj[] = { //
+		//last received device name
+		{ LC_SYS_DeviceName, { .TCP = 1, .Writable = 1 }, -(int) sizeof(device_name), (intptr_t*) device_name }, //
+};
+// @formatter:on
+
+LC_NodeDescriptor_t node_data;
+LC_NodeDescriptor_t *mynode;
+
+uint32_t millis(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+int main(int argc, char **argv) {
+	const char *interface = (argc > 1) ? argv[1] : "vcan0";
+
+	mynode = &node_data;
+	LC_InitNodeDescriptor(mynode);
+	//socket should be ready before node configures filters, sets port driver
+	if (CAN_Init(0, interface, mynode) != LC_Ok) {
+		perror(interface);
+		return 1;
+	}
+	mynode->DeviceName = "Linux gateway";
+	mynode->NodeName = "Gateway";
+	mynode->VendorName = "CompanyName LLC.";
+	mynode->ShortName.ManufacturerCode = 0x1BC;
+	mynode->ShortName.NodeID = 60; //default used ID if free
+	mynode->Serial[0] = 0xDEADBEEF; //use your unique SN
+	mynode->ShortName.DeviceType = LC_Device_Debug;
+	mynode->Objects = (void*) node_obj;
+	mynode->ObjectsSize = sizeof(node_obj) / sizeof(node_obj[0]);
+	if (LC_CreateNode(mynode) != LC_Ok || CAN_Start(0) != LC_Ok) {
+		printf("LEVCAN init failed\n");
+		return 1;
+	}
+
+	//receive thread fills RX FIFO, managers run here
+	uint32_t last = millis();
+	uint32_t asked = 0;
+	while (1) {
+		uint32_t now = millis();
+		LC_ReceiveManager(mynode);
+		LC_NetworkManager(mynode, now - last);
+		last = now;
+		if (mynode->State == LCNodeState_Online && now - asked > 5000) {
+			asked = now;
+			//list everyone
+			uint16_t pos = 0;
+			for (LC_NodeShortName_t n = LC_GetActiveNodes(mynode, &pos); n.NodeID != LC_Broadcast_Address; n = LC_GetActiveNodes(mynode, &pos))
+				printf("node %d type %d\n", n.NodeID, n.DeviceType);
+			LC_SendRequest(mynode, LC_Broadcast_Address, LC_SYS_DeviceName);
+		}
+		usleep(1000);
+	}
+	CAN_Stop(0);
+	return 0;
+}
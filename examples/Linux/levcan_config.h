@@ -0,0 +1,59 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#pragma once
+
+//critical sections between application threads, CAN receive thread (hal/Linux) takes only lock-free RX FIFO
+extern pthread_mutex_t lc_irq_mutex;
+
+//user functions for critical sections
+static inline void lc_enable_irq(void) {
+	pthread_mutex_unlock(&lc_irq_mutex);
+}
+static inline void lc_disable_irq(void) {
+	pthread_mutex_lock(&lc_irq_mutex);
+}
+#define LC_EXPORT
+//Memory packing, compiler specific
+#define LEVCAN_PACKED __attribute__((packed))
+//platform specific, define how many bytes in uint8_t
+#define LEVCAN_MIN_BYTE_SIZE 1
+
+#ifdef TRACE
+//Print debug messages using trace_printf
+#define LEVCAN_TRACE
+#define trace_printf printf
+#endif
+//Binary trace ring per node, records (power of two). Read with LC_TraceRead or LC_TraceDump, decode with tools/levcan_trace.py
+//#define LEVCAN_TRACE_SIZE 256
+
+//define to use simple file io operations
+#define LEVCAN_FILECLIENT
+//File operations timeout for client side (ms)
+#define LEVCAN_FILE_TIMEOUT 500
+
+//Max own created nodes
+#define LEVCAN_MAX_OWN_NODES 1
+
+//max saved nodes short names (used for search)
+#define LEVCAN_MAX_TABLE_NODES 64
+
+//Above-driver buffer size. Used to store CAN messages before calling network manager
+#define LEVCAN_TX_SIZE 64
+#define LEVCAN_RX_SIZE 256
+//CAN FD frame data length (12, 16, 20, 24, 32, 48 or 64) to nodes that support it, interface mtu should be 72
+//#define LEVCAN_MAX_FRAME 64
+
+//Default size for malloc, data size for file i/o
+#define LEVCAN_OBJECT_DATASIZE 64
+#define LEVCAN_FILE_DATASIZE 512
+
+//external malloc functions
+#define lcmalloc malloc
+#define lcfree free
+#define lcdelay(ms) usleep((ms) * 1000)
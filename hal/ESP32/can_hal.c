@@ -33,6 +33,10 @@
 #include <freertos/queue.h>
 #include <freertos/task.h>
 
+#if LEVCAN_MAX_FRAME > 8
+#error "TWAI is classic CAN only, set LEVCAN_MAX_FRAME 8"
+#endif
+
 /* ---------------------------- Definitions --------------------------------- */
 // Internal Macros
 #define TWAI_CHECK(cond, ret_val)                                              \
@@ -218,7 +222,7 @@ CAN_Status CAN_Send(CAN_IR index, uint32_t *data, uint16_t length) {
     tx_message.data_length_code = length;
     tx_message.extd = index.ExtensionID;
     tx_message.rtr = index.Request;
-    for (uint8_t i = 0; i < length; i++) {
+    for (uint8_t i = 0; i < length && !index.Request; i++) {
       tx_message.data[i] = *(((uint8_t *)data) + i);
     }
     twai_hal_frame_t tx_frame;
@@ -238,11 +242,12 @@ LC_Return_t LC_HAL_Send(LC_HeaderPacked_t header, uint32_t *data,
 
   can_packet_t packet;
   packet.Header = header;
-  if (length) {
+  // remote frames carry only the data length code
+  if (length && data && header.Request == 0) {
     packet.data[0] = (uint32_t)data[0];
     packet.data[1] = (uint32_t)data[1];
-    packet.length = length;
   }
+  packet.length = length;
 
   state =
       (xQueueSend(txCanqueue, &packet, 0) == pdTRUE) ? LC_Ok : LC_BufferFull;
@@ -252,6 +257,26 @@ LC_Return_t LC_HAL_Send(LC_HeaderPacked_t header, uint32_t *data,
   return state;
 }
 
+uint16_t LC_HAL_SendBatch(const lc_msgBuffered *frames, uint16_t count) {
+  // queue takes frames one by one, stop at first one that doesn't fit
+  uint16_t sent = 0;
+  for (; sent < count; sent++) {
+    can_packet_t packet;
+    packet.Header = frames[sent].header;
+    packet.data[0] = 0;
+    packet.data[1] = 0;
+    // remote frames carry only the data length code
+    if (frames[sent].length && frames[sent].header.Request == 0) {
+      packet.data[0] = frames[sent].data[0];
+      packet.data[1] = frames[sent].data[1];
+    }
+    packet.length = frames[sent].length;
+    if (xQueueSend(txCanqueue, &packet, 0) != pdTRUE)
+      break;
+  }
+  return sent;
+}
+
 // controller filter init
 LC_Return_t LC_HAL_CreateFilterMasks(LC_HeaderPacked_t *reg,
                                      LC_HeaderPacked_t *mask, uint16_t count) {
@@ -272,8 +297,6 @@ void txCanTask(void *pvParameters) {
       sindex.EXID = packet_from_q.Header.ToUint32;
       sindex.ExtensionID = 1;
       sindex.Request = packet_from_q.Header.Request;
-      if (sindex.Request)
-        packet_from_q.length = 0;
       // counter
       can_tx_cnt++;
       // try to send till its actually sent
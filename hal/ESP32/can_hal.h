@@ -683,6 +683,7 @@ CAN_Status CAN_ReceiveN(CAN_IR *index, uint32_t *data, uint16_t *length, int fif
 
 LC_Return_t LC_HAL_CreateFilterMasks(LC_HeaderPacked_t *reg, LC_HeaderPacked_t *mask, uint16_t count);
 LC_Return_t LC_HAL_Send(LC_HeaderPacked_t header, uint32_t *data, uint8_t length);
+uint16_t LC_HAL_SendBatch(const lc_msgBuffered *frames, uint16_t count);
 LC_Return_t LC_HAL_TxHalfFull();
 
 
@@ -0,0 +1,285 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#define _GNU_SOURCE
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/sockios.h>
+#include "can_hal.h"
+
+// TYPEDEFS
+typedef struct {
+	LC_NodeDescriptor_t *Node;
+	int Socket; //-1 - port closed
+	int Sndbuf;
+	volatile int Running;
+	pthread_t RxThread;
+	volatile uint32_t TxCount;
+	volatile uint32_t RxCount;
+} canPort_t;
+
+//EXTERN FUNCTIONS
+extern void LC_ReceiveHandler(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header, uint32_t *data, uint8_t length);
+
+//PRIVATE FUNCTIONS
+void* rxThread(void *arg);
+uint8_t packFrame(struct canfd_frame *frame, LC_HeaderPacked_t header, const uint32_t *data, uint8_t length);
+LC_Return_t canSend(canPort_t *port, LC_HeaderPacked_t header, uint32_t *data, uint8_t length);
+uint16_t canSendBatch(canPort_t *port, const lc_msgBuffered *frames, uint16_t count);
+LC_Return_t canFilter(canPort_t *port, LC_HeaderPacked_t *reg, LC_HeaderPacked_t *mask, uint16_t count);
+LC_Return_t canTxHalfFull(canPort_t *port);
+
+//PRIVATE VARIABLES
+canPort_t canPorts[CAN_PORTS] = { [0 ... CAN_PORTS - 1] = { .Socket = -1 } };
+
+//one driver per port, LC_DriverCalls_t has no context
+#define canDriver(n) \
+	LC_Return_t canSend##n(LC_HeaderPacked_t header, uint32_t *data, uint8_t length) { \
+		return canSend(&canPorts[n], header, data, length); \
+	} \
+	uint16_t canSendBatch##n(const lc_msgBuffered *frames, uint16_t count) { \
+		return canSendBatch(&canPorts[n], frames, count); \
+	} \
+	LC_Return_t canFilter##n(LC_HeaderPacked_t *reg, LC_HeaderPacked_t *mask, uint16_t count) { \
+		return canFilter(&canPorts[n], reg, mask, count); \
+	} \
+	LC_Return_t canTxHalfFull##n(void) { \
+		return canTxHalfFull(&canPorts[n]); \
+	}
+#define canDriverCalls(n) { canSend##n, canFilter##n, canTxHalfFull##n, canSendBatch##n }
+
+canDriver(0)
+canDriver(1)
+canDriver(2)
+canDriver(3)
+
+const LC_DriverCalls_t canDrivers[CAN_PORTS] = { canDriverCalls(0), canDriverCalls(1), canDriverCalls(2), canDriverCalls(3) };
+
+/// Opens raw CAN socket on interface and sets node driver, call after LC_InitNodeDescriptor and before LC_CreateNode
+/// @param port - 0..CAN_PORTS-1
+/// @param interface - name, like "can0" or "vcan0"
+/// @param node - receives frames of this interface
+/// @return LC_Ok, LC_OutOfRange or LC_InitError
+LC_Return_t CAN_Init(int port, const char *interface, LC_NodeDescriptor_t *node) {
+	struct ifreq ifr;
+	struct sockaddr_can addr;
+
+	if (port < 0 || port >= CAN_PORTS)
+		return LC_OutOfRange;
+	canPort_t *can = &canPorts[port];
+	if (can->Socket >= 0 || node == 0)
+		return LC_InitError;
+	can->Socket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+	if (can->Socket < 0)
+		return LC_InitError;
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, interface, IFNAMSIZ - 1);
+	if (ioctl(can->Socket, SIOCGIFINDEX, &ifr) < 0)
+		goto fail;
+#if LEVCAN_MAX_FRAME > 8
+	//interface should be switched to CAN FD mtu too
+	int enable = 1;
+	if (setsockopt(can->Socket, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)) < 0)
+		goto fail;
+#endif
+	//receive thread checks for CAN_Stop
+	struct timeval timeout = { 0, 100000 };
+	setsockopt(can->Socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	socklen_t optlen = sizeof(can->Sndbuf);
+	getsockopt(can->Socket, SOL_SOCKET, SO_SNDBUF, &can->Sndbuf, &optlen);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.can_family = AF_CAN;
+	addr.can_ifindex = ifr.ifr_ifindex;
+	if (bind(can->Socket, (struct sockaddr*) &addr, sizeof(addr)) < 0)
+		goto fail;
+	can->Node = node;
+	can->TxCount = 0;
+	can->RxCount = 0;
+	node->Driver = &canDrivers[port];
+	return LC_Ok;
+
+	fail: close(can->Socket);
+	can->Socket = -1;
+	return LC_InitError;
+}
+
+/// Begin CAN operation, received frames go to port node
+/// @param port
+/// @return LC_Ok or LC_InitError
+LC_Return_t CAN_Start(int port) {
+	if (port < 0 || port >= CAN_PORTS)
+		return LC_InitError;
+	canPort_t *can = &canPorts[port];
+	if (can->Socket < 0 || can->Running)
+		return LC_InitError;
+	can->Running = 1;
+	if (pthread_create(&can->RxThread, 0, rxThread, can)) {
+		can->Running = 0;
+		return LC_InitError;
+	}
+	return LC_Ok;
+}
+
+/// Stops receive thread and closes socket of port
+/// @param port
+void CAN_Stop(int port) {
+	if (port < 0 || port >= CAN_PORTS)
+		return;
+	canPort_t *can = &canPorts[port];
+	if (can->Running) {
+		can->Running = 0;
+		pthread_join(can->RxThread, 0);
+	}
+	if (can->Socket >= 0)
+		close(can->Socket);
+	can->Socket = -1;
+}
+
+/// Frames sent and received by port since CAN_Init
+/// @param port
+/// @param tx - may be 0
+/// @param rx - may be 0
+void CAN_GetCounters(int port, uint32_t *tx, uint32_t *rx) {
+	if (port < 0 || port >= CAN_PORTS)
+		return;
+	if (tx)
+		*tx = canPorts[port].TxCount;
+	if (rx)
+		*rx = canPorts[port].RxCount;
+}
+
+void* rxThread(void *arg) {
+	canPort_t *can = arg;
+	struct canfd_frame frames[CAN_RX_BATCH];
+	struct iovec iov[CAN_RX_BATCH];
+	struct mmsghdr msgs[CAN_RX_BATCH];
+
+	memset(msgs, 0, sizeof(msgs));
+	for (int i = 0; i < CAN_RX_BATCH; i++) {
+		iov[i].iov_base = &frames[i];
+		iov[i].iov_len = sizeof(frames[i]);
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	while (can->Running) {
+		//wait for first frame, then take everything queued
+		int count = recvmmsg(can->Socket, msgs, CAN_RX_BATCH, MSG_WAITFORONE, 0);
+		if (count < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				continue;
+			break;
+		}
+		for (int i = 0; i < count; i++) {
+			struct canfd_frame *frame = &frames[i];
+			//LEVCAN uses 29b identifiers only
+			if ((frame->can_id & CAN_EFF_FLAG) == 0 || (frame->can_id & CAN_ERR_FLAG))
+				continue;
+			if (msgs[i].msg_len != CAN_MTU && msgs[i].msg_len != CANFD_MTU)
+				continue;
+			if (frame->len > LEVCAN_MAX_FRAME)
+				continue;
+			LC_HeaderPacked_t header = { 0 };
+			header.ToUint32 = frame->can_id & CAN_EFF_MASK; //29b
+			header.Request = (frame->can_id & CAN_RTR_FLAG) ? 1 : 0; //30b
+			can->RxCount++;
+			//frame data is 8 byte aligned
+			LC_ReceiveHandler(can->Node, header, (uint32_t*) frame->data, frame->len);
+		}
+	}
+	return 0;
+}
+
+uint8_t packFrame(struct canfd_frame *frame, LC_HeaderPacked_t header, const uint32_t *data, uint8_t length) {
+	memset(frame, 0, offsetof(struct canfd_frame, data));
+	frame->can_id = (header.ToUint32 & CAN_EFF_MASK) | CAN_EFF_FLAG;
+	if (header.Request)
+		frame->can_id |= CAN_RTR_FLAG;
+	frame->len = length;
+	//remote frames carry only the data length code
+	if (length && data && header.Request == 0)
+		memcpy(frame->data, data, length);
+	if (length > 8) {
+		frame->flags = CANFD_BRS;
+		return CANFD_MTU;
+	}
+	return CAN_MTU;
+}
+
+LC_Return_t canSend(canPort_t *port, LC_HeaderPacked_t header, uint32_t *data, uint8_t length) {
+	struct canfd_frame frame;
+	uint8_t size = packFrame(&frame, header, data, length);
+	//full socket buffer or interface queue, scheduler will try again
+	if (send(port->Socket, &frame, size, MSG_DONTWAIT) != size)
+		return LC_BufferFull;
+	port->TxCount++;
+	return LC_Ok;
+}
+
+uint16_t canSendBatch(canPort_t *port, const lc_msgBuffered *frames, uint16_t count) {
+	struct canfd_frame batch[CAN_TX_BATCH];
+	struct iovec iov[CAN_TX_BATCH];
+	struct mmsghdr msgs[CAN_TX_BATCH];
+	uint16_t sent = 0;
+
+	while (sent < count) {
+		uint16_t size = count - sent;
+		if (size > CAN_TX_BATCH)
+			size = CAN_TX_BATCH;
+		memset(msgs, 0, sizeof(struct mmsghdr) * size);
+		for (uint16_t i = 0; i < size; i++) {
+			const lc_msgBuffered *msg = &frames[sent + i];
+			iov[i].iov_base = &batch[i];
+			iov[i].iov_len = packFrame(&batch[i], msg->header, msg->data, msg->length);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		//one system call for whole burst, stops at first frame that doesn't fit
+		int done = sendmmsg(port->Socket, msgs, size, MSG_DONTWAIT);
+		if (done <= 0)
+			break;
+		sent += done;
+		port->TxCount += done;
+		if (done < size)
+			break;
+	}
+	return sent;
+}
+
+LC_Return_t canFilter(canPort_t *port, LC_HeaderPacked_t *reg, LC_HeaderPacked_t *mask, uint16_t count) {
+	struct can_filter filters[CAN_FilterSize];
+
+	if (count > CAN_FilterSize)
+		return LC_OutOfRange;
+	for (int i = 0; i < count; i++) {
+		//force 29b
+		filters[i].can_id = (reg[i].ToUint32 & CAN_EFF_MASK) | CAN_EFF_FLAG;
+		filters[i].can_mask = (mask[i].ToUint32 & CAN_EFF_MASK) | CAN_EFF_FLAG;
+		if (reg[i].Request)
+			filters[i].can_id |= CAN_RTR_FLAG;
+		if (mask[i].Request)
+			filters[i].can_mask |= CAN_RTR_FLAG;
+	}
+	if (setsockopt(port->Socket, SOL_CAN_RAW, CAN_RAW_FILTER, filters, sizeof(struct can_filter) * count) < 0)
+		return LC_InitError;
+	return LC_Ok;
+}
+
+LC_Return_t canTxHalfFull(canPort_t *port) {
+	int queued = 0;
+	//bytes still waiting in socket send buffer
+	if (ioctl(port->Socket, SIOCOUTQ, &queued) < 0)
+		return LC_BufferEmpty;
+	if (queued * 4 < port->Sndbuf * 3)
+		return LC_BufferEmpty;
+	else
+		return LC_BufferFull;
+}
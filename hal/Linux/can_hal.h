@@ -0,0 +1,29 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include "stdint.h"
+#include "levcan.h"
+
+#pragma once
+
+//Linux SocketCAN driver, works with can and vcan interfaces. Frames are received by own thread and
+//given to LC_ReceiveHandler, so LC_ReceiveManager and LC_NetworkManager run in user thread as usual.
+//Every port is one interface with own socket, receive thread and node
+
+//interfaces opened at once
+#define CAN_PORTS 4
+
+//frames taken by one recvmmsg / sendmmsg call
+#ifndef CAN_RX_BATCH
+#define CAN_RX_BATCH 32
+#endif
+#ifndef CAN_TX_BATCH
+#define CAN_TX_BATCH 32
+#endif
+//maximum filters given by LC_ConfigureFilters
+#define CAN_FilterSize 16
+
+LC_Return_t CAN_Init(int port, const char *interface, LC_NodeDescriptor_t *node);
+LC_Return_t CAN_Start(int port);
+void CAN_Stop(int port);
+void CAN_GetCounters(int port, uint32_t *tx, uint32_t *rx);
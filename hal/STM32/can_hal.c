@@ -16,6 +16,10 @@
 #endif
 #include "can_hal.h"
 
+#if LEVCAN_MAX_FRAME > 8
+#error "bxCAN is classic CAN only, set LEVCAN_MAX_FRAME 8"
+#endif
+
 // TYPEDEFS
 typedef struct {
 	LC_HeaderPacked_t Header;
@@ -558,6 +562,38 @@ LC_Return_t LC_HAL_Send(LC_HeaderPacked_t header, uint32_t *data, uint8_t length
 	return (state == LC_Ok) ? LC_Ok : LC_BufferFull;
 }
 
+uint16_t LC_HAL_SendBatch(const lc_msgBuffered *frames, uint16_t count) {
+	uint16_t sent = 0;
+#ifdef LEVCAN_USE_RTOS_QUEUE
+	for (; sent < count; sent++) {
+		can_packet_t packet;
+		packet.Header = frames[sent].header;
+		packet.data[0] = frames[sent].data[0];
+		packet.data[1] = frames[sent].data[1];
+		packet.length = frames[sent].length;
+		if (xQueueSend(txCanqueue, &packet, 0) != pdTRUE)
+			break;
+	}
+#else
+	lc_disable_irq(); //one critical section for whole burst
+	for (; sent < count; sent++) {
+		if (txFIFO_in == ((txFIFO_out - 1 + LEVCAN_TX_SIZE) % LEVCAN_TX_SIZE))
+			break;
+		txFIFO[txFIFO_in].Header = frames[sent].header;
+		txFIFO[txFIFO_in].data[0] = frames[sent].data[0];
+		txFIFO[txFIFO_in].data[1] = frames[sent].data[1];
+		txFIFO[txFIFO_in].length = frames[sent].length;
+		txFIFO_in = (txFIFO_in + 1) % LEVCAN_TX_SIZE;
+	}
+	//check for no transmission happening
+	if (_anyTX() == 0) {
+		txFifoProceed();
+	}
+	lc_enable_irq();
+#endif
+	return sent;
+}
+
 LC_Return_t LC_HAL_CreateFilterMasks(LC_HeaderPacked_t *reg, LC_HeaderPacked_t *mask, uint16_t count) {
 	
 	CAN_FilterEditOn();
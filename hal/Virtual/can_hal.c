@@ -0,0 +1,589 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include <string.h>
+#include "can_hal.h"
+
+// TYPEDEFS
+typedef struct {
+	LC_NodeDescriptor_t *Node;
+	lc_msgBuffered Queue[VBUS_TX_SIZE];
+	LC_HeaderPacked_t FilterReg[VBUS_FILTERS];
+	LC_HeaderPacked_t FilterMask[VBUS_FILTERS];
+	uint8_t FiltersSize; //0xFF - not configured yet, accept all
+	uint8_t Sending; //queue index of frame on wire
+	uint8_t Wire; //vbusIdle, vbusSender or vbusLoser while frame is on wire
+	VBus_Faults_t Faults;
+	VBus_PortStats_t Stats;
+	uint64_t RecoverAt;
+} vbusPort_t;
+
+typedef struct {
+	uint16_t CRC;
+	uint8_t CRCon;
+	uint8_t Last;
+	uint8_t Run;
+	uint16_t Bits;
+	uint16_t Stuffed;
+} vbusStream_t;
+
+enum {
+	vbusSuccess, vbusError, vbusAckError
+};
+
+enum {
+	vbusIdle, vbusSender, vbusLoser
+};
+
+//EXTERN FUNCTIONS
+extern void LC_ReceiveHandler(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header, uint32_t *data, uint8_t length);
+
+//PRIVATE FUNCTIONS
+LC_Return_t vbusSend(vbusPort_t *port, LC_HeaderPacked_t header, uint32_t *data, uint8_t length);
+uint16_t vbusSendBatch(vbusPort_t *port, const lc_msgBuffered *frames, uint16_t count);
+LC_Return_t vbusFilter(vbusPort_t *port, LC_HeaderPacked_t *reg, LC_HeaderPacked_t *mask, uint16_t count);
+LC_Return_t vbusTxHalfFull(vbusPort_t *port);
+uint8_t vbusAccept(vbusPort_t *port, LC_HeaderPacked_t header);
+void vbusArbitrate(void);
+void vbusComplete(void);
+void vbusErrorCounters(vbusPort_t *port);
+uint32_t vbusRandom(void);
+float vbusChance(void);
+void vbusBits(vbusStream_t *stream, uint32_t value, uint8_t count);
+void vbusFrameBits(const lc_msgBuffered *frame, uint32_t *nominal, uint32_t *data);
+uint64_t vbusFrameTime(const lc_msgBuffered *frame);
+
+//PRIVATE VARIABLES
+struct {
+	VBus_Config_t Config;
+	VBus_Stats_t Stats;
+	vbusPort_t Ports[VBUS_PORTS];
+	uint8_t PortsSize;
+	uint32_t Random;
+	uint32_t Queued; //frames waiting in all ports
+	//frame on wire: one or more vbusSender ports if same frame sent at once,
+	//vbusLoser ports sent same identifier with different data
+	uint8_t Busy;
+	uint8_t Outcome;
+	uint64_t BusySince;
+	uint64_t BusyUntil;
+} vbus;
+
+//one driver per port, LC_DriverCalls_t has no context
+#define vbusDriver(name, n) \
+	LC_Return_t vbusSend##name(LC_HeaderPacked_t header, uint32_t *data, uint8_t length) { \
+		return vbusSend(&vbus.Ports[n], header, data, length); \
+	} \
+	uint16_t vbusSendBatch##name(const lc_msgBuffered *frames, uint16_t count) { \
+		return vbusSendBatch(&vbus.Ports[n], frames, count); \
+	} \
+	LC_Return_t vbusFilter##name(LC_HeaderPacked_t *reg, LC_HeaderPacked_t *mask, uint16_t count) { \
+		return vbusFilter(&vbus.Ports[n], reg, mask, count); \
+	} \
+	LC_Return_t vbusTxHalfFull##name(void) { \
+		return vbusTxHalfFull(&vbus.Ports[n]); \
+	}
+#define vbusDriverCalls(name) { vbusSend##name, vbusFilter##name, vbusTxHalfFull##name, vbusSendBatch##name }
+//eight drivers of group g, ports 8 * g + 0..7
+#define vbusDriver8(g) vbusDriver(g##_0, 8 * g) vbusDriver(g##_1, 8 * g + 1) vbusDriver(g##_2, 8 * g + 2) vbusDriver(g##_3, 8 * g + 3) \
+	vbusDriver(g##_4, 8 * g + 4) vbusDriver(g##_5, 8 * g + 5) vbusDriver(g##_6, 8 * g + 6) vbusDriver(g##_7, 8 * g + 7)
+#define vbusDriverCalls8(g) vbusDriverCalls(g##_0), vbusDriverCalls(g##_1), vbusDriverCalls(g##_2), vbusDriverCalls(g##_3), \
+	vbusDriverCalls(g##_4), vbusDriverCalls(g##_5), vbusDriverCalls(g##_6), vbusDriverCalls(g##_7)
+
+vbusDriver8(0)
+vbusDriver8(1)
+vbusDriver8(2)
+vbusDriver8(3)
+vbusDriver8(4)
+vbusDriver8(5)
+vbusDriver8(6)
+vbusDriver8(7)
+vbusDriver8(8)
+vbusDriver8(9)
+vbusDriver8(10)
+vbusDriver8(11)
+vbusDriver8(12)
+vbusDriver8(13)
+vbusDriver8(14)
+vbusDriver8(15)
+
+const LC_DriverCalls_t vbusDrivers[VBUS_PORTS] = { vbusDriverCalls8(0), vbusDriverCalls8(1), vbusDriverCalls8(2), vbusDriverCalls8(3),
+	vbusDriverCalls8(4), vbusDriverCalls8(5), vbusDriverCalls8(6), vbusDriverCalls8(7), vbusDriverCalls8(8), vbusDriverCalls8(9),
+	vbusDriverCalls8(10), vbusDriverCalls8(11), vbusDriverCalls8(12), vbusDriverCalls8(13), vbusDriverCalls8(14), vbusDriverCalls8(15) };
+
+/// Resets bus, detaches all nodes
+/// @param config Bus timing and controller options, 0 - 1Mbit defaults
+void VBus_Init(const VBus_Config_t *config) {
+	memset(&vbus, 0, sizeof(vbus));
+	if (config)
+		vbus.Config = *config;
+	if (vbus.Config.Bitrate == 0)
+		vbus.Config.Bitrate = 1000000;
+	if (vbus.Config.DataBitrate == 0)
+		vbus.Config.DataBitrate = vbus.Config.Bitrate;
+	vbus.Random = vbus.Config.Seed ? vbus.Config.Seed : 0x2545F491;
+}
+
+/// Connects node to next free port and sets its driver, call before LC_CreateNode
+/// @param node
+/// @return Port index, -1 if all ports taken
+int VBus_Attach(LC_NodeDescriptor_t *node) {
+	if (node == 0 || vbus.PortsSize >= VBUS_PORTS)
+		return -1;
+	int index = vbus.PortsSize++;
+	vbusPort_t *port = &vbus.Ports[index];
+	memset(port, 0, sizeof(vbusPort_t));
+	port->Node = node;
+	port->FiltersSize = 0xFF;
+	node->Driver = &vbusDrivers[index];
+	return index;
+}
+
+/// Advances simulated time, frames finished meanwhile are delivered to nodes
+/// @param us Microseconds
+void VBus_Run(uint32_t us) {
+	VBus_RunUntil(vbus.Stats.Time + (uint64_t) us * 1000);
+}
+
+/// Advances simulated time to given moment, for event driven callers
+/// @param time ns since VBus_Init, past time does nothing
+void VBus_RunUntil(uint64_t time) {
+	uint64_t end = time;
+	if (end < vbus.Stats.Time)
+		return;
+
+	while (1) {
+		if (vbus.Busy) {
+			//frame on wire
+			if (vbus.BusyUntil > end)
+				break;
+			vbus.Stats.Time = vbus.BusyUntil;
+			vbusComplete();
+			continue;
+		}
+		vbusArbitrate();
+		if (vbus.Busy == 0) {
+			//idle till end or bus-off recovery of port with pending frames
+			uint64_t next = end;
+			for (int i = 0; i < vbus.PortsSize; i++) {
+				vbusPort_t *port = &vbus.Ports[i];
+				if (port->Stats.State == VBus_BusOff && port->Stats.Queued && port->RecoverAt > vbus.Stats.Time && port->RecoverAt < next)
+					next = port->RecoverAt;
+			}
+			vbus.Stats.Time = next;
+			if (next == end)
+				break;
+		}
+	}
+	vbus.Stats.Time = end;
+}
+
+/// Moment when bus state changes next: frame on wire completes, queued frame starts or bus-off port recovers.
+/// Nodes queueing frames move it to current time
+/// @return ns since VBus_Init, UINT64_MAX if bus stays idle
+uint64_t VBus_NextEvent(void) {
+	if (vbus.Busy)
+		return vbus.BusyUntil;
+	if (vbus.Queued == 0)
+		return UINT64_MAX;
+	uint64_t next = UINT64_MAX;
+	for (int i = 0; i < vbus.PortsSize; i++) {
+		vbusPort_t *port = &vbus.Ports[i];
+		if (port->Stats.Queued == 0)
+			continue;
+		if (port->Stats.State != VBus_BusOff)
+			return vbus.Stats.Time;
+		if (port->RecoverAt < next)
+			next = port->RecoverAt;
+	}
+	return next;
+}
+
+/// Simulated time
+/// @return ns since VBus_Init
+uint64_t VBus_Time(void) {
+	return vbus.Stats.Time;
+}
+
+/// Sets fault injection for port
+/// @param port Index from VBus_Attach
+/// @param faults
+void VBus_SetFaults(int port, VBus_Faults_t faults) {
+	if (port >= 0 && port < vbus.PortsSize)
+		vbus.Ports[port].Faults = faults;
+}
+
+/// Switches port controller to bus-off, like after continuous transmit errors
+/// @param port Index from VBus_Attach
+void VBus_ForceBusOff(int port) {
+	if (port < 0 || port >= vbus.PortsSize)
+		return;
+	vbus.Ports[port].Stats.TEC = 256;
+	vbusErrorCounters(&vbus.Ports[port]);
+}
+
+/// Reads bus and port statistics
+/// @param stats Optional, bus totals
+/// @param port Index from VBus_Attach
+/// @param portStats Optional, port counters
+void VBus_GetStats(VBus_Stats_t *stats, int port, VBus_PortStats_t *portStats) {
+	if (stats)
+		*stats = vbus.Stats;
+	if (portStats && port >= 0 && port < vbus.PortsSize)
+		*portStats = vbus.Ports[port].Stats;
+}
+
+/// Wire time of frame at configured bitrates
+/// @param header
+/// @param data
+/// @param length
+/// @return ns, stuffing and interframe space included
+uint32_t VBus_FrameTime(LC_HeaderPacked_t header, const uint32_t *data, uint8_t length) {
+	lc_msgBuffered frame = { 0 };
+	frame.header = header;
+	frame.length = length;
+	if (data && length && header.Request == 0)
+		memcpy(frame.data, data, length);
+	return vbusFrameTime(&frame);
+}
+
+LC_Return_t vbusSend(vbusPort_t *port, LC_HeaderPacked_t header, uint32_t *data, uint8_t length) {
+	if (port->Stats.Queued >= VBUS_TX_SIZE || length > LEVCAN_MAX_FRAME)
+		return LC_BufferFull;
+	lc_msgBuffered *frame = &port->Queue[port->Stats.Queued];
+	memset(frame, 0, sizeof(lc_msgBuffered));
+	frame->header = header;
+	frame->length = length;
+	//remote frames carry only the data length code
+	if (data && length && header.Request == 0)
+		memcpy(frame->data, data, length);
+	port->Stats.Queued++;
+	vbus.Queued++;
+	return LC_Ok;
+}
+
+uint16_t vbusSendBatch(vbusPort_t *port, const lc_msgBuffered *frames, uint16_t count) {
+	uint16_t sent = 0;
+	for (; sent < count; sent++) {
+		if (vbusSend(port, frames[sent].header, (uint32_t*) frames[sent].data, frames[sent].length) != LC_Ok)
+			break;
+	}
+	return sent;
+}
+
+LC_Return_t vbusFilter(vbusPort_t *port, LC_HeaderPacked_t *reg, LC_HeaderPacked_t *mask, uint16_t count) {
+	if (count > VBUS_FILTERS)
+		return LC_OutOfRange;
+	for (int i = 0; i < count; i++) {
+		port->FilterReg[i] = reg[i];
+		port->FilterMask[i] = mask[i];
+	}
+	port->FiltersSize = count;
+	return LC_Ok;
+}
+
+LC_Return_t vbusTxHalfFull(vbusPort_t *port) {
+	if (port->Stats.Queued * 4 < VBUS_TX_SIZE * 3)
+		return LC_BufferEmpty;
+	else
+		return LC_BufferFull;
+}
+
+uint8_t vbusAccept(vbusPort_t *port, LC_HeaderPacked_t header) {
+	if (port->FiltersSize == 0xFF)
+		return 1;
+	//29b identifier and RTR bit
+	const uint32_t used = 0x3FFFFFFF;
+	for (int i = 0; i < port->FiltersSize; i++)
+		if (((header.ToUint32 ^ port->FilterReg[i].ToUint32) & port->FilterMask[i].ToUint32 & used) == 0)
+			return 1;
+	return 0;
+}
+
+void vbusArbitrate(void) {
+	uint32_t best = UINT32_MAX;
+	vbus.Busy = 0;
+
+	for (int i = 0; i < vbus.PortsSize; i++) {
+		vbusPort_t *port = &vbus.Ports[i];
+		port->Wire = vbusIdle;
+		if (port->Stats.State == VBus_BusOff) {
+			if (vbus.Stats.Time < port->RecoverAt)
+				continue;
+			port->Stats.TEC = 0;
+			port->Stats.REC = 0;
+			port->Stats.State = VBus_ErrorActive;
+		}
+		if (port->Stats.Queued == 0)
+			continue;
+		//bxCAN TXFP: oldest frame, otherwise lowest ID of mailboxes
+		uint8_t pick = 0;
+		if (vbus.Config.MailboxPriority) {
+			for (uint8_t m = 1; m < VBUS_MAILBOXES && m < port->Stats.Queued; m++)
+				if ((port->Queue[m].header.ToUint32 & 0x3FFFFFFF) < (port->Queue[pick].header.ToUint32 & 0x3FFFFFFF))
+					pick = m;
+		}
+		port->Sending = pick;
+		port->Wire = vbusSender;
+		//ID bits first, then RTR: data frame wins over remote one
+		uint32_t key = port->Queue[pick].header.ToUint32 & 0x3FFFFFFF;
+		if (key < best)
+			best = key;
+	}
+	if (best == UINT32_MAX)
+		return;
+	for (int i = 0; i < vbus.PortsSize; i++) {
+		vbusPort_t *port = &vbus.Ports[i];
+		if (port->Wire == vbusSender && (port->Queue[port->Sending].header.ToUint32 & 0x3FFFFFFF) != best) {
+			port->Wire = vbusIdle;
+			port->Stats.ArbitrationLost++;
+		}
+	}
+	vbus.Busy = 1;
+
+	//same identifier at once: frames go together till first differing bit, DLC then data.
+	//Sender of recessive bit sees bit error, its error flag destroys frame unless it is error passive
+	lc_msgBuffered *frame = 0;
+	for (int i = 0; i < vbus.PortsSize; i++) {
+		if (vbus.Ports[i].Wire != vbusSender)
+			continue;
+		lc_msgBuffered *own = &vbus.Ports[i].Queue[vbus.Ports[i].Sending];
+		if (frame == 0 || own->length < frame->length || (own->length == frame->length && memcmp(own->data, frame->data, own->length) < 0))
+			frame = own;
+	}
+	vbus.Outcome = vbusSuccess;
+	for (int i = 0; i < vbus.PortsSize; i++) {
+		vbusPort_t *port = &vbus.Ports[i];
+		if (port->Wire != vbusSender)
+			continue;
+		lc_msgBuffered *own = &port->Queue[port->Sending];
+		if (own->length != frame->length || memcmp(own->data, frame->data, own->length)) {
+			port->Wire = vbusLoser;
+			if (port->Stats.State == VBus_ErrorActive)
+				vbus.Outcome = vbusError;
+		} else if (port->Faults.Errors > 0 && vbusChance() < port->Faults.Errors)
+			vbus.Outcome = vbusError;
+	}
+	if (vbus.Outcome == vbusSuccess) {
+		//somebody should acknowledge. Nodes sending same frame at once would drift apart on real bus,
+		//here they acknowledge each other instead of repeating it in lockstep forever
+		uint8_t active = 0;
+		for (int i = 0; i < vbus.PortsSize; i++)
+			if (vbus.Ports[i].Stats.State != VBus_BusOff)
+				active++;
+		if (active < 2)
+			vbus.Outcome = vbusAckError;
+	}
+
+	uint32_t nominal, data;
+	vbusFrameBits(frame, &nominal, &data);
+	uint64_t duration = vbusFrameTime(frame);
+	if (vbus.Outcome != vbusSuccess) {
+		//destroyed in the middle (at ACK slot for no acknowledge), then error flag, delimiter and interframe space
+		const uint32_t errorBits = 6 + 8 + 3;
+		uint32_t tail = 2 + 7 + 3;
+		uint32_t until = (vbus.Outcome == vbusAckError) ? nominal - tail : nominal / 2;
+		duration = (uint64_t) (until + errorBits) * 1000000000 / vbus.Config.Bitrate;
+		if (vbus.Outcome == vbusAckError) {
+			duration += (uint64_t) data * 1000000000 / vbus.Config.DataBitrate;
+			vbus.Stats.Bits += data;
+		}
+		vbus.Stats.Bits += until + errorBits;
+	} else
+		vbus.Stats.Bits += nominal + data;
+	vbus.BusySince = vbus.Stats.Time;
+	vbus.BusyUntil = vbus.Stats.Time + duration;
+	vbus.Stats.Busy += duration;
+}
+
+void vbusComplete(void) {
+	vbus.Busy = 0;
+	//bus-off recovery waits for 128 occurrences of 11 recessive bits, frame or error frame on wire gives only one
+	uint64_t recessive = (uint64_t) 11 * 1000000000 / vbus.Config.Bitrate;
+	uint64_t duration = vbus.BusyUntil - vbus.BusySince;
+	if (duration > recessive) {
+		for (int i = 0; i < vbus.PortsSize; i++) {
+			vbusPort_t *port = &vbus.Ports[i];
+			if (port->Stats.State == VBus_BusOff && port->RecoverAt != UINT64_MAX)
+				port->RecoverAt += duration - recessive;
+		}
+	}
+	lc_msgBuffered frame = { 0 };
+	for (int i = 0; i < vbus.PortsSize; i++)
+		if (vbus.Ports[i].Wire == vbusSender) {
+			frame = vbus.Ports[i].Queue[vbus.Ports[i].Sending];
+			break;
+		}
+	//bit error, frame stays queued
+	for (int i = 0; i < vbus.PortsSize; i++)
+		if (vbus.Ports[i].Wire == vbusLoser) {
+			vbus.Ports[i].Stats.TXErrors++;
+			vbus.Ports[i].Stats.TEC += 8;
+			vbusErrorCounters(&vbus.Ports[i]);
+		}
+
+	if (vbus.Outcome != vbusSuccess) {
+		vbus.Stats.ErrorFrames++;
+		for (int i = 0; i < vbus.PortsSize; i++) {
+			vbusPort_t *port = &vbus.Ports[i];
+			if (port->Stats.State == VBus_BusOff || port->Wire == vbusLoser)
+				continue;
+			if (port->Wire == vbusSender) {
+				port->Stats.TXErrors++;
+				//error passive transmitter doesn't count missing acknowledge
+				if (vbus.Outcome == vbusError || port->Stats.State == VBus_ErrorActive)
+					port->Stats.TEC += 8;
+			} else if (port->Stats.REC < 255)
+				port->Stats.REC++;
+			vbusErrorCounters(port);
+		}
+		//frame stays queued, controller repeats it
+		return;
+	}
+
+	vbus.Stats.Frames++;
+	for (int i = 0; i < vbus.PortsSize; i++) {
+		vbusPort_t *port = &vbus.Ports[i];
+		if (port->Wire == vbusSender) {
+			//transmitted, remove from queue
+			port->Stats.TXFrames++;
+			if (port->Stats.TEC)
+				port->Stats.TEC--;
+			port->Stats.Queued--;
+			vbus.Queued--;
+			memmove(&port->Queue[port->Sending], &port->Queue[port->Sending + 1], sizeof(lc_msgBuffered) * (port->Stats.Queued - port->Sending));
+			vbusErrorCounters(port);
+			continue;
+		}
+		if (port->Stats.State == VBus_BusOff)
+			continue;
+		if (port->Stats.REC)
+			port->Stats.REC--;
+		vbusErrorCounters(port);
+		if (port->Faults.Loss > 0 && vbusChance() < port->Faults.Loss) {
+			port->Stats.RXLost++;
+			continue;
+		}
+		if (vbusAccept(port, frame.header) == 0) {
+			port->Stats.RXFiltered++;
+			continue;
+		}
+		port->Stats.RXFrames++;
+		lc_msgBuffered copy = frame;
+		LC_ReceiveHandler(port->Node, copy.header, copy.data, copy.length);
+	}
+}
+
+void vbusErrorCounters(vbusPort_t *port) {
+	if (port->Stats.State == VBus_BusOff)
+		return;
+	if (port->Stats.TEC > 255) {
+		port->Stats.State = VBus_BusOff;
+		port->Stats.BusOffs++;
+		//128 occurrences of 11 recessive bits
+		if (vbus.Config.AutoRecovery)
+			port->RecoverAt = vbus.Stats.Time + (uint64_t) 128 * 11 * 1000000000 / vbus.Config.Bitrate;
+		else
+			port->RecoverAt = UINT64_MAX;
+	} else if (port->Stats.TEC > 127 || port->Stats.REC > 127)
+		port->Stats.State = VBus_ErrorPassive;
+	else
+		port->Stats.State = VBus_ErrorActive;
+}
+
+uint32_t vbusRandom(void) {
+	//xorshift32, same sequence for same seed
+	uint32_t x = vbus.Random;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	vbus.Random = x;
+	return x;
+}
+
+float vbusChance(void) {
+	return (vbusRandom() >> 8) * (1.0f / 16777216.0f);
+}
+
+void vbusBits(vbusStream_t *stream, uint32_t value, uint8_t count) {
+	for (int i = count - 1; i >= 0; i--) {
+		uint8_t bit = (value >> i) & 1;
+		if (stream->CRCon) {
+			uint8_t next = bit ^ ((stream->CRC >> 14) & 1);
+			stream->CRC = (stream->CRC << 1) & 0x7FFF;
+			if (next)
+				stream->CRC ^= 0x4599;
+		}
+		stream->Bits++;
+		if (bit == stream->Last)
+			stream->Run++;
+		else {
+			stream->Last = bit;
+			stream->Run = 1;
+		}
+		if (stream->Run == 5) {
+			//complement bit inserted, starts next run
+			stream->Stuffed++;
+			stream->Last = !bit;
+			stream->Run = 1;
+		}
+	}
+}
+
+/// Frame bits on wire
+/// @param frame
+/// @param nominal Bits at nominal bitrate
+/// @param data CAN FD bits at data bitrate
+void vbusFrameBits(const lc_msgBuffered *frame, uint32_t *nominal, uint32_t *data) {
+	vbusStream_t stream = { .CRCon = 1, .Last = 2 };
+	uint32_t id = frame->header.ToUint32 & 0x1FFFFFFF;
+	const uint8_t *bytes = (const uint8_t*) frame->data;
+	//end of frame: CRC delimiter, ACK slot and delimiter, EOF, interframe space
+	const uint32_t tail = 1 + 2 + 7 + 3;
+
+	//SOF, base ID, SRR, IDE, extended ID
+	vbusBits(&stream, 0, 1);
+	vbusBits(&stream, id >> 18, 11);
+	vbusBits(&stream, 3, 2);
+	vbusBits(&stream, id & 0x3FFFF, 18);
+	if (frame->length <= 8) {
+		//RTR, r1, r0, DLC, data, CRC15
+		vbusBits(&stream, frame->header.Request, 1);
+		vbusBits(&stream, 0, 2);
+		vbusBits(&stream, frame->length, 4);
+		if (frame->header.Request == 0)
+			for (int i = 0; i < frame->length; i++)
+				vbusBits(&stream, bytes[i], 8);
+		stream.CRCon = 0;
+		vbusBits(&stream, stream.CRC, 15);
+		*nominal = stream.Bits + stream.Stuffed + tail;
+		*data = 0;
+		return;
+	}
+	//RRS, FDF, res, BRS, then bitrate switch
+	vbusBits(&stream, 0x5, 4);
+	uint32_t arbitration = stream.Bits + stream.Stuffed;
+	static const uint8_t fdLength[] = { 12, 16, 20, 24, 32, 48, 64 };
+	uint8_t dlc = 15;
+	for (uint8_t i = 0; i < sizeof(fdLength); i++)
+		if (frame->length <= fdLength[i]) {
+			dlc = 9 + i;
+			break;
+		}
+	//ESI, DLC, data
+	vbusBits(&stream, 0, 1);
+	vbusBits(&stream, dlc, 4);
+	for (int i = 0; i < frame->length; i++)
+		vbusBits(&stream, bytes[i], 8);
+	//stuff count and CRC17/21 have fixed stuff bit every 4 bits
+	uint32_t crc = (frame->length <= 16) ? 17 : 21;
+	uint32_t fixed = 4 + crc + (4 + crc) / 4 + 1;
+	*nominal = arbitration + tail;
+	*data = stream.Bits + stream.Stuffed - arbitration + fixed;
+}
+
+uint64_t vbusFrameTime(const lc_msgBuffered *frame) {
+	uint32_t nominal, data;
+	vbusFrameBits(frame, &nominal, &data);
+	return (uint64_t) nominal * 1000000000 / vbus.Config.Bitrate + (uint64_t) data * 1000000000 / vbus.Config.DataBitrate;
+}
@@ -0,0 +1,75 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include "stdint.h"
+#include "levcan.h"
+
+#pragma once
+
+//In-process virtual CAN bus for tests and benchmarks. Nodes attach to ports, VBus_Run advances simulated
+//time: frames win 29b arbitration, take bit-stuffed wire time and are delivered through acceptance filters
+//by calling LC_ReceiveHandler. Single threaded, call managers of every node between VBus_Run calls
+
+//ports, one driver each
+#define VBUS_PORTS 128
+//frames queued by port: software FIFO and mailboxes
+#ifndef VBUS_TX_SIZE
+#define VBUS_TX_SIZE 32
+#endif
+//hardware mailboxes taking part in arbitration when VBus_Config_t.MailboxPriority is set
+#ifndef VBUS_MAILBOXES
+#define VBUS_MAILBOXES 3
+#endif
+//acceptance filters per port
+#define VBUS_FILTERS 14
+
+typedef struct {
+	uint32_t Bitrate; //nominal, bit/s
+	uint32_t DataBitrate; //CAN FD data phase, 0 - same as nominal
+	uint8_t MailboxPriority; //0 - queued frames sent in order (bxCAN TXFP), 1 - lowest ID of mailboxes first
+	uint8_t AutoRecovery; //bus-off ends after 128 * 11 recessive bits
+	uint32_t Seed; //fault injection random seed, 0 - default
+} VBus_Config_t;
+
+typedef struct {
+	float Loss; //probability of received frame being dropped by this port, RX overrun
+	float Errors; //probability of transmitted frame destroyed by error frame and repeated
+} VBus_Faults_t;
+
+typedef enum {
+	VBus_ErrorActive, VBus_ErrorPassive, VBus_BusOff
+} VBus_State_t;
+
+typedef struct {
+	uint32_t TXFrames; //frames won arbitration and acknowledged
+	uint32_t RXFrames; //frames accepted by filters and given to node
+	uint32_t RXFiltered; //frames rejected by acceptance filters
+	uint32_t RXLost; //frames dropped by fault injection
+	uint32_t TXErrors; //error frames during own transmission
+	uint32_t ArbitrationLost;
+	uint32_t BusOffs;
+	uint16_t TEC; //transmit error counter
+	uint16_t REC; //receive error counter
+	uint8_t State; //VBus_State_t
+	uint8_t Queued; //frames waiting for bus
+} VBus_PortStats_t;
+
+typedef struct {
+	uint64_t Time; //simulated ns
+	uint64_t Busy; //ns bus was not idle
+	uint32_t Frames; //frames transmitted successfully
+	uint32_t ErrorFrames;
+	uint64_t Bits; //all bits on wire, stuffing and error frames included
+} VBus_Stats_t;
+
+void VBus_Init(const VBus_Config_t *config);
+int VBus_Attach(LC_NodeDescriptor_t *node);
+void VBus_Run(uint32_t us);
+void VBus_RunUntil(uint64_t time);
+uint64_t VBus_NextEvent(void);
+uint64_t VBus_Time(void);
+
+void VBus_SetFaults(int port, VBus_Faults_t faults);
+void VBus_ForceBusOff(int port);
+void VBus_GetStats(VBus_Stats_t *stats, int port, VBus_PortStats_t *portStats);
+uint32_t VBus_FrameTime(LC_HeaderPacked_t header, const uint32_t *data, uint8_t length);
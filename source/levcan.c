@@ -4,6 +4,8 @@
 #include "levcan.h"
 #include "levcan_internal.h"
 #include "levcan_address.h"
+#include "levcan_slab.h"
+#include "levcan_trace.h"
 
 #include "string.h"
 #include "stdlib.h"
@@ -23,43 +25,114 @@
 #if LEVCAN_OBJECT_DATASIZE < 8
 #error "LEVCAN_OBJECT_DATASIZE should be more than one 8 byte for static memory"
 #endif
+#if LEVCAN_MAX_FRAME != 8 && LEVCAN_MAX_FRAME != 12 && LEVCAN_MAX_FRAME != 16 && LEVCAN_MAX_FRAME != 20 && LEVCAN_MAX_FRAME != 24 \
+	&& LEVCAN_MAX_FRAME != 32 && LEVCAN_MAX_FRAME != 48 && LEVCAN_MAX_FRAME != 64
+#error "LEVCAN_MAX_FRAME should be 8 or CAN FD data length"
+#endif
+#if (LEVCAN_OBJECT_HASH_SIZE & (LEVCAN_OBJECT_HASH_SIZE - 1)) != 0
+#error "LEVCAN_OBJECT_HASH_SIZE should be power of two"
+#endif
+#if !defined(LEVCAN_USE_RTOS_QUEUE) && ((LEVCAN_RX_SIZE & (LEVCAN_RX_SIZE - 1)) != 0 || LEVCAN_RX_SIZE > 0x8000)
+#error "LEVCAN_RX_SIZE should be power of two, up to 32768"
+#endif
 
-#define toDeleteMark (1<<3)
+#define toDeleteMark (1<<4)
 #define RXReadyMark (1<<2)
+#define indexEmpty 0xFFFF
+//LC_SendMessageV segment list: in object data for static memory
+#ifdef LEVCAN_MEM_STATIC
+#define txSegments(object) ((lc_txSegments_t*) (object)->Data)
+#else
+#define txSegments(object) ((lc_txSegments_t*) (object)->Pointer)
+#endif
+//windowed TCP frame: sequence byte + data
+#define windowPayload(object) ((object)->FrameSize - 1)
+//announce: RTS without EoM shorter than full frame. data: window size, total length (LSB first)
+#define announceSize 5
+#define isAnnounce(msg) ((msg)->header.RTS_CTS && (msg)->header.EoM == 0 && (msg)->length < 8)
 
 enum {
 	Read, Write
 };
+//LC_MsgStatistics_t counters
+enum {
+	statFramesRX, statFramesTX, statErrors
+};
 
 //#### PRIVATE VARIABLES ####
-#ifdef DEBUG
-volatile uint32_t lc_collision_cntr = 0;
-volatile uint32_t lc_receive_ovfl_cntr = 0;
-#endif
+const uint8_t lc_txQuantum[LC_Priority_High + 1] = LEVCAN_TX_QUANTUM;
 #ifdef LEVCAN_MEM_STATIC
 lc_Extensions_t lc_ExtensionsStatic[LEVCAN_MAX_OWN_NODES];
+//node that holds each static extension slot
+LC_NodeDescriptor_t *lc_ExtensionsOwner[LEVCAN_MAX_OWN_NODES];
 #endif
 //#### PRIVATE FUNCTIONS ####
 LC_ObjectRecord_t findObjectRecord(LC_NodeDescriptor_t *node, uint16_t messageID, int32_t size, uint8_t read_write, uint8_t nodeID);
+int32_t extractRecords(LC_Object_t *object, LC_ObjectRecord_t **records, LC_ObjectRecord_t *buffer);
+uint8_t matchRecord(LC_ObjectRecord_t *record, int32_t size, uint8_t read_write, uint8_t nodeID);
+LC_Object_t* indexObject(LC_NodeDescriptor_t *node, lc_objIndex_t *index, uint16_t position);
+lc_objIndexSlot_t* indexSlot(lc_objIndex_t *index, uint16_t messageID);
+LC_Return_t indexBuild(LC_NodeDescriptor_t *node, lc_objIndex_t **result);
+void indexPublish(LC_NodeDescriptor_t *node, lc_objIndex_t *index);
+void indexRelease(lc_objIndex_t *index);
+void indexFree(lc_objIndex_t *index);
 
 uint16_t objectRXproceed(LC_NodeDescriptor_t *node, lc_objBuffered *object, lc_msgBuffered *msg);
-uint16_t objectTXproceed(LC_NodeDescriptor_t *node, lc_objBuffered *object, LC_HeaderPacked_t *request, int timeout);
+uint16_t objectTXproceed(LC_NodeDescriptor_t *node, lc_objBuffered *object, lc_msgBuffered *request, int timeout);
+uint16_t windowRXproceed(LC_NodeDescriptor_t *node, lc_objBuffered *object, lc_msgBuffered *msg);
+uint16_t windowTXproceed(LC_NodeDescriptor_t *node, lc_objBuffered *object, lc_msgBuffered *request, int timeout);
+LC_Return_t objectRXstore(LC_NodeDescriptor_t *node, lc_objBuffered *object, const void *data, int32_t length);
+void objectRXcomplete(LC_NodeDescriptor_t *node, lc_objBuffered *object);
+void sendCTS(LC_NodeDescriptor_t *node, lc_objBuffered *object, uint8_t parity, uint8_t credits);
+LC_Return_t sendAnnounce(LC_NodeDescriptor_t *node, lc_objBuffered *object, uint8_t window);
+void sendReject(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header);
+uint16_t sendFrames(LC_NodeDescriptor_t *node, lc_msgBuffered *frames, uint16_t count);
+uint8_t linkPayload(LC_NodeDescriptor_t *node, uint16_t target);
+uint8_t framePad(void *data, uint8_t length);
+uint8_t frameLength(const lc_msgBuffered *msg);
+LC_Return_t lc_sendFrame(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header, uint32_t *data, uint8_t length);
+void countMessage(LC_NodeDescriptor_t *node, uint16_t msgID, uint8_t counter);
+uint16_t rxDequeue(LC_NodeDescriptor_t *node, lc_msgBuffered *buffer, uint16_t max);
 LC_Return_t objectRXfinish(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header, char *data, int32_t size, uint8_t memfree);
-void deleteObject(LC_NodeDescriptor_t *node, lc_objBuffered *obj, lc_objBuffered **start, lc_objBuffered **end);
+void deleteObject(LC_NodeDescriptor_t *node, lc_objBuffered *obj, uint8_t direction);
+void objectTimer(LC_NodeDescriptor_t *node, lc_objBuffered *object, uint8_t direction);
+lc_objBuffered* txCreate(LC_NodeDescriptor_t *node, LC_ObjectRecord_t *object, uint16_t index, uint8_t payload, LC_Return_t *result);
+void txStart(LC_NodeDescriptor_t *node, lc_objBuffered *object, uint8_t multiframe);
+void txCopy(lc_objBuffered *object, int32_t position, void *to, int32_t length);
+void txRelease(lc_objBuffered *object);
+LC_Return_t sendSingle(LC_NodeDescriptor_t *node, LC_ObjectRecord_t *object, uint16_t index, uint32_t *data, uint8_t size);
+void txTimeout(void *context, lc_timer_t *timer);
+void rxTimeout(void *context, lc_timer_t *timer);
+void publishTimeout(void *context, lc_timer_t *timer);
+void requestTimeout(void *context, lc_timer_t *timer);
+uint8_t requestUnlink(LC_NodeDescriptor_t *node, LC_Request_t *request);
+uint8_t requestComplete(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header, char *data, int32_t size);
+void publishChangeOfState(LC_NodeDescriptor_t *node, LC_PublishEntry_t *entry);
+uint8_t publishChanged(LC_PublishEntry_t *entry, const char *data, int32_t size);
+LC_ObjectRecord_t publishRecord(LC_NodeDescriptor_t *node, LC_PublishEntry_t *entry, char *buffer);
+const LC_Map_t* findMap(LC_NodeDescriptor_t *node, uint16_t messageID);
+int32_t mapPack(LC_NodeDescriptor_t *node, const LC_Map_t *map, uint8_t nodeID, char *buffer);
+LC_Return_t mapUnpack(LC_NodeDescriptor_t *node, const LC_Map_t *map, LC_HeaderPacked_t header, char *data, int32_t size);
+void insertObject(LC_NodeDescriptor_t *node, lc_objBuffered *obj, uint8_t direction);
+void txSchedule(LC_NodeDescriptor_t *node);
+uint8_t readyPush(LC_NodeDescriptor_t *node, lc_objBuffered *obj);
+lc_objBuffered* readyPop(LC_NodeDescriptor_t *node, uint8_t priority);
+void readyRemove(LC_NodeDescriptor_t *node, lc_objBuffered *obj);
+uint16_t hashObject(uint16_t msgID, uint8_t target, uint8_t source);
 uint8_t hashMultiplicative(const uint8_t *input, uint8_t len, uint8_t start);
 #ifdef LEVCAN_MEM_STATIC
 lc_objBuffered* getFreeObject(LC_NodeDescriptor_t *node);
 void releaseObject(LC_NodeDescriptor_t *node, lc_objBuffered *obj);
 #endif
 
-lc_objBuffered* findObject(lc_objBuffered *array, uint16_t msgID, uint8_t target, uint8_t source);
+lc_objBuffered* findObject(LC_NodeDescriptor_t *node, uint8_t direction, uint16_t msgID, uint8_t target, uint8_t source);
 
 //#### EXTERNAL MODULES ####
 extern LC_Return_t lc_sendDiscoveryRequest(LC_NodeDescriptor_t *node, uint16_t target);
+extern void lc_nodeTimeout(void *context, lc_timer_t *timer);
 //#### FUNCTIONS
 
 LC_Return_t LC_InitNodeDescriptor(LC_NodeDescriptor_t *node) {
-	static int init = 0;
 	if (node == 0)
 		return LC_ObjectError;
 	//clean up
@@ -90,22 +163,42 @@ LC_Return_t LC_InitNodeDescriptor(LC_NodeDescriptor_t *node) {
 	if (sizeof(LC_NodeTableEntry_t[LEVCAN_MAX_TABLE_NODES]) > 0 && node->NodeTable->Table == 0)
 		return LC_MallocFail;
 #else  // LEVCAN_MEM_STATIC
-	//todo add overflow check
-	node->Extensions = &lc_ExtensionsStatic[init];
+	//same descriptor re-initialized keeps its slot, otherwise take a free one
+	int slot = -1;
+	for (int i = 0; i < LEVCAN_MAX_OWN_NODES; i++) {
+		if (lc_ExtensionsOwner[i] == node) {
+			slot = i;
+			break;
+		}
+		if (slot < 0 && lc_ExtensionsOwner[i] == 0)
+			slot = i;
+	}
+	if (slot < 0)
+		return LC_MallocFail;
+	lc_ExtensionsOwner[slot] = node;
+	node->Extensions = &lc_ExtensionsStatic[slot];
+	memset(node->Extensions, 0, sizeof(lc_Extensions_t));
 	node->NodeTable = &node->NodeTableStatic;
 	node->NodeTable->Table = &node->NodeTableEntryStatic[0];
 
-	node->TxRxObjects.objectBuffer_freeID = 0;
-	for (int i = 0; i < LEVCAN_OBJECT_SIZE; i++) {
+	node->TxRxObjects.objectFree = 0;
+	for (int i = LEVCAN_OBJECT_SIZE - 1; i >= 0; i--) {
 		node->TxRxObjects.objectBuffer[i].Position = -1;    //empty object
 		node->TxRxObjects.objectBuffer[i].Pointer = 0;
-		node->TxRxObjects.objectBuffer[i].Next = 0;
+		node->TxRxObjects.objectBuffer[i].Next = (intptr_t*) node->TxRxObjects.objectFree;
 		node->TxRxObjects.objectBuffer[i].Previous = 0;
+		node->TxRxObjects.objectFree = &node->TxRxObjects.objectBuffer[i];
 	}
 #endif // LEVCAN_MEM_STATIC
 
-	for (int i = 0; i < LEVCAN_MAX_TABLE_NODES; i++)
+	lc_timerInit(&node->Timers);
+#ifdef LEVCAN_CLOCK
+	node->ClockSync = LEVCAN_CLOCK();
+#endif
+	for (int i = 0; i < LEVCAN_MAX_TABLE_NODES; i++) {
 		node->NodeTable->Table[i].ShortName.NodeID = LC_Broadcast_Address;
+		lc_timerSetup(&node->NodeTable->Table[i].Timer, lc_nodeTimeout, &node->NodeTable->Table[i]);
+	}
 	//node->NodeTable->FreeSlots = LEVCAN_MAX_TABLE_NODES;
 	node->NodeTable->TableSize = LEVCAN_MAX_TABLE_NODES;
 
@@ -114,7 +207,7 @@ LC_Return_t LC_InitNodeDescriptor(LC_NodeDescriptor_t *node) {
 	node->TxRxObjects.rxFIFO_out = 0;
 	memset(node->TxRxObjects.rxFIFO, 0, sizeof(node->TxRxObjects.rxFIFO));
 #endif // !LEVCAN_USE_RTOS_QUEUE
-	init++;
+	memset(&node->TxRxObjects.Statistics, 0, sizeof(node->TxRxObjects.Statistics));
 	return LC_Ok;
 }
 
@@ -192,6 +285,11 @@ LC_Return_t LC_CreateNode(LC_NodeDescriptor_t *node) {
 	initObject->MsgID = LC_SYS_SerialNumber;
 	initObject->Size = sizeof(node->Serial);
 
+	//dictionary is complete now, failed index falls back to linear search
+	LC_UpdateObjectIndex(node);
+	LC_PublishStart(node);
+	node->ShortName.ExtTransfer = (LEVCAN_TCP_WINDOW > 0);
+	node->ShortName.CanFD = (LEVCAN_MAX_FRAME > 8);
 	//begin network discovery for start
 	node->LastTXtime = 0;
 	LC_ConfigureFilters(node);
@@ -200,6 +298,262 @@ LC_Return_t LC_CreateNode(LC_NodeDescriptor_t *node) {
 	return LC_Ok;
 }
 
+/// Arms timers of publish table entries. Fixed phases count from now, LC_PublishAutoPhase entries
+/// are spread evenly over their periods, so entries with the same period don't fire on the same tick.
+/// Change-of-state entries send full value at their phase, then on change and keep-alive.
+/// @param node
+/// @return LC_Ok, LC_DataError if some entry has no readable object in dictionary
+LC_Return_t LC_PublishStart(LC_NodeDescriptor_t *node) {
+	if (node == 0)
+		return LC_DataError;
+	LC_Return_t result = LC_Ok;
+	uint16_t autoCount = 0;
+	for (int i = 0; i < node->PublishSize; i++) {
+		if (node->Publish[i].Period && node->Publish[i].Phase == LC_PublishAutoPhase)
+			autoCount++;
+	}
+	uint16_t autoIndex = 0;
+	for (int i = 0; i < node->PublishSize; i++) {
+		LC_PublishEntry_t *entry = &node->Publish[i];
+		if (entry->Timer.Link)
+			lc_timerStop(&node->Timers, &entry->Timer);
+		lc_timerSetup(&entry->Timer, publishTimeout, entry);
+		if (entry->Period == 0)
+			continue;
+		if (findObjectRecord(node, entry->MsgID, 0, Read, entry->Target).Address == 0)
+			result = LC_DataError;
+		uint32_t phase = entry->Phase;
+		if (entry->Phase == LC_PublishAutoPhase)
+			phase = (uint32_t) entry->Period * autoIndex++ / autoCount;
+		//snapshot is not valid yet, first check sends as keep-alive
+		entry->LastSent = lc_now(node) + phase - entry->Period;
+		lc_timerStartAt(&node->Timers, &entry->Timer, entry->LastSent + entry->Period);
+	}
+	LC_NetworkManagerWakeup(node);
+	return result;
+}
+
+void publishTimeout(void *context, lc_timer_t *timer) {
+	LC_NodeDescriptor_t *node = context;
+	LC_PublishEntry_t *entry = timer->Owner;
+	if (entry->Snapshot) {
+		publishChangeOfState(node, entry);
+		return;
+	}
+	//next send counted from planned tick, late call doesn't move schedule, missed periods are skipped
+	uint32_t late = node->Timers.Now - timer->Expires;
+	lc_timerStartAt(&node->Timers, timer, timer->Expires + entry->Period * (late / entry->Period + 1));
+
+	if (node->State != LCNodeState_Online)
+		return;
+	char packed[8];
+	LC_ObjectRecord_t record = publishRecord(node, entry, packed);
+	if (record.Address == 0)
+		return;
+	record.NodeID = entry->Target;
+	record.Attributes.Priority = entry->Priority;
+	LC_SendMessage(node, &record, entry->MsgID);
+}
+
+/// Change-of-state check, runs every Inhibit ms. Sends if object changed beyond deadband since
+/// last sent snapshot, or if keep-alive period passed. Failed send is retried on next check.
+void publishChangeOfState(LC_NodeDescriptor_t *node, LC_PublishEntry_t *entry) {
+	lc_timerStart(&node->Timers, &entry->Timer, entry->Inhibit ? entry->Inhibit : 1);
+
+	if (node->State != LCNodeState_Online) {
+		//receivers may have lost state, send it right after coming online
+		entry->LastSent = node->Timers.Now - entry->Period;
+		return;
+	}
+	char packed[8];
+	LC_ObjectRecord_t record = publishRecord(node, entry, packed);
+	if (record.Address == 0)
+		return;
+	char *data = record.Address;
+	if (record.Attributes.Pointer)
+		data = *(char**) data;
+	int32_t size = record.Size < 0 ? -record.Size : record.Size;
+	//function objects have no value to compare, keep-alive only
+	uint8_t send = (node->Timers.Now - entry->LastSent) >= entry->Period;
+	if (send == 0 && record.Attributes.Function == 0)
+		send = publishChanged(entry, data, size);
+	if (send == 0)
+		return;
+
+	record.NodeID = entry->Target;
+	record.Attributes.Priority = entry->Priority;
+	if (LC_SendMessage(node, &record, entry->MsgID) != LC_Ok)
+		return;
+	if (record.Attributes.Function == 0)
+		memcpy(entry->Snapshot, data, size);
+	entry->LastSent = node->Timers.Now;
+}
+
+/// Compares object with last sent snapshot
+/// @param entry
+/// @param data Current object value
+/// @param size Object size in bytes
+/// @return 1 if some element changed more than entry->Deadband
+uint8_t publishChanged(LC_PublishEntry_t *entry, const char *data, int32_t size) {
+	static const uint8_t elementSize[] = { 1, 1, 1, 2, 2, 4, 4, 4 };
+	const char *snapshot = entry->Snapshot;
+	if (memcmp(snapshot, data, size) == 0)
+		return 0;
+	uint8_t type = entry->DeadbandType;
+	if (type == LC_Deadband_Exact || type > LC_Deadband_Float)
+		return 1;
+
+	int32_t step = elementSize[type];
+	int32_t i = 0;
+	for (; i + step <= size; i += step) {
+		union {
+			int8_t i8;
+			uint8_t u8;
+			int16_t i16;
+			uint16_t u16;
+			int32_t i32;
+			uint32_t u32;
+			float f;
+		} now, last;
+		//objects may be packed
+		memcpy(&now, &data[i], step);
+		memcpy(&last, &snapshot[i], step);
+		float delta;
+		switch (type) {
+		case LC_Deadband_Int8:
+			delta = now.i8 - last.i8;
+			break;
+		case LC_Deadband_Uint8:
+			delta = now.u8 - last.u8;
+			break;
+		case LC_Deadband_Int16:
+			delta = now.i16 - last.i16;
+			break;
+		case LC_Deadband_Uint16:
+			delta = now.u16 - last.u16;
+			break;
+		case LC_Deadband_Int32:
+			delta = (int64_t) now.i32 - last.i32;
+			break;
+		case LC_Deadband_Uint32:
+			delta = (int64_t) now.u32 - last.u32;
+			break;
+		default:
+			//NaN compares false, send it
+			delta = now.f - last.f;
+			if (delta != delta)
+				return 1;
+			break;
+		}
+		if (delta < 0)
+			delta = -delta;
+		if (delta > entry->Deadband)
+			return 1;
+	}
+	//tail that doesn't fit element type
+	return memcmp(&snapshot[i], &data[i], size - i) != 0;
+}
+
+/// Finds data to publish, maps are packed to buffer
+/// @param node
+/// @param entry
+/// @param buffer 8 bytes for packed map
+/// @return Record to send, Address is 0 if nothing found
+LC_ObjectRecord_t publishRecord(LC_NodeDescriptor_t *node, LC_PublishEntry_t *entry, char *buffer) {
+	const LC_Map_t *map = findMap(node, entry->MsgID);
+	if (map == 0)
+		return findObjectRecord(node, entry->MsgID, 0, Read, entry->Target);
+
+	LC_ObjectRecord_t record = { 0 };
+	int32_t size = mapPack(node, map, entry->Target, buffer);
+	if (size < 0)
+		return record;
+	record.Attributes.Readable = 1;
+	record.Size = size;
+	record.Address = buffer;
+	return record;
+}
+
+const LC_Map_t* findMap(LC_NodeDescriptor_t *node, uint16_t messageID) {
+	for (int i = 0; i < node->MapsSize; i++) {
+		if (node->Maps[i].MsgID == messageID)
+			return &node->Maps[i];
+	}
+	return 0;
+}
+
+/// Reads map fields from dictionary into one frame payload
+/// @param node
+/// @param map
+/// @param nodeID Receiver, filters readable objects
+/// @param buffer 8 bytes
+/// @return Packed size, -1 if some field is not readable variable or map doesn't fit frame
+int32_t mapPack(LC_NodeDescriptor_t *node, const LC_Map_t *map, uint8_t nodeID, char *buffer) {
+	int32_t position = 0;
+	for (int i = 0; i < map->FieldsSize; i++) {
+		const LC_MapField_t *field = &map->Fields[i];
+		if (position + field->Size > 8)
+			return -1;
+		LC_ObjectRecord_t record = findObjectRecord(node, field->MsgID, field->Size, Read, nodeID);
+		if (record.Address == 0 || record.Attributes.Function)
+			return -1;
+		char *data = record.Address;
+		if (record.Attributes.Pointer)
+			data = *(char**) data;
+		memcpy(&buffer[position], data, field->Size);
+		position += field->Size;
+	}
+	return position;
+}
+
+/// Writes received frame to map fields through object dictionary, same as separate messages
+/// @param node
+/// @param map
+/// @param header Received header, MsgID is replaced by field ID
+/// @param data
+/// @param size Received length, fields that don't fit are skipped
+/// @return LC_Ok, LC_ObjectError if some field wasn't written
+LC_Return_t mapUnpack(LC_NodeDescriptor_t *node, const LC_Map_t *map, LC_HeaderPacked_t header, char *data, int32_t size) {
+	LC_Return_t ret = LC_Ok;
+	int32_t position = 0;
+	for (int i = 0; i < map->FieldsSize; i++) {
+		const LC_MapField_t *field = &map->Fields[i];
+		if (position + field->Size > size) {
+			ret = LC_ObjectError;
+			break;
+		}
+		header.MsgID = field->MsgID;
+		if (objectRXfinish(node, header, &data[position], field->Size, 0))
+			ret = LC_ObjectError;
+		position += field->Size;
+	}
+	return ret;
+}
+
+/// Sends node->Maps entry, fields are read from dictionary and packed in one frame
+/// @param node
+/// @param index Map MsgID
+/// @param target Receiver node ID, LC_Broadcast_Address for all
+/// @param priority LC_Priority_t
+/// @return LC_ObjectError if map not found or can't be packed, or LC_SendMessage result
+LC_Return_t LC_SendMap(LC_NodeDescriptor_t *node, uint16_t index, uint8_t target, uint8_t priority) {
+	if (node == 0)
+		return LC_DataError;
+	const LC_Map_t *map = findMap(node, index);
+	if (map == 0)
+		return LC_ObjectError;
+	char packed[8];
+	int32_t size = mapPack(node, map, target, packed);
+	if (size < 0)
+		return LC_ObjectError;
+	LC_ObjectRecord_t record = { 0 };
+	record.NodeID = target;
+	record.Attributes.Priority = priority;
+	record.Size = size;
+	record.Address = packed;
+	return LC_SendMessage(node, &record, index);
+}
+
 LC_Object_t* lc_registerSystemObjects(LC_NodeDescriptor_t *node, uint8_t count) {
 	if (node == 0) {
 		return 0;
@@ -209,24 +563,40 @@ LC_Object_t* lc_registerSystemObjects(LC_NodeDescriptor_t *node, uint8_t count)
 		return 0;
 	}
 	LC_Object_t *obj = &node->SystemObjects[node->SystemSize];
+	//published index keeps its own SystemSize, new objects are found after lc_indexSystemObjects
 	node->SystemSize += count;
 
 	return obj;
 }
 
-lc_objBuffered* findObject(lc_objBuffered *array, uint16_t msgID, uint8_t target, uint8_t source) {
-	lc_objBuffered *obj = array;
+/// Service filled objects taken by lc_registerSystemObjects. Index of node created before is rebuilt,
+/// LC_CreateNode builds it otherwise
+/// @param node
+void lc_indexSystemObjects(LC_NodeDescriptor_t *node) {
+	if (node->State != LCNodeState_Disabled)
+		LC_UpdateObjectIndex(node);
+}
+
+lc_objBuffered* findObject(LC_NodeDescriptor_t *node, uint8_t direction, uint16_t msgID, uint8_t target, uint8_t source) {
+	volatile void **buckets = (direction == LC_TX) ? node->TxRxObjects.objTXhash : node->TxRxObjects.objRXhash;
+	lc_objBuffered *obj = (lc_objBuffered*) buckets[hashObject(msgID, target, source)];
 	while (obj) {
 		//same source and same ID ?
 		//one ID&source can send only one message length a time
 		if (obj->Header.MsgID == msgID && obj->Header.Target == target && obj->Header.Source == source && obj->FlagsTotal < toDeleteMark) {
 			return obj;
 		}
-		obj = (lc_objBuffered*) obj->Next;
+		obj = (lc_objBuffered*) obj->HashNext;
 	}
 	return 0;
 }
 
+uint16_t hashObject(uint16_t msgID, uint8_t target, uint8_t source) {
+	uint32_t key = ((uint32_t) msgID << 14) | ((uint32_t) target << 7) | source;
+	//fibonacci hashing, top bits are best mixed
+	return ((key * 2654435761u) >> 16) & (LEVCAN_OBJECT_HASH_SIZE - 1);
+}
+
 uint8_t hashMultiplicative(const uint8_t *input, uint8_t len, uint8_t start) {
 	uint8_t hash = start;
 	for (uint8_t i = 0; i < len; ++i)
@@ -237,33 +607,59 @@ uint8_t hashMultiplicative(const uint8_t *input, uint8_t len, uint8_t start) {
 void LC_ReceiveHandler(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header, uint32_t *data, uint8_t length) {
 	if (node == 0)
 		return;
+	//ISR may preempt manager counting same statistics
+	lc_fetch_inc(&node->TxRxObjects.Statistics.FramesRX);
+	countMessage(node, header.MsgID, statFramesRX);
+#if LEVCAN_MAX_FRAME > 8
+	if (length > 8 && header.Request == 0) {
+		//CAN FD, padding size in last byte. Frames up to 8 bytes and requests are never padded
+		if (length > LEVCAN_MAX_FRAME || ((uint8_t*) data)[length - 1] > length - 1 - 9)
+			return;
+		length -= 1 + ((uint8_t*) data)[length - 1];
+	}
+#endif
 #ifdef LEVCAN_USE_RTOS_QUEUE
 	YieldNeeded_t yield = 0;
 	//packing
 	lc_msgBuffered msgRX;
 	msgRX.data[0] = data[0];
 	msgRX.data[1] = data[1];
+#if LEVCAN_MAX_FRAME > 8
+	if (length > 8 && header.Request == 0)
+		memcpy(&msgRX.data[2], &data[2], length - 8);
+#endif
 	msgRX.length = length;
 	msgRX.header = header;
 	//add to queue
-	LC_QueueSendToBackISR(node->TxRxObjects.rxQueue, &msgRX, &yield);
+	if (!LC_QueueSendToBackISR(node->TxRxObjects.rxQueue, &msgRX, &yield)) {
+		lc_fetch_inc(&node->TxRxObjects.Statistics.RXOverflow);
+		countMessage(node, header.MsgID, statErrors);
+		lc_trace(node, LC_TraceRXOverflow, header.MsgID, header.Source, header.Target, 0);
+	}
 
 	LC_RTOSYieldISR(yield);
 #else
 
-	if (node->TxRxObjects.rxFIFO_in == ((node->TxRxObjects.rxFIFO_out - 1 + LEVCAN_RX_SIZE) % LEVCAN_RX_SIZE)) {
-#ifdef DEBUG
-		lc_receive_ovfl_cntr++;
-#endif
+	//single producer: only this handler writes rxFIFO_in
+	uint16_t in = node->TxRxObjects.rxFIFO_in;
+	if ((uint16_t) (in - lc_load_acquire(&node->TxRxObjects.rxFIFO_out)) >= LEVCAN_RX_SIZE) {
+		lc_fetch_inc(&node->TxRxObjects.Statistics.RXOverflow);
+		countMessage(node, header.MsgID, statErrors);
+		lc_trace(node, LC_TraceRXOverflow, header.MsgID, header.Source, header.Target, 0);
 		return;
 	}
 	//store in rx buffer
-	lc_msgBuffered *msgRX = &node->TxRxObjects.rxFIFO[node->TxRxObjects.rxFIFO_in]; //less size in O2 with pointer?! maybe volatile problem
+	lc_msgBuffered *msgRX = &node->TxRxObjects.rxFIFO[in & (LEVCAN_RX_SIZE - 1)];
 	msgRX->data[0] = data[0];
 	msgRX->data[1] = data[1];
+#if LEVCAN_MAX_FRAME > 8
+	if (length > 8 && header.Request == 0)
+		memcpy(&msgRX->data[2], &data[2], length - 8);
+#endif
 	msgRX->length = length;
 	msgRX->header = header;
-	node->TxRxObjects.rxFIFO_in = (node->TxRxObjects.rxFIFO_in + 1) % LEVCAN_RX_SIZE;
+	//publish message after it is written
+	lc_store_release(&node->TxRxObjects.rxFIFO_in, (uint16_t) (in + 1));
 
 #endif
 }
@@ -273,136 +669,338 @@ void LC_NetworkManager(LC_NodeDescriptor_t *node, uint32_t time) {
 		return;
 
 	LC_AddressManager(node, time);
-	//count work time and clean up
-	lc_objBuffered *txProceed = (lc_objBuffered*) node->TxRxObjects.objTXbuf_start;
-	while (txProceed) {
-		lc_objBuffered *next = (lc_objBuffered*) txProceed->Next;
-		txProceed->Time_since_comm += time;
-
-		//global timeout
-		if (txProceed->Time_since_comm > LEVCAN_MESSAGE_TIMEOUT) {
-#ifdef LEVCAN_TRACE
-			trace_printf("TX object deleted by timeout:%d\n", txProceed->Header.MsgID);
+#ifdef LEVCAN_CLOCK
+	node->ClockSync += time;
 #endif
-			txProceed->Flags.ToDelete = 1;
-		}
-		if (txProceed->FlagsTotal >= toDeleteMark) {
-			//garbage collector
+	//only expired transfer and node timers are called
+	lc_timerAdvance(&node->Timers, time, node);
+	//send what is left after timers and receive manager
+	txSchedule(node);
+}
 
-#ifndef LEVCAN_MEM_STATIC
-			if (txProceed->Flags.TXcleanup) {
-				lcfree(txProceed->Pointer);
-			}
+/// Runs network manager and returns time until its next deadline, use instead of periodic LC_NetworkManager calls.
+/// Task may sleep till this deadline, new transfers and received claims call LC_NetworkManagerWakeup.
+/// File server deadline is not included: LC_FileServer usually runs in own task woken by LC_FileServerOnReceive,
+/// task calling both managers sleeps for minimum of this and LC_FileServerDeadline
+/// @param node
+/// @param time Time passed since previous call, ms
+/// @return Time to next call, ms. LC_NoDeadline if there is nothing to wait for
+uint32_t LC_NetworkManagerTickless(LC_NodeDescriptor_t *node, uint32_t time) {
+	if (node == 0)
+		return LC_NoDeadline;
+
+	LC_NetworkManager(node, time);
+	//TX buffer was full, poll till it drains
+	for (int prio = LC_Priority_Low; prio <= LC_Priority_High; prio++) {
+		if (node->TxRxObjects.txReady_start[prio])
+			return 1;
+	}
+	//retransmits, node timeouts
+	uint32_t next = lc_timerNext(&node->Timers);
+	//address claim and heartbeat
+	uint32_t address = LC_AddressDeadline(node);
+	if (address < next)
+		next = address;
+	return next;
+}
+
+/// Time for stamps and timers started outside of network manager. Timers.Now stays still while tickless
+/// manager sleeps, LEVCAN_CLOCK adds time passed since manager call
+/// @param node
+/// @return Timers.Now based time, ms
+uint32_t lc_now(LC_NodeDescriptor_t *node) {
+#ifdef LEVCAN_CLOCK
+	int32_t ahead = (int32_t) (LEVCAN_CLOCK() - node->ClockSync);
+	if (ahead > 0)
+		return node->Timers.Now + ahead;
 #endif
-			txProceed->Pointer = 0;
-			deleteObject(node, txProceed, (lc_objBuffered**) &node->TxRxObjects.objTXbuf_start, (lc_objBuffered**) &node->TxRxObjects.objTXbuf_end);
-		} else if (txProceed->Flags.TCP == 0) {
-			//UDP mode send data continuously
-			objectTXproceed(node, txProceed, 0, LC_Ok);
+	return node->Timers.Now;
+}
+
+void txTimeout(void *context, lc_timer_t *timer) {
+	LC_NodeDescriptor_t *node = context;
+	lc_objBuffered *txProceed = timer->Owner;
+	int32_t elapsed = (int32_t) (node->Timers.Now - txProceed->LastComm);
+
+	//global timeout
+	if (elapsed > LEVCAN_MESSAGE_TIMEOUT && txProceed->FlagsTotal < toDeleteMark) {
+		lc_trace(node, LC_TraceTXTimeout, txProceed->Header.MsgID, txProceed->Header.Source, txProceed->Header.Target, txProceed->Position);
+		txProceed->Flags.ToDelete = 1;
+		node->TxRxObjects.Statistics.TXTimeouts++;
+		countMessage(node, txProceed->Header.MsgID, statErrors);
+	}
+	if (txProceed->FlagsTotal >= toDeleteMark) {
+		//garbage collector
+
+		txRelease(txProceed);
+		deleteObject(node, txProceed, LC_TX);
+		return;
+	} else if (txProceed->Flags.TCP && elapsed > LEVCAN_COMM_TIMEOUT) {
+		//TCP mode, UDP data and rest of the window are sent by scheduler
+		if (txProceed->Attempt >= 3) {
+			//TX timeout, make it free!
+			lc_trace(node, LC_TraceTXAttempts, txProceed->Header.MsgID, txProceed->Header.Source, txProceed->Header.Target, txProceed->Position);
+			node->TxRxObjects.Statistics.TXTimeouts++;
+			countMessage(node, txProceed->Header.MsgID, statErrors);
+			txRelease(txProceed);
+			deleteObject(node, txProceed, LC_TX);
+			return;
 		} else {
-			//TCP mode
-			if (txProceed->Time_since_comm > LEVCAN_COMM_TIMEOUT) {
-				if (txProceed->Attempt >= 3) {
-					//TX timeout, make it free!
-#ifdef LEVCAN_TRACE
-					trace_printf("TX object deleted by attempt:%d\n", txProceed->Header.MsgID);
-#endif
+			// Try tx again
+			node->TxRxObjects.Statistics.Retransmits++;
+			lc_trace(node, LC_TraceTXRetransmit, txProceed->Header.MsgID, txProceed->Header.Source, txProceed->Header.Target, txProceed->Position);
+			objectTXproceed(node, txProceed, 0, LC_Timeout);
+			//may cause buffer overflow if CAN is offline
+			txProceed->Attempt++;
+		}
+	}
+	objectTimer(node, txProceed, LC_TX);
+}
+
+void rxTimeout(void *context, lc_timer_t *timer) {
+	LC_NodeDescriptor_t *node = context;
+	lc_objBuffered *rxProceed = timer->Owner;
+
+	if (((int32_t) (node->Timers.Now - rxProceed->LastComm) > LEVCAN_MESSAGE_TIMEOUT) || (rxProceed->FlagsTotal >= toDeleteMark)) {
+		rxProceed->Flags.ToDelete = 1; //critical
+		//UDP mode rx timeout or garbage collector
+		if (!(rxProceed->FlagsTotal >= toDeleteMark)) {
+			lc_trace(node, LC_TraceRXTimeout, rxProceed->Header.MsgID, rxProceed->Header.Source, rxProceed->Header.Target, rxProceed->Position);
+			node->TxRxObjects.Statistics.RXTimeouts++;
+			countMessage(node, rxProceed->Header.MsgID, statErrors);
+		}
 #ifndef LEVCAN_MEM_STATIC
-					if (txProceed->Flags.TXcleanup) {
-						lcfree(txProceed->Pointer);
-					}
+		lc_slabFree(rxProceed->Pointer);
 #endif
-					deleteObject(node, txProceed, (lc_objBuffered**) &node->TxRxObjects.objTXbuf_start, (lc_objBuffered**) &node->TxRxObjects.objTXbuf_end);
-				} else {
-					// Try tx again
-					objectTXproceed(node, txProceed, 0, LC_Timeout);
-					//may cause buffer overflow if CAN is offline
-					//if (txProceed->Time_since_comm == 0)
-					txProceed->Attempt++;
-				}
+		rxProceed->Pointer = 0;
+		deleteObject(node, rxProceed, LC_RX);
+		return;
+	}
+	objectTimer(node, rxProceed, LC_RX);
+}
+
+/// Arms object timer: next tick if object has to be deleted, otherwise at its communication timeout.
+/// TX object with frames to send is queued to scheduler.
+/// Timer is not moved when communication continues, expired callback checks LastComm and arms it again.
+void objectTimer(LC_NodeDescriptor_t *node, lc_objBuffered *object, uint8_t direction) {
+	uint32_t timeout = LEVCAN_MESSAGE_TIMEOUT;
+	uint8_t pending = (object->FlagsTotal >= toDeleteMark);
+	uint8_t queued = 0;
+
+	if (direction == LC_TX) {
+		if (object->Flags.TCP == 0)
+			pending = 1;    //UDP sends till the end
+		else {
+			timeout = LEVCAN_COMM_TIMEOUT;
+			if (object->Window.Size) {
+				//announce or rest of the window wasn't sent, buffer was full
+				if (object->Window.Granted == 0)
+					pending |= (object->Header.RTS_CTS == 0);
+				else
+					pending |= (object->Window.Count < object->Window.Size) && !(object->Window.Count && object->Header.EoM);
 			}
 		}
-		txProceed = next;
-	}
-	//count work time and recall
-	lc_objBuffered *rxProceed = (lc_objBuffered*) node->TxRxObjects.objRXbuf_start;
-	while (rxProceed) {
-		lc_objBuffered *next = (lc_objBuffered*) rxProceed->Next;
-		rxProceed->Time_since_comm += time;
-		if ((rxProceed->Time_since_comm > LEVCAN_MESSAGE_TIMEOUT) || (rxProceed->FlagsTotal >= toDeleteMark)) {
-			rxProceed->Flags.ToDelete = 1; //critical
-			//UDP mode rx timeout or garbage collector
-#ifdef LEVCAN_TRACE
-			if (!(rxProceed->FlagsTotal >= toDeleteMark)) {
-				trace_printf("RX object deleted by timeout:%d\n", rxProceed->Header.MsgID);
+		if (pending && object->FlagsTotal < toDeleteMark) {
+			//frames to send, timer only watches communication timeout
+			lc_disable_irq();
+			queued = readyPush(node, object);
+			lc_enable_irq();
+			pending = 0;
+		}
+	}
+	if (pending)
+		lc_timerStart(&node->Timers, &object->Timer, 1);
+	else if (object->Timer.Link == 0)
+		lc_timerStartAt(&node->Timers, &object->Timer, object->LastComm + timeout + 1);
+	else if (queued == 0)
+		return;    //earlier deadline already set
+	LC_NetworkManagerWakeup(node);
+}
+
+void insertObject(LC_NodeDescriptor_t *node, lc_objBuffered *obj, uint8_t direction) {
+	volatile void **start, **end, **bucket;
+	if (direction == LC_TX) {
+		start = &node->TxRxObjects.objTXbuf_start;
+		end = &node->TxRxObjects.objTXbuf_end;
+		bucket = &node->TxRxObjects.objTXhash[hashObject(obj->Header.MsgID, obj->Header.Target, obj->Header.Source)];
+	} else {
+		start = &node->TxRxObjects.objRXbuf_start;
+		end = &node->TxRxObjects.objRXbuf_end;
+		bucket = &node->TxRxObjects.objRXhash[hashObject(obj->Header.MsgID, obj->Header.Target, obj->Header.Source)];
+	}
+	//should be called in critical section, add to end
+	obj->Next = 0;
+	if ((*start) == 0) {
+		//no objects in array
+		obj->Previous = 0;
+		(*start) = obj;
+		(*end) = obj;
+	} else {
+		//add to the end
+		obj->Previous = (intptr_t*) (*end);
+		((lc_objBuffered*) (*end))->Next = (intptr_t*) obj;
+		(*end) = obj;
+	}
+	//hash chain head
+	obj->HashPrevious = 0;
+	obj->HashNext = (intptr_t*) (*bucket);
+	if ((*bucket) != 0)
+		((lc_objBuffered*) (*bucket))->HashPrevious = (intptr_t*) obj;
+	(*bucket) = obj;
+}
+
+/// Sends frames of queued TX objects, deficit round robin over priority queues.
+/// Every round each priority sends up to its LEVCAN_TX_QUANTUM frames, highest bus priority first,
+/// objects of the same priority take turns. Stops when TX buffer is half full, so bulk transfers
+/// can't delay higher priority frames for more than one round.
+/// Called only by LC_NetworkManager: popped object is sent outside of critical section and
+/// transfer timers, which release TX data, run in the same thread.
+void txSchedule(LC_NodeDescriptor_t *node) {
+	uint16_t sent;
+	do {
+		sent = 0;
+		for (int prio = LC_Priority_High; prio >= LC_Priority_Low; prio--) {
+			int16_t quantum = lc_txQuantum[prio];
+			while (quantum > 0 && node->TxRxObjects.txReady_start[prio]) {
+				if (((LC_DriverCalls_t*) node->Driver)->TxHalfFull() == LC_BufferFull)
+					return;
+				lc_disable_irq();
+				lc_objBuffered *object = readyPop(node, prio);
+				lc_enable_irq();
+				if (object == 0)
+					break;
+				if (object->FlagsTotal >= toDeleteMark)
+					continue;    //finished meanwhile, garbage collector will delete it
+				uint8_t credits = (quantum > UINT8_MAX) ? UINT8_MAX : quantum;
+				object->Credits = credits;
+				uint16_t status = objectTXproceed(node, object, 0, LC_Ok);
+				credits -= object->Credits;
+				object->Credits = 0;
+				quantum -= credits;
+				sent += credits;
+				//back to the end of queue if there is more to send
+				objectTimer(node, object, LC_TX);
+				if (status == LC_BufferFull)
+					return;
+				if (credits == 0)
+					break;
 			}
-#endif
-#ifndef LEVCAN_MEM_STATIC
-			lcfree(rxProceed->Pointer);
-#endif
-			rxProceed->Pointer = 0;
-			deleteObject(node, rxProceed, (lc_objBuffered**) &node->TxRxObjects.objRXbuf_start, (lc_objBuffered**) &node->TxRxObjects.objRXbuf_end);
 		}
-		rxProceed = next;
+	} while (sent);
+}
+
+/// Adds TX object to the end of its priority queue, should be called in critical section
+/// @return 1 if object was added, 0 if it is queued already
+uint8_t readyPush(LC_NodeDescriptor_t *node, lc_objBuffered *obj) {
+	if (obj->Ready)
+		return 0;
+	uint8_t prio = (uint8_t) ~obj->Header.Priority & 3;
+	obj->ReadyNext = 0;
+	if (node->TxRxObjects.txReady_start[prio] == 0)
+		node->TxRxObjects.txReady_start[prio] = obj;
+	else
+		((lc_objBuffered*) node->TxRxObjects.txReady_end[prio])->ReadyNext = (intptr_t*) obj;
+	node->TxRxObjects.txReady_end[prio] = obj;
+	obj->Ready = 1;
+	return 1;
+}
+
+/// Takes first TX object of priority queue, should be called in critical section
+lc_objBuffered* readyPop(LC_NodeDescriptor_t *node, uint8_t priority) {
+	lc_objBuffered *obj = (lc_objBuffered*) node->TxRxObjects.txReady_start[priority];
+	if (obj) {
+		node->TxRxObjects.txReady_start[priority] = obj->ReadyNext;
+		if (obj->ReadyNext == 0)
+			node->TxRxObjects.txReady_end[priority] = 0;
+		obj->Ready = 0;
 	}
+	return obj;
+}
 
+/// Unlinks TX object from its priority queue, should be called in critical section
+void readyRemove(LC_NodeDescriptor_t *node, lc_objBuffered *obj) {
+	if (obj->Ready == 0)
+		return;
+	uint8_t prio = (uint8_t) ~obj->Header.Priority & 3;
+	lc_objBuffered *prev = 0;
+	lc_objBuffered *cur = (lc_objBuffered*) node->TxRxObjects.txReady_start[prio];
+	while (cur && cur != obj) {
+		prev = cur;
+		cur = (lc_objBuffered*) cur->ReadyNext;
+	}
+	if (cur == 0)
+		return;
+	if (prev)
+		prev->ReadyNext = obj->ReadyNext;
+	else
+		node->TxRxObjects.txReady_start[prio] = obj->ReadyNext;
+	if (node->TxRxObjects.txReady_end[prio] == obj)
+		node->TxRxObjects.txReady_end[prio] = prev;
+	obj->Ready = 0;
 }
 
-void deleteObject(LC_NodeDescriptor_t *node, lc_objBuffered *obj, lc_objBuffered **start, lc_objBuffered **end) {
+void deleteObject(LC_NodeDescriptor_t *node, lc_objBuffered *obj, uint8_t direction) {
+	volatile void **start, **end, **bucket;
+	if (direction == LC_TX) {
+		start = &node->TxRxObjects.objTXbuf_start;
+		end = &node->TxRxObjects.objTXbuf_end;
+		bucket = &node->TxRxObjects.objTXhash[hashObject(obj->Header.MsgID, obj->Header.Target, obj->Header.Source)];
+	} else {
+		start = &node->TxRxObjects.objRXbuf_start;
+		end = &node->TxRxObjects.objRXbuf_end;
+		bucket = &node->TxRxObjects.objRXhash[hashObject(obj->Header.MsgID, obj->Header.Target, obj->Header.Source)];
+	}
+	//timer has its own critical section
+	lc_timerStop(&node->Timers, &obj->Timer);
 
 	lc_disable_irq();
 	//critical area
+	if (direction == LC_TX)
+		readyRemove(node, obj);
 	if (obj->Previous)
 		((lc_objBuffered*) obj->Previous)->Next = obj->Next;    //junction
 	else {
-#ifdef LEVCAN_TRACE
-		if ((*start) != obj) {
-			trace_printf("Start object error\n");
-		}
-#endif
+		if ((*start) != obj)
+			lc_trace(node, LC_TraceListError, obj->Header.MsgID, obj->Header.Source, obj->Header.Target, 0);
 		(*start) = (lc_objBuffered*) obj->Next;    //Starting
 		if ((*start) != 0)
-			(*start)->Previous = 0;
+			((lc_objBuffered*) (*start))->Previous = 0;
 	}
 	if (obj->Next) {
 		((lc_objBuffered*) obj->Next)->Previous = obj->Previous;
 	} else {
-#ifdef LEVCAN_TRACE
-		if ((*end) != obj) {
-			trace_printf("End object error\n");
-		}
-#endif
+		if ((*end) != obj)
+			lc_trace(node, LC_TraceListError, obj->Header.MsgID, obj->Header.Source, obj->Header.Target, 1);
 		(*end) = (lc_objBuffered*) obj->Previous;    //ending
 		if ((*end) != 0)
-			(*end)->Next = 0;
+			((lc_objBuffered*) (*end))->Next = 0;
 	}
+	//hash chain
+	if (obj->HashPrevious)
+		((lc_objBuffered*) obj->HashPrevious)->HashNext = obj->HashNext;
+	else
+		(*bucket) = (lc_objBuffered*) obj->HashNext;
+	if (obj->HashNext)
+		((lc_objBuffered*) obj->HashNext)->HashPrevious = obj->HashPrevious;
 	lc_enable_irq();
 	//free this object
 #ifdef LEVCAN_MEM_STATIC
 	releaseObject(node, obj);
 #else
 	(void) node;
-	lcfree(obj);
+	lc_slabFree(obj);
 #endif
 }
 #ifdef LEVCAN_MEM_STATIC
 lc_objBuffered* getFreeObject(LC_NodeDescriptor_t *node) {
-	lc_objBuffered *ret = 0;
-	//last free index
+	//take first from free list
 	lc_disable_irq();
-	int freeid = node->TxRxObjects.objectBuffer_freeID;
-	if (freeid >= 0 && freeid < LEVCAN_OBJECT_SIZE) {
-		//search free
-		for (int i = freeid; i < LEVCAN_OBJECT_SIZE; i++) {
-			if (node->TxRxObjects.objectBuffer[i].Position == -1 && node->TxRxObjects.objectBuffer[i].Next == 0 && node->TxRxObjects.objectBuffer[i].Previous == 0) {
-				node->TxRxObjects.objectBuffer[i].Position = 0;
-				ret = &node->TxRxObjects.objectBuffer[i];
-				freeid = i + 1;    //next is possible free
-				break;
-			}
-		}
+	lc_objBuffered *ret = node->TxRxObjects.objectFree;
+	if (ret) {
+		node->TxRxObjects.objectFree = (lc_objBuffered*) ret->Next;
+		ret->Next = 0;
+		ret->Position = 0;
 	}
-	node->TxRxObjects.objectBuffer_freeID = freeid;
 	lc_enable_irq();
 
 	return ret;
@@ -411,19 +1009,14 @@ lc_objBuffered* getFreeObject(LC_NodeDescriptor_t *node) {
 void releaseObject(LC_NodeDescriptor_t *node, lc_objBuffered *obj) {
 	lc_disable_irq();
 	int index = (obj - node->TxRxObjects.objectBuffer);
-	if (index >= 0 && index < LEVCAN_OBJECT_SIZE) {
-		//mark as free
-		node->TxRxObjects.objectBuffer[index].Position = -1;
-		node->TxRxObjects.objectBuffer[index].Next = 0;
-		node->TxRxObjects.objectBuffer[index].Previous = 0;
-		//save first free buffer in fast index
-		if (index < node->TxRxObjects.objectBuffer_freeID)
-			node->TxRxObjects.objectBuffer_freeID = index;
-	} else {
-#ifdef LEVCAN_TRACE
-		trace_printf("Delete object error\n");
-#endif
-	}
+	if (index >= 0 && index < LEVCAN_OBJECT_SIZE && obj->Position != -1) {
+		//mark as free and put in front of free list
+		obj->Position = -1;
+		obj->Previous = 0;
+		obj->Next = (intptr_t*) node->TxRxObjects.objectFree;
+		node->TxRxObjects.objectFree = obj;
+	} else
+		lc_trace(node, LC_TraceListError, obj->Header.MsgID, obj->Header.Source, obj->Header.Target, 2);
 	lc_enable_irq();
 }
 #endif
@@ -452,252 +1045,605 @@ LC_Header_t LC_HeaderUnpack(LC_HeaderPacked_t header) {
 	return hdr;
 }
 
-uint16_t objectTXproceed(LC_NodeDescriptor_t *node, lc_objBuffered *object, LC_HeaderPacked_t *request, int timeout) {
+uint16_t objectTXproceed(LC_NodeDescriptor_t *node, lc_objBuffered *object, lc_msgBuffered *request, int timeout) {
 	int32_t length;
-	uint32_t data[2];
-	uint32_t step_inc = 8;
 
 	if (object == 0 || node == 0)
 		return LC_ObjectError;
+	int32_t step_inc = object->FrameSize;
+
+	if (object->Flags.TCP == 1 && request && request->header.EoM) {
+		//TX finished? delete this buffer anyway
+		if (request->header.RTS_CTS)
+			lc_trace(node, LC_TraceTXRejected, object->Header.MsgID, object->Header.Source, object->Header.Target, object->Position);
+		else if (object->Length >= 0 && object->Position != object->Length)
+			lc_trace(node, LC_TraceTXLength, object->Header.MsgID, object->Header.Source, object->Header.Target, object->Position);
+		else
+			lc_trace(node, LC_TraceTXDone, object->Header.MsgID, object->Header.Source, object->Header.Target, object->Position);
+		//cleanup tx buffer also
+		txRelease(object);
+		//delete object from memory chain, find new endings
+		object->FlagsTotal = toDeleteMark;
+		return 0;
+	}
+	if (object->Window.Size)
+		return windowTXproceed(node, object, request, timeout);
 
 	uint8_t parity = ~((object->Position + step_inc - 1) / step_inc) & 1;    //parity
 	//requests and timeout only TCP
 	if (object->Flags.TCP == 1 && (request || timeout)) {
-		if (request && request->EoM) {
-			//TX finished? delete this buffer anyway
-#ifdef LEVCAN_TRACE
-			//trace_printf("TX TCP finished:%d\n", object->Header.MsgID);
-			if (object->Position != object->Length)
-				trace_printf("TX TCP length mismatch:%d, it is:%d, it should:%d\n", object->Header.MsgID, object->Position, object->Length);
-#endif
-#ifndef LEVCAN_MEM_STATIC
-			//cleanup tx buffer also
-			if (object->Flags.TXcleanup)
-				lcfree(object->Pointer);
-#endif
-			//delete object from memory chain, find new endings
-			object->Pointer = 0;
-			object->FlagsTotal = toDeleteMark;
-			return 0;
-		}
-		if (timeout || (request && (parity != request->Parity))) {
-			// trace_printf("Request got invalid parity -\n");
-			if (object->Time_since_comm == 0)
+		if (timeout || (request && (parity != request->header.Parity))) {
+			if (object->LastComm == lc_now(node))
 				return 0;    //avoid request spamming
 
 			//requested previous data pack, latest was lost
-			int reminder = object->Position % (8);
-			reminder = (reminder == 0) ? (8) : reminder;
+			if (timeout == 0)
+				node->TxRxObjects.Statistics.ParityRollbacks++;
+			int reminder = object->Position % step_inc;
+			reminder = (reminder == 0) ? step_inc : reminder;
 			//roll back position
 			object->Position -= reminder;
 			if (object->Position < 0)
 				object->Position = 0;    //just in case... WTF
-			parity = ~((object->Position + 7) / (8)) & 1;    //parity
-#ifdef LEVCAN_TRACE
-			// trace_printf("TX object parity lost:%d position:%d\n", object->Header.MsgID, object->Position);
-#endif
-		} else {
-#ifdef LEVCAN_TRACE
-			// trace_printf("Request got valid parity\n");
-#endif
+			parity = ~((object->Position + step_inc - 1) / step_inc) & 1;    //parity
+			lc_trace(node, timeout ? LC_TraceTXRetransmit : LC_TraceTXRollback, object->Header.MsgID, object->Header.Source, object->Header.Target, object->Position);
 		}
 	}
+	if (object->Window.Announce && object->Position == 0 && object->Header.RTS_CTS == 0) {
+		//UDP length announce, data frames follow without RTS
+		if (sendAnnounce(node, object, 0))
+			return LC_BufferFull;
+		if (object->Credits)
+			object->Credits--;
+	}
 	do {
+		//prepare burst without touching object, driver may take only part of it
+		lc_msgBuffered batch[LEVCAN_TX_BATCH];
+		uint16_t count = 0;
+		int32_t position = object->Position;
 		LC_HeaderPacked_t newhdr = object->Header;
-		length = 0;
-		if (object->Length >= 0) {
-			length = object->Length - object->Position;
-			if (length > (8))
-				length = 8;
-			//set data end
-			if (object->Length == object->Position + length)
-				newhdr.EoM = 1;
-			else
-				newhdr.EoM = 0;
-		} else {
-			length = strnlen((char*) &object->Pointer[object->Position], (8));
-			if (length < (8)) {
-				length++;    //ending zero byte
-				newhdr.EoM = 1;
+		do {
+			length = 0;
+			if (object->Length >= 0) {
+				length = object->Length - position;
+				if (length > step_inc)
+					length = step_inc;
+				//set data end
+				if (object->Length == position + length)
+					newhdr.EoM = 1;
+				else
+					newhdr.EoM = 0;
+			} else {
+				length = strnlen((char*) &object->Pointer[position], step_inc);
+				if (length < step_inc) {
+					length++;    //ending zero byte
+					newhdr.EoM = 1;
+				} else
+					newhdr.EoM = 0;
+			}
+			//Extract new portion of data in obj. null length cant be
+			txCopy(object, position, batch[count].data, length);
+			if (position == 0 && object->Window.Announce == 0) {
+				//Request new buffer anyway. maybe there was wrong request while data wasn't sent at all?
+				newhdr.RTS_CTS = 1;
 			} else
-				newhdr.EoM = 0;
-		}
-		//if (length <= 0)
-		//	asm volatile ("bkpt");
-		//Extract new portion of data in obj. null length cant be
-		memcpy(data, &object->Pointer[object->Position], length);
-		if (object->Position == 0) {
-			//Request new buffer anyway. maybe there was wrong request while data wasn't sent at all?
-			newhdr.RTS_CTS = 1;
-		} else
-			newhdr.RTS_CTS = 0;
-
-		newhdr.Parity = object->Flags.TCP ? parity : 0;    //parity
-
-		object->Header = newhdr;    //update to new only here
-		object->Position += length;
+				newhdr.RTS_CTS = 0;
+
+			newhdr.Parity = object->Flags.TCP ? parity : 0;    //parity
+			batch[count].header = newhdr;
+			batch[count].length = length;
+			position += length;
+			count++;
+			//UDP burst till message end or scheduler credits end
+		} while ((object->Flags.TCP == 0) && (count < LEVCAN_TX_BATCH) && (count < object->Credits) && (newhdr.EoM == 0));
 		//try to send
-		if (((LC_DriverCalls_t*) node->Driver)->Send(newhdr, data, length)) {
-			//UDP have no timeout recover, make a roll back and rescue some bytes
-			if (object->Flags.TCP == 0)
-				object->Position -= length;
-			return LC_BufferFull;
+		uint16_t sent = sendFrames(node, batch, count);
+		//UDP have no timeout recover, only sent frames move position. TCP frame is recovered by timeout
+		uint16_t done = (object->Flags.TCP) ? count : sent;
+		for (uint16_t i = 0; i < done; i++) {
+			object->Header = batch[i].header;    //update to new only here
+			object->Position += frameLength(&batch[i]);
+		}
+		if (sent) {
+			object->LastComm = lc_now(node);    //data sent ok
+			object->Credits = (object->Credits > sent) ? object->Credits - sent : 0;
 		}
-		object->Time_since_comm = 0;    //data sent ok
-		//cycle if this is UDP till message end or buffer 3/4 fill
-	} while ((object->Flags.TCP == 0) && (((LC_DriverCalls_t*) node->Driver)->TxHalfFull() != LC_BufferFull) && (object->Header.EoM == 0));
+		if (sent < count)
+			return LC_BufferFull;
+		//cycle if this is UDP till message end, scheduler credits end or buffer 3/4 fill
+	} while ((object->Flags.TCP == 0) && object->Credits && (((LC_DriverCalls_t*) node->Driver)->TxHalfFull() != LC_BufferFull) && (object->Header.EoM == 0));
 	//in UDP mode delete object when EoM is set
 	//TCP deleted when RTR acknowledgment EoM received
 	if ((object->Flags.TCP == 0) && (object->Header.EoM == 1)) {
-#ifndef LEVCAN_MEM_STATIC
-		if (object->Flags.TXcleanup) {
-			lcfree(object->Pointer);
-		}
-#endif
-		object->Pointer = 0;
+		lc_trace(node, LC_TraceTXDone, object->Header.MsgID, object->Header.Source, object->Header.Target, object->Position);
+		txRelease(object);
 		object->Flags.ToDelete = 1;
 	}
 	return LC_Ok;
 }
 
+uint16_t windowTXproceed(LC_NodeDescriptor_t *node, lc_objBuffered *object, lc_msgBuffered *request, int timeout) {
+	if (object->Window.Granted == 0) {
+		if (request && request->header.RTS_CTS && request->header.Parity == 0) {
+			//receiver accepted announce, window parity starts from 1
+			if (request->length < object->Window.Size)
+				object->Window.Size = (request->length) ? request->length : 1;
+			object->Window.Granted = 1;
+			object->Window.Parity = 1;
+			object->Window.Frame = 0;
+			object->Window.Count = 0;
+			object->Attempt = 0;
+		} else {
+			if (request || (timeout == 0 && object->Header.RTS_CTS))
+				return 0;    //wait for grant
+			//announce windowed transfer
+			if (sendAnnounce(node, object, object->Window.Size))
+				return LC_BufferFull;
+			if (object->Credits)
+				object->Credits--;
+			return LC_Ok;
+		}
+	} else if (request) {
+		if (request->header.Parity != object->Window.Parity)
+			return 0;    //old acknowledge
+		//cumulative acknowledge, continue after last received frame
+		uint8_t acked = request->length;
+		if (acked > object->Window.Count)
+			acked = object->Window.Count;
+		if (acked < object->Window.Count) {
+			node->TxRxObjects.Statistics.Retransmits++;
+			lc_trace(node, LC_TraceTXRetransmit, object->Header.MsgID, object->Header.Source, object->Header.Target, (object->Window.Frame + acked) * windowPayload(object));
+		}
+		object->Window.Frame += acked;
+		object->Window.Count = 0;
+		object->Window.Parity ^= 1;
+		object->Attempt = 0;
+		object->Position = object->Window.Frame * windowPayload(object);
+	} else if (timeout) {
+		//acknowledge lost, repeat whole window
+		object->Window.Count = 0;
+		object->Position = object->Window.Frame * windowPayload(object);
+	}
+
+	//window frames are sent only by scheduler
+	while (object->Window.Count < object->Window.Size && object->Credits) {
+		if (object->Window.Count && object->Header.EoM)
+			break;    //last frame already sent
+		//prepare burst without touching object, driver may take only part of it
+		lc_msgBuffered batch[LEVCAN_TX_BATCH];
+		uint16_t count = 0;
+		int32_t position = object->Position;
+		LC_HeaderPacked_t newhdr = object->Header;
+		do {
+			int32_t length;
+			if (object->Length >= 0) {
+				length = object->Length - position;
+				if (length > windowPayload(object))
+					length = windowPayload(object);
+				newhdr.EoM = (object->Length == position + length);
+			} else {
+				length = strnlen((char*) &object->Pointer[position], windowPayload(object));
+				if (length < windowPayload(object)) {
+					length++;    //ending zero byte
+					newhdr.EoM = 1;
+				} else
+					newhdr.EoM = 0;
+			}
+			uint8_t *data = (uint8_t*) batch[count].data;
+			//first byte is frame sequence
+			data[0] = object->Window.Frame + object->Window.Count + count;
+			txCopy(object, position, &data[1], length);
+			newhdr.RTS_CTS = 0;
+			newhdr.Parity = object->Window.Parity;
+			batch[count].header = newhdr;
+			batch[count].length = length + 1;
+			position += length;
+			count++;
+		} while ((count < LEVCAN_TX_BATCH) && (count < object->Credits) && (object->Window.Count + count < object->Window.Size) && (newhdr.EoM == 0));
+		uint16_t sent = sendFrames(node, batch, count);
+		for (uint16_t i = 0; i < sent; i++) {
+			object->Header = batch[i].header;
+			object->Position += frameLength(&batch[i]) - 1;
+		}
+		object->Window.Count += sent;
+		object->Credits -= sent;
+		if (sent)
+			object->LastComm = lc_now(node);
+		if (sent < count)
+			return LC_BufferFull;    //rest will be sent by network manager
+	}
+	return LC_Ok;
+}
+
 uint16_t objectRXproceed(LC_NodeDescriptor_t *node, lc_objBuffered *object, lc_msgBuffered *msg) {
 	if (object == 0 || node == 0)
 		return LC_ObjectError;
 
 	if ((msg != 0) && (msg->header.RTS_CTS && object->Position != 0))
 		return LC_DataError; //position 0 can be started only with RTS (RTS will create new transfer object)
-	uint32_t step_inc = (8);
+	if (msg && isAnnounce(msg)) {
+		//TCP announce starts windowed transfer, UDP one only allocates buffer
+		if (msg->header.Parity)
+			return windowRXproceed(node, object, msg);
+		return LC_Ok;
+	}
+	if (object->Window.Size)
+		return windowRXproceed(node, object, msg);
+
+	uint32_t step_inc = object->FrameSize;
 	uint8_t parity = ~((object->Position + step_inc - 1) / step_inc) & 1;    //parity
-	int32_t position_new = object->Position;
 
 	//increment data if correct parity or if mode=0 (UDP)
 	if (msg && ((msg->header.Parity == parity) || (object->Flags.TCP == 0))) {
 		//new correct data
-		position_new += msg->length;
-		//check memory overload
-		if (object->Length < position_new) {
-#ifndef LEVCAN_MEM_STATIC
-			char *newmem = lcmalloc(object->Length * 2);
-			if (newmem) {
-				memcpy(newmem, object->Pointer, object->Length);
-				object->Length = object->Length * 2;
-			}
-			lcfree(object->Pointer);
-			object->Pointer = newmem;
-			//todo check possible pointer loose and close object
-#else
-			//out of stack, inform and delete
-#ifdef LEVCAN_TRACE
-			trace_printf("RX buffer overflow, object deleted:%d\n", object->Header.MsgID);
-#endif
-			object->Flags.ToDelete = 1;			//deleteObject(node, object, (objBuffered**)&objRXbuf_start, (objBuffered**)&objRXbuf_end);
+		if (objectRXstore(node, object, msg->data, msg->length))
 			return 0;
-#endif
-		}
-#ifndef LEVCAN_MEM_STATIC
-		if (object->Pointer) {
-			memcpy(&object->Pointer[object->Position], msg->data, msg->length);
-		}
-#else
-		memcpy(&object->Data[object->Position], msg->data, msg->length);
-#endif
-		object->Position = position_new;
 		parity = ~((object->Position + step_inc - 1) / step_inc) & 1;    //update parity
 		object->Header.EoM = msg->header.EoM;
 		//communication established
 		object->Attempt = 0;
-		object->Time_since_comm = 0;
+		object->LastComm = lc_now(node);
 	} /*else if (msg && (msg->header.Parity != parity))
 	 trace_printf("RX parity error:%d position:%d\n", object->Header.MsgID, object->Position);
 	 else if (msg == 0)
 	 trace_printf("Timeout ");*/
 	//pack new header responce
 	if (object->Flags.TCP) {
-		LC_HeaderPacked_t hdr = { 0 };
-		if (object->Header.EoM) {
-			hdr.EoM = 1;    //end of message
-			hdr.RTS_CTS = 0;
-		} else {
-			hdr.EoM = 0;
-			hdr.RTS_CTS = 1;    //clear to send
-		}
-		hdr.Priority = object->Header.Priority;
-		hdr.Source = object->Header.Target;    //we are target (receive)
-		hdr.Target = object->Header.Source;
-		hdr.Request = 1;
-		hdr.MsgID = object->Header.MsgID;
-		hdr.Parity = parity;
 		//finish? find right object in dictionary, copy data, close buffer
 		/*	if (object->Header.EoM)
 		 trace_printf("RX EOM sent:%d size:%d\n", object->Header.MsgID, object->Position);
 		 else
 		 trace_printf("RX request CTS sent:%d position:%d parity:%d\n", object->Header.MsgID, object->Position, hdr.Parity);
 		 */
-		((LC_DriverCalls_t*) node->Driver)->Send(hdr, 0, 0);
-	}
-	if (object->Header.EoM) {
-#ifndef LEVCAN_MEM_STATIC
-		objectRXfinish(node, object->Header, object->Pointer, object->Position, 1);
-#else
-		objectRXfinish(node, object->Header, object->Data, object->Position, 0);
-#endif
-		//pointer by this time should be cleared or stored in a queue
-		object->Pointer = 0;
-		//delete object from memory chain, find new endings
-		object->FlagsTotal = toDeleteMark;
-		//deleteObject(node, object, (objBuffered**) &objRXbuf_start, (objBuffered**) &objRXbuf_end);
+		sendCTS(node, object, parity, 0);
 	}
+	if (object->Header.EoM)
+		objectRXcomplete(node, object);
 
 	return LC_Ok;
 }
 
-LC_Return_t objectRXfinish(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header, char *data, int32_t size, uint8_t memfree) {
-	if (node == 0)
-		return LC_ObjectError;
+uint16_t windowRXproceed(LC_NodeDescriptor_t *node, lc_objBuffered *object, lc_msgBuffered *msg) {
+	if (msg == 0 || msg->length == 0)
+		return LC_DataError;
+	uint8_t *data = (uint8_t*) msg->data;
+
+	if (msg->header.RTS_CTS) {
+		//announce, grant window size
+		uint8_t size = data[0];
+		if (size > LEVCAN_TCP_WINDOW)
+			size = LEVCAN_TCP_WINDOW;
+		if (size == 0)
+			size = 1;
+		object->Window.Size = size;
+		object->Window.Frame = 0;
+		object->Window.Count = 0;
+		object->Window.Acked = 0;
+		sendCTS(node, object, 0, size);
+		object->Window.Parity = 1;
+		return LC_Ok;
+	}
+	if (msg->header.Parity != object->Window.Parity) {
+		//previous window repeated from the start, our CTS was lost
+		if (data[0] == (uint8_t) (object->Window.Frame - object->Window.Acked))
+			sendCTS(node, object, !object->Window.Parity, object->Window.Acked);
+		return LC_Ok;
+	}
+	if (data[0] == (uint8_t) object->Window.Frame) {
+		if (objectRXstore(node, object, &data[1], msg->length - 1))
+			return 0;
+		object->Window.Frame++;
+		object->Window.Count++;
+		object->Header.EoM = msg->header.EoM;
+		object->Attempt = 0;
+		object->LastComm = lc_now(node);
+		if (object->Header.EoM) {
+			sendCTS(node, object, object->Window.Parity, 0);
+			objectRXcomplete(node, object);
+			return LC_Ok;
+		}
+		if (object->Window.Count < object->Window.Size)
+			return LC_Ok;
+	}
+	//window received or frame lost: acknowledge received frames, sender repeats the rest
+	sendCTS(node, object, object->Window.Parity, object->Window.Count);
+	object->Window.Acked = object->Window.Count;
+	object->Window.Count = 0;
+	object->Window.Parity ^= 1;
+	return LC_Ok;
+}
 
-	LC_Return_t ret = LC_Ok;
-	//check check and check again
-	LC_ObjectRecord_t obj = findObjectRecord(node, header.MsgID, size, Write, header.Source);
-	if (obj.Address != 0 && (obj.Attributes.Writable) != 0) {
-		if (obj.Attributes.Function) {
-			//function call
-			((LC_FunctionCall_t) obj.Address)(node, LC_HeaderUnpack(header), data, size);
-		} else if (obj.Attributes.Pointer) {
+LC_Return_t objectRXstore(LC_NodeDescriptor_t *node, lc_objBuffered *object, const void *data, int32_t length) {
+	int32_t position_new = object->Position + length;
+	//check memory overload
+	if (object->Length < position_new) {
 #ifndef LEVCAN_MEM_STATIC
-			//store our memory pointer
-			//TODO: call new malloc for smaller size?
-			char *clean = *(char**) obj.Address;
-			*(char**) obj.Address = data;
-			//cleanup if there was pointer
-			if (clean)
-				lcfree(clean);
-			memfree = 0;
-#ifdef LEVCAN_USE_RTOS_QUEUE
-		} else if (obj.Attributes.Queue) {
-
-			if (memfree == 0 && data != 0) {
-				//that means it uses static memory.
-				char *allocated_mem = lcmalloc(size);
-				if (allocated_mem) {
-					memcpy(allocated_mem, data, size);
-					data = allocated_mem;
-				} else
-					return LC_MallocFail;
-
-			}
-			LC_ObjectData_t qdata;
-			qdata.Data = (intptr_t*) data; //user code should call mem free
-			qdata.Header = LC_HeaderUnpack(header);
-			qdata.Size = size;
-			//queue stores LC_ObjectData_t that includes pointer to data
-			if (LC_QueueSendToBack(obj.Address, &qdata, 0))
-				memfree = 0; //queued successfully
+		char *newmem = 0;
+		int32_t size = (object->Length > 0) ? object->Length : LEVCAN_OBJECT_DATASIZE;
+		while (size < position_new)
+			size *= 2;
+		if (size > LEVCAN_RX_MAXSIZE)
+			size = LEVCAN_RX_MAXSIZE;
+		if (size >= position_new)
+			newmem = lc_slabAlloc(size);
+		if (newmem) {
+			memcpy(newmem, object->Pointer, object->Position);
+			object->Length = size;
+		}
+		lc_slabFree(object->Pointer);
+		object->Pointer = newmem;
+		if (newmem == 0) {
 #endif
+			//out of memory, inform and delete
+			lc_trace(node, LC_TraceRXMemory, object->Header.MsgID, object->Header.Source, object->Header.Target, object->Position);
+			node->TxRxObjects.Statistics.MallocFail++;
+			countMessage(node, object->Header.MsgID, statErrors);
+			if (object->Flags.TCP)
+				sendReject(node, object->Header);
+			object->Flags.ToDelete = 1;
+			return LC_BufferFull;
+#ifndef LEVCAN_MEM_STATIC
+		}
 #endif
-		} else {
-			//just copy data as usual to specific location
-			int32_t sizeabs = abs(obj.Size);
-			//limit size to received size
+	}
+#ifndef LEVCAN_MEM_STATIC
+	memcpy(&object->Pointer[object->Position], data, length);
+#else
+	memcpy(&object->Data[object->Position], data, length);
+#endif
+	object->Position = position_new;
+	return LC_Ok;
+}
+
+void objectRXcomplete(LC_NodeDescriptor_t *node, lc_objBuffered *object) {
+	lc_trace(node, LC_TraceRXDone, object->Header.MsgID, object->Header.Source, object->Header.Target, object->Position);
+#ifndef LEVCAN_MEM_STATIC
+	objectRXfinish(node, object->Header, object->Pointer, object->Position, 1);
+#else
+	objectRXfinish(node, object->Header, object->Data, object->Position, 0);
+#endif
+	//pointer by this time should be cleared or stored in a queue
+	object->Pointer = 0;
+	//delete object from memory chain, find new endings
+	object->FlagsTotal = toDeleteMark;
+}
+
+void sendCTS(LC_NodeDescriptor_t *node, lc_objBuffered *object, uint8_t parity, uint8_t credits) {
+	LC_HeaderPacked_t hdr = { 0 };
+	if (object->Header.EoM) {
+		hdr.EoM = 1;    //end of message
+		hdr.RTS_CTS = 0;
+	} else {
+		hdr.EoM = 0;
+		hdr.RTS_CTS = 1;    //clear to send
+	}
+	hdr.Priority = object->Header.Priority;
+	hdr.Source = object->Header.Target;    //we are target (receive)
+	hdr.Target = object->Header.Source;
+	hdr.Request = 1;
+	hdr.MsgID = object->Header.MsgID;
+	hdr.Parity = parity;
+	//windowed mode: credits in data length
+	lc_sendFrame(node, hdr, 0, credits);
+}
+
+/// Hands frames to driver in one SendBatch call, or one by one if driver has no batch support.
+/// CAN FD frames are padded in place, use frameLength to get their data length back
+/// @return Number of frames taken by driver, the rest didn't fit in its buffer
+uint16_t sendFrames(LC_NodeDescriptor_t *node, lc_msgBuffered *frames, uint16_t count) {
+	const LC_DriverCalls_t *driver = node->Driver;
+#if LEVCAN_MAX_FRAME > 8
+	for (uint16_t i = 0; i < count; i++)
+		frames[i].length = framePad(frames[i].data, frames[i].length);
+#endif
+	uint16_t sent = 0;
+	if (driver->SendBatch)
+		sent = driver->SendBatch(frames, count);
+	else {
+		while (sent < count && driver->Send(frames[sent].header, (uint32_t*) frames[sent].data, frames[sent].length) == LC_Ok)
+			sent++;
+	}
+	//receive and network managers send frames from own tasks
+	for (uint16_t i = 0; i < sent; i++) {
+		lc_fetch_inc(&node->TxRxObjects.Statistics.FramesTX);
+		countMessage(node, frames[i].header.MsgID, statFramesTX);
+	}
+	if (sent < count)
+		lc_fetch_inc(&node->TxRxObjects.Statistics.TXBufferFull);
+	return sent;
+}
+
+/// Sends single frame with driver Send, counts it in statistics
+LC_Return_t lc_sendFrame(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header, uint32_t *data, uint8_t length) {
+	LC_Return_t result = ((LC_DriverCalls_t*) node->Driver)->Send(header, data, length);
+	if (result == LC_Ok) {
+		lc_fetch_inc(&node->TxRxObjects.Statistics.FramesTX);
+		countMessage(node, header.MsgID, statFramesTX);
+	} else if (result == LC_BufferFull)
+		lc_fetch_inc(&node->TxRxObjects.Statistics.TXBufferFull);
+	return result;
+}
+
+/// Increments counter of MsgID in node->MsgStatistics, if it is listed there. Called from CAN ISR too
+void countMessage(LC_NodeDescriptor_t *node, uint16_t msgID, uint8_t counter) {
+	for (int i = 0; i < node->MsgStatisticsSize; i++) {
+		LC_MsgStatistics_t *entry = &node->MsgStatistics[i];
+		if (entry->MsgID != msgID)
+			continue;
+		if (counter == statFramesRX)
+			lc_fetch_inc(&entry->FramesRX);
+		else if (counter == statFramesTX)
+			lc_fetch_inc(&entry->FramesTX);
+		else
+			lc_fetch_inc(&entry->Errors);
+		return;
+	}
+}
+
+/// Data bytes per frame for transfer to target. CAN FD is used only for node that supports it,
+/// broadcast stays classic
+/// @param node
+/// @param target Receiver node ID
+/// @return 8 or LEVCAN_MAX_FRAME - 1
+uint8_t linkPayload(LC_NodeDescriptor_t *node, uint16_t target) {
+#if LEVCAN_MAX_FRAME > 8
+	if (node->ShortName.CanFD && target < LC_Null_Address && LC_GetNode(node, target).CanFD)
+		return LEVCAN_MAX_FRAME - 1;
+#endif
+	return 8;
+}
+
+/// Pads CAN FD frame up to valid data length, last byte holds padding size. Classic frame stays as is
+/// @param data Frame buffer of LEVCAN_MAX_FRAME bytes
+/// @param length Data length, up to LEVCAN_MAX_FRAME - 1
+/// @return Length on bus
+uint8_t framePad(void *data, uint8_t length) {
+#if LEVCAN_MAX_FRAME > 8
+	static const uint8_t fdLength[] = { 12, 16, 20, 24, 32, 48, 64 };
+	if (length <= 8)
+		return length;
+	uint8_t wire = fdLength[sizeof(fdLength) - 1];
+	for (uint8_t i = 0; i < sizeof(fdLength); i++) {
+		if (fdLength[i] > length) {
+			wire = fdLength[i];
+			break;
+		}
+	}
+	uint8_t *bytes = data;
+	memset(&bytes[length], 0, wire - length);
+	bytes[wire - 1] = wire - 1 - length;
+	return wire;
+#else
+	return length;
+#endif
+}
+
+/// @param msg Frame padded by framePad
+/// @return Data length without padding
+uint8_t frameLength(const lc_msgBuffered *msg) {
+#if LEVCAN_MAX_FRAME > 8
+	if (msg->length > 8)
+		return msg->length - 1 - ((const uint8_t*) msg->data)[msg->length - 1];
+#endif
+	return msg->length;
+}
+
+LC_Return_t sendAnnounce(LC_NodeDescriptor_t *node, lc_objBuffered *object, uint8_t window) {
+	LC_HeaderPacked_t hdr = object->Header;
+	uint32_t data[2] = { 0 };
+	uint8_t *bytes = (uint8_t*) data;
+	//strings have unknown length
+	uint32_t size = (object->Length > 0) ? object->Length : 0;
+
+	bytes[0] = window;
+	for (int i = 0; i < 4; i++)
+		bytes[1 + i] = size >> (i * 8);
+	hdr.RTS_CTS = 1;
+	hdr.EoM = 0;
+	hdr.Parity = object->Flags.TCP;
+	if (lc_sendFrame(node, hdr, data, announceSize))
+		return LC_BufferFull;
+	object->Header = hdr;
+	object->LastComm = lc_now(node);
+	return LC_Ok;
+}
+
+void sendReject(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header) {
+	LC_HeaderPacked_t hdr = { 0 };
+	//EoM with CTS: transfer aborted
+	hdr.EoM = 1;
+	hdr.RTS_CTS = 1;
+	hdr.Priority = header.Priority;
+	hdr.Source = header.Target;
+	hdr.Target = header.Source;
+	hdr.Request = 1;
+	hdr.MsgID = header.MsgID;
+	hdr.Parity = header.Parity;
+	lc_sendFrame(node, hdr, 0, 0);
+}
+
+LC_Return_t objectRXfinish(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header, char *data, int32_t size, uint8_t memfree) {
+	if (node == 0)
+		return LC_ObjectError;
+
+	LC_Return_t ret = LC_Ok;
+	//response to LC_SendRequestAsync goes to its callback only
+	if (node->TxRxObjects.requests && requestComplete(node, header, data, size)) {
+#ifndef LEVCAN_MEM_STATIC
+		if (memfree && data != 0)
+			lc_slabFree(data);
+#endif
+		return ret;
+	}
+	const LC_Map_t *map = findMap(node, header.MsgID);
+	if (map) {
+		ret = mapUnpack(node, map, header, data, size);
+#ifndef LEVCAN_MEM_STATIC
+		if (memfree && data != 0)
+			lc_slabFree(data);
+#endif
+		return ret;
+	}
+	//check check and check again
+	LC_ObjectRecord_t obj = findObjectRecord(node, header.MsgID, size, Write, header.Source);
+	if (obj.Address != 0 && (obj.Attributes.Writable) != 0) {
+		if (obj.Attributes.Function) {
+			//function call
+			((LC_FunctionCall_t) obj.Address)(node, LC_HeaderUnpack(header), data, size);
+		} else if (obj.Attributes.Pointer) {
+#ifndef LEVCAN_MEM_STATIC
+			if (memfree && lc_slabOwns(data)) {
+				//user frees stored pointer with lcfree, move data out of pool
+				char *allocated_mem = lcmalloc(size);
+				if (allocated_mem)
+					memcpy(allocated_mem, data, size);
+				else {
+					node->TxRxObjects.Statistics.MallocFail++;
+					countMessage(node, header.MsgID, statErrors);
+				}
+				lc_slabFree(data);
+				data = allocated_mem;
+			}
+			//store our memory pointer
+			//TODO: call new malloc for smaller size?
+			char *clean = *(char**) obj.Address;
+			*(char**) obj.Address = data;
+			//cleanup if there was pointer
+			if (clean)
+				lcfree(clean);
+			memfree = 0;
+#ifdef LEVCAN_USE_RTOS_QUEUE
+		} else if (obj.Attributes.Queue) {
+
+			if ((memfree == 0 || lc_slabOwns(data)) && data != 0) {
+				//that means it uses static memory or pool block, user code frees with lcfree
+				char *allocated_mem = lcmalloc(size);
+				if (allocated_mem)
+					memcpy(allocated_mem, data, size);
+				if (memfree)
+					lc_slabFree(data);
+				if (allocated_mem == 0) {
+					node->TxRxObjects.Statistics.MallocFail++;
+					countMessage(node, header.MsgID, statErrors);
+					return LC_MallocFail;
+				}
+				data = allocated_mem;
+				memfree = 1;
+
+			}
+			LC_ObjectData_t qdata;
+			qdata.Data = (intptr_t*) data; //user code should call mem free
+			qdata.Header = LC_HeaderUnpack(header);
+			qdata.Size = size;
+			//queue stores LC_ObjectData_t that includes pointer to data
+			if (LC_QueueSendToBack(obj.Address, &qdata, 0))
+				memfree = 0; //queued successfully
+#endif
+#endif
+		} else {
+			//just copy data as usual to specific location
+			int32_t sizeabs = abs(obj.Size);
+			//limit size to received size
 			if (sizeabs > size)
 				sizeabs = size;
 
@@ -706,14 +1652,14 @@ LC_Return_t objectRXfinish(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header,
 		}
 	} else {
 		ret = LC_ObjectError;
-#ifdef LEVCAN_TRACE
-		trace_printf("RX finish failed %d no object found for size %d\n", header.MsgID, size);
-#endif
+		node->TxRxObjects.Statistics.RXNoObject++;
+		countMessage(node, header.MsgID, statErrors);
+		lc_trace(node, LC_TraceRXNoObject, header.MsgID, header.Source, header.Target, size);
 	}
 	//cleanup
 #ifndef LEVCAN_MEM_STATIC
 	if (memfree && data != 0) {
-		lcfree(data);
+		lc_slabFree(data);
 	}
 #endif
 	return ret;
@@ -721,15 +1667,42 @@ LC_Return_t objectRXfinish(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header,
 
 LC_ObjectRecord_t findObjectRecord(LC_NodeDescriptor_t *node, uint16_t messageID, int32_t size, uint8_t read_write, uint8_t nodeID) {
 	LC_ObjectRecord_t recBuffer = { 0 };
-	LC_ObjectRecord_t *record;
+	LC_ObjectRecord_t *record = 0;
 	if (node == 0)
 		return recBuffer;
+
+	//index may be swapped by LC_UpdateObjectIndex from other thread, pointer is read once
+	//and lookup keeps its table till indexRelease
+	lc_disable_irq();
+	lc_objIndex_t *index = node->ObjectIndex;
+	if (index)
+		index->Users++;
+	lc_enable_irq();
+	if (index) {
+		//indexed search, only objects with this MsgID in dictionary order
+		LC_ObjectRecord_t found = { 0 };
+		lc_objIndexSlot_t *slot = indexSlot(index, messageID);
+		if (slot && slot->MsgID == messageID) {
+			lc_objIndexRef_t *ref = &index->Refs[slot->Start];
+			for (int i = 0; i < slot->Count; i++, ref++) {
+				//record arrays are indexed per element
+				extractRecords(indexObject(node, index, ref->Object), &record, &recBuffer);
+				if (matchRecord(&record[ref->Record], size, read_write, nodeID)) {
+					found = record[ref->Record];
+					break;
+				}
+			}
+		}
+		indexRelease(index);
+		return found;
+	}
+
 	for (int source = 0; source < 2; source++) {
 		int32_t objsize;
 		LC_Object_t *objectArray;
 		//switch between system objects and external
 		if (source) {
-			objsize = node->ObjectsSize;
+			objsize = node->Objects ? node->ObjectsSize : 0;
 			objectArray = node->Objects;
 		} else {
 			objsize = node->SystemSize;
@@ -739,46 +1712,12 @@ LC_ObjectRecord_t findObjectRecord(LC_NodeDescriptor_t *node, uint16_t messageID
 		for (int i = 0; i < objsize; i++) {
 			//right index?
 			if (objectArray[i].MsgID == messageID) {
-				int recSize = 0;
 				//extract pointer, size and attributes
-				if (objectArray[i].Attributes.Record) {
-					if (objectArray[i].Size > 0 && objectArray[i].Address != 0) {
-						//get record pointer if its correct
-						record = ((LC_ObjectRecord_t*) objectArray[i].Address);
-						recBuffer.Address = record->Address;
-						recBuffer.Size = record->Size;
-						recBuffer.Attributes = record->Attributes;
-						recSize = objectArray[i].Size; //record array size
-					} else {
-						continue; //bad object, skip
-					}
-				} else {
-					//convert object to record type
-					recBuffer.Address = objectArray[i].Address;
-					recBuffer.Size = objectArray[i].Size;
-					recBuffer.Attributes = objectArray[i].Attributes;
-					recBuffer.NodeID = LC_Broadcast_Address;
-					record = &recBuffer;
-					recSize = 1; //1 element
-				}
+				int recSize = extractRecords(&objectArray[i], &record, &recBuffer);
 				//scroll through all LC_ObjectRecord_t[]
 				for (int irec = 0; irec < recSize; irec++) {
-					if (
-					//@formatter:off
-						//Group A
-						((size == record[irec].Size) || 							//precise size match (positive only)
-						((record[irec].Size < 0) && (-size >= record[irec].Size)) ||//variable size (up to -Size, where Size is negative) Note: INT_MIN == -INT_MIN, comparison will be broken
-							(read_write == Read && size == 0)) &&  						//read (request) any first object if request size is 0
-							//Group B
-							((record[irec].Attributes.Readable != read_write) || 		//read access (should be .Readable=1)
-						(record[irec].Attributes.Writable == read_write)) && 		//write access (should be .Writable=1)
-						//Group C
-								((record[irec].NodeID == LC_Broadcast_Address) || 			//any match == broadcast
-						(record[irec].NodeID == nodeID))) 							//specific node ID match
-																																																			//@formatter:on
-					{
+					if (matchRecord(&record[irec], size, read_write, nodeID)) {
 						return record[irec];    //yes
-
 					} else {
 						recBuffer.Address = 0;    //no
 					}
@@ -791,6 +1730,208 @@ LC_ObjectRecord_t findObjectRecord(LC_NodeDescriptor_t *node, uint16_t messageID
 	return recBuffer;
 }
 
+int32_t extractRecords(LC_Object_t *object, LC_ObjectRecord_t **records, LC_ObjectRecord_t *buffer) {
+	if (object->Attributes.Record) {
+		if (object->Size > 0 && object->Address != 0) {
+			//get record pointer if its correct
+			LC_ObjectRecord_t *record = ((LC_ObjectRecord_t*) object->Address);
+			buffer->Address = record->Address;
+			buffer->Size = record->Size;
+			buffer->Attributes = record->Attributes;
+			*records = record;
+			return object->Size; //record array size
+		}
+		return 0; //bad object, skip
+	}
+	//convert object to record type
+	buffer->Address = object->Address;
+	buffer->Size = object->Size;
+	buffer->Attributes = object->Attributes;
+	buffer->NodeID = LC_Broadcast_Address;
+	*records = buffer;
+	return 1; //1 element
+}
+
+uint8_t matchRecord(LC_ObjectRecord_t *record, int32_t size, uint8_t read_write, uint8_t nodeID) {
+	//@formatter:off
+	return	//Group A
+			((size == record->Size) || 							//precise size match (positive only)
+			((record->Size < 0) && (-size >= record->Size)) ||	//variable size (up to -Size, where Size is negative) Note: INT_MIN == -INT_MIN, comparison will be broken
+			(read_write == Read && size == 0)) &&  				//read (request) any first object if request size is 0
+			//Group B
+			((record->Attributes.Readable != read_write) || 	//read access (should be .Readable=1)
+			(record->Attributes.Writable == read_write)) && 	//write access (should be .Writable=1)
+			//Group C
+			((record->NodeID == LC_Broadcast_Address) || 		//any match == broadcast
+			(record->NodeID == nodeID)); 						//specific node ID match
+	//@formatter:on
+}
+
+LC_Object_t* indexObject(LC_NodeDescriptor_t *node, lc_objIndex_t *index, uint16_t position) {
+	if (position < index->SystemSize)
+		return &node->SystemObjects[position];
+	return &index->Objects[position - index->SystemSize];
+}
+
+lc_objIndexSlot_t* indexSlot(lc_objIndex_t *index, uint16_t messageID) {
+	lc_objIndexSlot_t *slots = index->Slots;
+	uint16_t mask = index->Mask;
+	uint16_t pos = messageID & mask;
+	//linear probing, returns matching or first empty slot
+	for (uint32_t i = 0; i <= mask; i++) {
+		if (slots[pos].MsgID == messageID || slots[pos].MsgID == indexEmpty)
+			return &slots[pos];
+		pos = (pos + 1) & mask;
+	}
+	return 0;
+}
+
+/// Builds MsgID dispatch index for findObjectRecord. Called by LC_CreateNode. Dictionary is not watched,
+/// call it again after changing Objects, ObjectsSize or MsgID, Size, attributes of any object.
+/// New index is built aside and published by pointer swap, lookups from other threads see either old or new one.
+/// Old index is freed when last lookup in it ends.
+/// @param node
+/// @return LC_Ok or error, without index dictionary will be searched linearly. LC_Collision - static index is
+/// still used by lookup from other thread, call again
+LC_Return_t LC_UpdateObjectIndex(LC_NodeDescriptor_t *node) {
+	if (node == 0)
+		return LC_ObjectError;
+	lc_objIndex_t *index = 0;
+#if defined(LEVCAN_MEM_STATIC) && LEVCAN_OBJECT_INDEX_SIZE > 0
+	//single static table, linear search while it is rebuilt
+	indexPublish(node, 0);
+	lc_disable_irq();
+	uint16_t users = node->ObjectIndexStatic.Users;
+	lc_enable_irq();
+	if (users)
+		return LC_Collision;
+#endif
+	LC_Return_t result = indexBuild(node, &index);
+	indexPublish(node, index);
+	return result;
+}
+
+/// Swaps published index, old one is freed now or by its last lookup
+/// @param node
+/// @param index New index, 0 - linear search
+void indexPublish(LC_NodeDescriptor_t *node, lc_objIndex_t *index) {
+	uint8_t release = 0;
+	lc_disable_irq();
+	lc_objIndex_t *old = node->ObjectIndex;
+	node->ObjectIndex = index;
+	if (old) {
+		old->Retired = 1;
+		release = (old->Users == 0);
+	}
+	lc_enable_irq();
+	if (release)
+		indexFree(old);
+}
+
+/// Ends lookup started by taking node->ObjectIndex, frees retired index after its last lookup
+/// @param index
+void indexRelease(lc_objIndex_t *index) {
+	lc_disable_irq();
+	uint8_t release = (--index->Users == 0 && index->Retired);
+	lc_enable_irq();
+	if (release)
+		indexFree(index);
+}
+
+void indexFree(lc_objIndex_t *index) {
+#ifndef LEVCAN_MEM_STATIC
+	//tables share block with header
+	lcfree(index);
+#else
+	(void) index;
+#endif
+}
+
+/// Builds index of current dictionary, not yet published
+/// @param node
+/// @param result Built index
+/// @return LC_Ok or error
+LC_Return_t indexBuild(LC_NodeDescriptor_t *node, lc_objIndex_t **result) {
+#if defined(LEVCAN_MEM_STATIC) && LEVCAN_OBJECT_INDEX_SIZE == 0
+	(void) node;
+	(void) result;
+	return LC_OutOfRange;
+#else
+	lc_objIndex_t build = { 0 };
+	build.Objects = node->Objects;
+	build.ObjectsSize = node->Objects ? node->ObjectsSize : 0;
+	build.SystemSize = node->SystemSize;
+	uint32_t total = build.SystemSize + build.ObjectsSize;
+	uint32_t refs = 0;
+	LC_ObjectRecord_t *record, buffer;
+	for (uint32_t i = 0; i < total; i++)
+		refs += extractRecords(indexObject(node, &build, i), &record, &buffer);
+	if (refs >= indexEmpty)
+		return LC_OutOfRange;
+	//power of two slots, twice more than records for short probing. MsgID is 10 bits, so 1024 slots is a direct table
+	uint32_t slots = 8;
+	while (slots < refs * 2 && slots < 1024)
+		slots <<= 1;
+#ifndef LEVCAN_MEM_STATIC
+	//header and both tables in one block
+	lc_objIndex_t *index = lcmalloc(sizeof(lc_objIndex_t) + slots * sizeof(lc_objIndexSlot_t) + (refs + 1) * sizeof(lc_objIndexRef_t));
+	if (index == 0)
+		return LC_MallocFail;
+	*index = build;
+	index->Slots = (lc_objIndexSlot_t*) (index + 1);
+	index->Refs = (lc_objIndexRef_t*) (index->Slots + slots);
+#elif LEVCAN_OBJECT_INDEX_SIZE > 0
+	if (refs > LEVCAN_OBJECT_INDEX_SIZE)
+		return LC_OutOfRange;
+	while (slots > LEVCAN_OBJECT_INDEX_SIZE * 2)
+		slots >>= 1;
+	lc_objIndex_t *index = &node->ObjectIndexStatic;
+	*index = build;
+	index->Slots = node->ObjectIndexSlotsStatic;
+	index->Refs = node->ObjectIndexRefsStatic;
+#endif
+	index->Mask = slots - 1;
+	for (uint32_t i = 0; i < slots; i++) {
+		index->Slots[i].MsgID = indexEmpty;
+		index->Slots[i].Count = 0;
+	}
+	//count records per MsgID
+	for (uint32_t i = 0; i < total; i++) {
+		LC_Object_t *object = indexObject(node, index, i);
+		int32_t count = extractRecords(object, &record, &buffer);
+		if (count == 0)
+			continue;
+		lc_objIndexSlot_t *slot = indexSlot(index, object->MsgID);
+		if (slot == 0) {
+			indexFree(index);
+			return LC_OutOfRange;
+		}
+		slot->MsgID = object->MsgID;
+		slot->Count += count;
+	}
+	//each MsgID gets continuous range of references
+	uint16_t start = 0;
+	for (uint32_t i = 0; i < slots; i++) {
+		index->Slots[i].Start = start;
+		start += index->Slots[i].Count;
+		index->Slots[i].Count = 0;
+	}
+	//fill references keeping dictionary order
+	for (uint32_t i = 0; i < total; i++) {
+		LC_Object_t *object = indexObject(node, index, i);
+		int32_t count = extractRecords(object, &record, &buffer);
+		lc_objIndexSlot_t *slot = indexSlot(index, object->MsgID);
+		for (int32_t irec = 0; irec < count; irec++) {
+			lc_objIndexRef_t *ref = &index->Refs[slot->Start + slot->Count++];
+			ref->Object = i;
+			ref->Record = irec;
+		}
+	}
+	*result = index;
+	return LC_Ok;
+#endif
+}
+
 /// Sends LC_ObjectRecord_t to network
 /// @param sender
 /// @param object
@@ -813,99 +1954,286 @@ LC_Return_t LC_SendMessage(LC_NodeDescriptor_t *node, LC_ObjectRecord_t *object,
 	//extract pointer
 	if (object->Attributes.Pointer)
 		dataAddr = *(char**) dataAddr;
+	uint8_t payload = linkPayload(node, object->NodeID);
 
 	if (object->Size < 0)
-		strl = strnlen(dataAddr, (8));
+		strl = strnlen(dataAddr, payload);
 	//negative size means this is string - any length
 
-	if ((object->Attributes.TCP) || (object->Size > (8)) || ((object->Size < 0) && (strl == (8)))) {
-		//avoid dual same id
-		lc_objBuffered *txProceed = findObject((lc_objBuffered*) node->TxRxObjects.objTXbuf_start, index, object->NodeID, node->ShortName.NodeID);
-		if (txProceed) {
-#ifdef DEBUG
-			lc_collision_cntr++;
-#endif
-			return LC_Collision;
-		}
-
-		if (object->NodeID == node->ShortName.NodeID)
-			return LC_Collision;
-		//form message header
-		LC_HeaderPacked_t hdr = { 0 };
-		hdr.MsgID = index;    //our node index
-		hdr.Priority = ~object->Attributes.Priority;
-		hdr.Request = 0;    //data sending...
-		hdr.Source = node->ShortName.NodeID;
-		hdr.Target = object->NodeID;
-		//create object sender instance
-#ifndef LEVCAN_MEM_STATIC
-		lc_objBuffered *newTXobj = (lc_objBuffered*) lcmalloc(sizeof(lc_objBuffered));
-#else
+	if ((object->Attributes.TCP) || (object->Size > payload) || ((object->Size < 0) && (strl == payload))) {
+#ifdef LEVCAN_MEM_STATIC
 		//no cleanup for static mem!
 		//todo make memcopy to data[] ?
 		if (object->Attributes.Cleanup == 1)
 			return LC_MallocFail;
-		lc_objBuffered *newTXobj = getFreeObject(node);
 #endif
+		LC_Return_t result;
+		lc_objBuffered *newTXobj = txCreate(node, object, index, payload, &result);
 		if (newTXobj == 0)
-			return LC_MallocFail;
-		newTXobj->Attempt = 0;
-		newTXobj->Header = hdr;
+			return result;
 		newTXobj->Length = object->Size;
 		newTXobj->Pointer = dataAddr;
-		newTXobj->Position = 0;
-		newTXobj->Time_since_comm = 0;
-		newTXobj->Next = 0;
-		newTXobj->FlagsTotal = 0;
-		newTXobj->Flags.TCP = object->Attributes.TCP;
-		newTXobj->Flags.TXcleanup = object->Attributes.Cleanup;
-		//process it first to avoid collision in multithread
-		lc_disable_irq();
-		objectTXproceed(node, newTXobj, 0, LC_Ok);
-		//add to queue, critical section
-		if ((volatile lc_objBuffered*) node->TxRxObjects.objTXbuf_start == 0) {
-			//no objects in tx array
-			newTXobj->Previous = 0;
-			node->TxRxObjects.objTXbuf_start = newTXobj;
-			node->TxRxObjects.objTXbuf_end = newTXobj;
-		} else {
-			//add to the end
-			newTXobj->Previous = (intptr_t*) node->TxRxObjects.objTXbuf_end;
-			((lc_objBuffered*) node->TxRxObjects.objTXbuf_end)->Next = (intptr_t*) newTXobj;
-			node->TxRxObjects.objTXbuf_end = (void*) newTXobj;
-		}
-		lc_enable_irq();
-#ifdef LEVCAN_TRACE
-		//trace_printf("New TX object created:%d\n", newTXobj->Header.MsgID);
-#endif
+		txStart(node, newTXobj, (object->Size > payload || strl == payload));
 	} else {
 		//some short string? + ending
 		int32_t size = object->Size;
 		if (size < 0)
 			size = strl + 1;
 
-		//fast send
-		uint32_t data[2];
-		memcpy(data, dataAddr, size);
+		//fast send, empty message is answer to request of missing object
+		uint32_t data[LEVCAN_MAX_FRAME / 4];
+		if (size)
+			memcpy(data, dataAddr, size);
 #ifndef LEVCAN_MEM_STATIC
 		if (object->Attributes.Cleanup)
-			lcfree(object->Address);
+			lc_slabFree(object->Address);
 #endif
-		LC_HeaderPacked_t hdr = { 0 };
-		hdr.MsgID = index;
-		hdr.Priority = ~object->Attributes.Priority;
-		hdr.Request = 0;
-		hdr.Parity = 0;
-		hdr.RTS_CTS = 1;    //data start
-		hdr.EoM = 1;    //data end
-		hdr.Source = node->ShortName.NodeID;
-		hdr.Target = object->NodeID;
-
-		return ((LC_DriverCalls_t*) node->Driver)->Send(hdr, data, size);
+		return sendSingle(node, object, index, data, size);
 	}
 	return LC_Ok;
 }
 
+/// Sends message gathered from several memory segments, i.e. header on stack and data from file buffer.
+/// Segments up to LEVCAN_SEGMENT_INLINE bytes are copied, longer ones are referenced until transfer ends
+/// @param node
+/// @param object NodeID and Attributes of message, Address and Size are ignored
+/// @param segments list of data segments, sent in this order
+/// @param count number of segments
+/// @param index message id
+/// @return LC_Ok if transfer started
+LC_Return_t LC_SendMessageV(LC_NodeDescriptor_t *node, LC_ObjectRecord_t *object, const LC_Segment_t *segments, uint8_t count, uint16_t index) {
+	if (node == 0)
+		return LC_DataError;
+	if (node->State != LCNodeState_Online)
+		return LC_NodeOffline;
+	if (object == 0 || (segments == 0 && count))
+		return LC_ObjectError;
+	int32_t total = 0;
+	uint32_t copied = 0;
+	for (int i = 0; i < count; i++) {
+		if (segments[i].Data == 0 && segments[i].Size != 0)
+			return LC_DataError;
+		total += segments[i].Size;
+		if (segments[i].Size <= LEVCAN_SEGMENT_INLINE)
+			copied += segments[i].Size;
+	}
+	uint8_t payload = linkPayload(node, object->NodeID);
+
+	if (object->Attributes.TCP || total > payload) {
+		//segment list and short segments go together in one block
+		uint32_t listSize = sizeof(lc_txSegments_t) + count * sizeof(LC_Segment_t) + copied;
+#ifdef LEVCAN_MEM_STATIC
+		//list is kept in object data, buffers can't be freed
+		if (object->Attributes.Cleanup == 1 || listSize > LEVCAN_OBJECT_DATASIZE)
+			return LC_MallocFail;
+#else
+		lc_txSegments_t *list = lc_slabAlloc(listSize);
+		if (list == 0) {
+			node->TxRxObjects.Statistics.MallocFail++;
+			countMessage(node, index, statErrors);
+			return LC_MallocFail;
+		}
+#endif
+		LC_Return_t result;
+		lc_objBuffered *newTXobj = txCreate(node, object, index, payload, &result);
+		if (newTXobj == 0) {
+#ifndef LEVCAN_MEM_STATIC
+			lc_slabFree(list);
+#endif
+			return result;
+		}
+#ifdef LEVCAN_MEM_STATIC
+		lc_txSegments_t *list = (lc_txSegments_t*) newTXobj->Data;
+#else
+		newTXobj->Pointer = (char*) list;
+#endif
+		char *inlined = (char*) &list->Segment[count];
+		list->Count = count;
+		for (int i = 0; i < count; i++) {
+			list->Segment[i] = segments[i];
+			if (segments[i].Size <= LEVCAN_SEGMENT_INLINE) {
+				memcpy(inlined, segments[i].Data, segments[i].Size);
+				list->Segment[i].Data = inlined;
+				inlined += segments[i].Size;
+			}
+		}
+		newTXobj->Length = total;
+		newTXobj->Flags.Segmented = 1;
+		txStart(node, newTXobj, total > payload);
+	} else {
+		//fast send
+		uint32_t data[LEVCAN_MAX_FRAME / 4];
+		char *out = (char*) data;
+		for (int i = 0; i < count; i++) {
+			memcpy(out, segments[i].Data, segments[i].Size);
+			out += segments[i].Size;
+#ifndef LEVCAN_MEM_STATIC
+			if (object->Attributes.Cleanup && segments[i].Size > LEVCAN_SEGMENT_INLINE)
+				lc_slabFree((void*) segments[i].Data);
+#endif
+		}
+		return sendSingle(node, object, index, data, total);
+	}
+	return LC_Ok;
+}
+
+/// Creates TX object for multi-frame transfer, data pointer and length should be set by caller
+/// @param node
+/// @param object
+/// @param index
+/// @param payload data bytes per frame on this link
+/// @param result error code if no object created
+/// @return new object or 0
+lc_objBuffered* txCreate(LC_NodeDescriptor_t *node, LC_ObjectRecord_t *object, uint16_t index, uint8_t payload, LC_Return_t *result) {
+	//avoid dual same id
+	lc_objBuffered *txProceed = findObject(node, LC_TX, index, object->NodeID, node->ShortName.NodeID);
+	if (txProceed) {
+		node->TxRxObjects.Statistics.Collisions++;
+		countMessage(node, index, statErrors);
+		lc_trace(node, LC_TraceTXCollision, index, txProceed->Header.Source, txProceed->Header.Target, txProceed->Position);
+		*result = LC_Collision;
+		return 0;
+	}
+
+	if (object->NodeID == node->ShortName.NodeID) {
+		*result = LC_Collision;
+		return 0;
+	}
+	//form message header
+	LC_HeaderPacked_t hdr = { 0 };
+	hdr.MsgID = index;    //our node index
+	hdr.Priority = ~object->Attributes.Priority;
+	hdr.Request = 0;    //data sending...
+	hdr.Source = node->ShortName.NodeID;
+	hdr.Target = object->NodeID;
+	//create object sender instance
+#ifndef LEVCAN_MEM_STATIC
+	lc_objBuffered *newTXobj = (lc_objBuffered*) lc_slabAlloc(sizeof(lc_objBuffered));
+#else
+	lc_objBuffered *newTXobj = getFreeObject(node);
+#endif
+	if (newTXobj == 0) {
+		node->TxRxObjects.Statistics.MallocFail++;
+		countMessage(node, index, statErrors);
+		*result = LC_MallocFail;
+		return 0;
+	}
+	newTXobj->Attempt = 0;
+	newTXobj->Header = hdr;
+	newTXobj->Length = 0;
+	newTXobj->Pointer = 0;
+	newTXobj->Position = 0;
+	newTXobj->LastComm = lc_now(node);
+	lc_timerSetup(&newTXobj->Timer, txTimeout, newTXobj);
+	newTXobj->ReadyNext = 0;
+	newTXobj->Ready = 0;
+	newTXobj->Credits = 0;
+	newTXobj->FrameSize = payload;
+	newTXobj->Next = 0;
+	newTXobj->FlagsTotal = 0;
+	newTXobj->Flags.TCP = object->Attributes.TCP;
+	newTXobj->Flags.TXcleanup = object->Attributes.Cleanup;
+	memset(&newTXobj->Window, 0, sizeof(newTXobj->Window));
+	*result = LC_Ok;
+	return newTXobj;
+}
+
+/// Sends first frame of new TX object and passes rest to network manager
+/// @param node
+/// @param object
+/// @param multiframe data doesn't fit in one frame
+void txStart(LC_NodeDescriptor_t *node, lc_objBuffered *object, uint8_t multiframe) {
+#if LEVCAN_TCP_WINDOW > 0
+	//multi-frame transfer and receiver supports announce?
+	if (multiframe && object->Header.Target < LC_Null_Address && LC_GetNode(node, object->Header.Target).ExtTransfer) {
+		if (object->Flags.TCP)
+			object->Window.Size = LEVCAN_TCP_WINDOW;
+		else
+			object->Window.Announce = 1;
+	}
+#else
+	(void) multiframe;
+#endif
+	lc_trace(node, LC_TraceTXStart, object->Header.MsgID, object->Header.Source, object->Header.Target, object->Length);
+	//process it first to avoid collision in multithread, only first frame is sent here
+	lc_disable_irq();
+	objectTXproceed(node, object, 0, LC_Ok);
+	//add to queue, critical section
+	insertObject(node, object, LC_TX);
+	lc_enable_irq();
+	//rest goes in priority order with other transfers, queued and network manager woken up
+	objectTimer(node, object, LC_TX);
+}
+
+/// Copies TX data of object, plain buffer or segment list
+/// @param object
+/// @param position first byte of transfer to copy
+/// @param to
+/// @param length
+void txCopy(lc_objBuffered *object, int32_t position, void *to, int32_t length) {
+	if (object->Flags.Segmented == 0) {
+		memcpy(to, &object->Pointer[position], length);
+		return;
+	}
+	lc_txSegments_t *list = txSegments(object);
+	char *out = to;
+	for (int i = 0; i < list->Count && length > 0; i++) {
+		const LC_Segment_t *segment = &list->Segment[i];
+		if ((uint32_t) position >= segment->Size) {
+			position -= segment->Size;
+			continue;
+		}
+		int32_t chunk = segment->Size - position;
+		if (chunk > length)
+			chunk = length;
+		memcpy(out, (const char*) segment->Data + position, chunk);
+		out += chunk;
+		length -= chunk;
+		position = 0;
+	}
+}
+
+/// Frees TX data of finished object if it was marked for cleanup, safe to call again
+/// @param object
+void txRelease(lc_objBuffered *object) {
+#ifndef LEVCAN_MEM_STATIC
+	if (object->Flags.Segmented) {
+		lc_txSegments_t *list = txSegments(object);
+		//inline segments are part of the list
+		if (object->Flags.TXcleanup)
+			for (int i = 0; i < list->Count; i++)
+				if (list->Segment[i].Size > LEVCAN_SEGMENT_INLINE)
+					lc_slabFree((void*) list->Segment[i].Data);
+		lc_slabFree(list);
+	} else if (object->Flags.TXcleanup)
+		lc_slabFree(object->Pointer);
+#endif
+	object->Flags.Segmented = 0;
+	object->Flags.TXcleanup = 0;
+	object->Pointer = 0;
+}
+
+/// Sends data as single frame message
+/// @param node
+/// @param object
+/// @param index
+/// @param data
+/// @param size
+/// @return
+LC_Return_t sendSingle(LC_NodeDescriptor_t *node, LC_ObjectRecord_t *object, uint16_t index, uint32_t *data, uint8_t size) {
+	LC_HeaderPacked_t hdr = { 0 };
+	hdr.MsgID = index;
+	hdr.Priority = ~object->Attributes.Priority;
+	hdr.Request = 0;
+	hdr.Parity = 0;
+	hdr.RTS_CTS = 1;    //data start
+	hdr.EoM = 1;    //data end
+	hdr.Source = node->ShortName.NodeID;
+	hdr.Target = object->NodeID;
+
+	return lc_sendFrame(node, hdr, data, framePad(data, size));
+}
+
 LC_Return_t LC_SendRequest(LC_NodeDescriptor_t *node, uint16_t target, uint16_t index) {
 	return LC_SendRequestSpec(node, target, index, 0, 0);
 }
@@ -925,7 +2253,117 @@ LC_Return_t LC_SendRequestSpec(LC_NodeDescriptor_t *node, uint16_t target, uint1
 	hdr.Source = node->ShortName.NodeID;
 	hdr.Target = target;
 
-	return ((LC_DriverCalls_t*) node->Driver)->Send(hdr, 0, size);
+	return lc_sendFrame(node, hdr, 0, size);
+}
+
+/// Requests object from other node, response goes to request->Callback instead of dictionary.
+/// Any number of requests may be pending, one per handle
+/// @param node
+/// @param request handle with Callback set
+/// @param target node ID, LC_Broadcast_Address completes on first response
+/// @param index MsgID
+/// @param timeout ms to wait for complete response
+/// @return LC_Ok if request sent, LC_Collision if handle is still pending
+LC_Return_t LC_SendRequestAsync(LC_NodeDescriptor_t *node, LC_Request_t *request, uint16_t target, uint16_t index, uint32_t timeout) {
+	if (node == 0 || request == 0 || request->Callback == 0)
+		return LC_DataError;
+	if (node->State != LCNodeState_Online)
+		return LC_NodeOffline;
+
+	lc_disable_irq();
+	for (LC_Request_t *pending = (LC_Request_t*) node->TxRxObjects.requests; pending; pending = pending->Next) {
+		if (pending == request) {
+			lc_enable_irq();
+			return LC_Collision;
+		}
+	}
+	request->MsgID = index;
+	request->Target = target;
+	lc_timerSetup(&request->Timer, requestTimeout, request);
+	//listed before sending, response may come from other task
+	request->Next = (LC_Request_t*) node->TxRxObjects.requests;
+	node->TxRxObjects.requests = request;
+	lc_enable_irq();
+	lc_timerStartAt(&node->Timers, &request->Timer, lc_now(node) + timeout);
+	LC_NetworkManagerWakeup(node);
+
+	LC_Return_t result = LC_SendRequestSpec(node, target, index, 0, 0);
+	if (result != LC_Ok && requestUnlink(node, request))
+		lc_timerStop(&node->Timers, &request->Timer);
+	return result;
+}
+
+/// Stops waiting for LC_SendRequestAsync response, callback is not called
+/// @param node
+/// @param request
+/// @return LC_Ok if request was pending
+LC_Return_t LC_CancelRequest(LC_NodeDescriptor_t *node, LC_Request_t *request) {
+	if (node == 0 || request == 0)
+		return LC_DataError;
+	if (requestUnlink(node, request) == 0)
+		return LC_ObjectError;
+	lc_timerStop(&node->Timers, &request->Timer);
+	return LC_Ok;
+}
+
+void requestTimeout(void *context, lc_timer_t *timer) {
+	LC_NodeDescriptor_t *node = context;
+	LC_Request_t *request = timer->Owner;
+	//completed meanwhile?
+	if (requestUnlink(node, request) == 0)
+		return;
+	node->TxRxObjects.Statistics.RequestTimeouts++;
+	countMessage(node, request->MsgID, statErrors);
+	lc_trace(node, LC_TraceRequestTimeout, request->MsgID, node->ShortName.NodeID, request->Target, 0);
+	request->Callback(node, request, LC_Timeout, request->Target, 0, 0);
+}
+
+uint8_t requestUnlink(LC_NodeDescriptor_t *node, LC_Request_t *request) {
+	uint8_t found = 0;
+	lc_disable_irq();
+	for (LC_Request_t **link = (LC_Request_t**) &node->TxRxObjects.requests; *link; link = &(*link)->Next) {
+		if (*link == request) {
+			*link = request->Next;
+			request->Next = 0;
+			found = 1;
+			break;
+		}
+	}
+	lc_enable_irq();
+	return found;
+}
+
+/// Passes received data to every pending request of this MsgID and source. Only data addressed to this node
+/// is a response, broadcast of same MsgID goes on to maps and dictionary
+/// @return 1 if data was taken by requests
+uint8_t requestComplete(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header, char *data, int32_t size) {
+	LC_Request_t *done = 0;
+	if (header.Target != node->ShortName.NodeID)
+		return 0;
+	lc_disable_irq();
+	for (LC_Request_t **link = (LC_Request_t**) &node->TxRxObjects.requests; *link;) {
+		LC_Request_t *request = *link;
+		if (request->MsgID == header.MsgID && (request->Target == header.Source || request->Target == LC_Broadcast_Address)) {
+			*link = request->Next;
+			request->Next = done;
+			done = request;
+		} else
+			link = &request->Next;
+	}
+	lc_enable_irq();
+	if (done == 0)
+		return 0;
+	//responder without such object sends empty message
+	LC_Return_t status = (size > 0) ? LC_Ok : LC_ObjectError;
+	while (done) {
+		LC_Request_t *request = done;
+		done = request->Next;
+		request->Next = 0;
+		lc_timerStop(&node->Timers, &request->Timer);
+		//handle may be reused in callback
+		request->Callback(node, request, status, header.Source, data, size);
+	}
+	return 1;
 }
 
 void LC_ReceiveManager(LC_NodeDescriptor_t *node) {
@@ -936,125 +2374,207 @@ void LC_ReceiveManager(LC_NodeDescriptor_t *node) {
 #ifdef LEVCAN_USE_RTOS_QUEUE
 	while (LC_QueueReceive(node->TxRxObjects.rxQueue, &rxBuffered, 100)) {
 #else
-	while (node->TxRxObjects.rxFIFO_in != node->TxRxObjects.rxFIFO_out) {
-		rxBuffered = node->TxRxObjects.rxFIFO[node->TxRxObjects.rxFIFO_out];
-		node->TxRxObjects.rxFIFO_out = (node->TxRxObjects.rxFIFO_out + 1) % LEVCAN_RX_SIZE;
+	lc_msgBuffered rxBurst[LEVCAN_RX_BURST];
+	uint16_t count;
+	//drain FIFO by bursts, each message processed in the loop below
+	while ((count = rxDequeue(node, rxBurst, LEVCAN_RX_BURST)) != 0) {
+		for (uint16_t i = 0; i < count; i++) {
+			rxBuffered = rxBurst[i];
 #endif
-		if (rxBuffered.header.Request) {
-			if (rxBuffered.header.RTS_CTS == 0 && rxBuffered.header.EoM == 0) {
-				//Remote transfer request, try to create new TX object
-				LC_ObjectRecord_t obj = findObjectRecord(node, rxBuffered.header.MsgID, rxBuffered.length, Read, rxBuffered.header.Source);
-				obj.NodeID = rxBuffered.header.Source;    //receiver
-				if (obj.Attributes.Function && obj.Address) {
-					//function call before sending
-					//unpack header
-					LC_Header_t unpack = LC_HeaderUnpack(rxBuffered.header);
-					//call object
-					((LC_FunctionCall_t) obj.Address)(node, unpack, 0, 0);
-				} else {
-					//check for existing objects, dual request denied
-					//ToDo is this best way? maybe reset tx?
-					lc_objBuffered *txProceed = findObject((void*) node->TxRxObjects.objTXbuf_start, rxBuffered.header.MsgID, rxBuffered.header.Source,
-							rxBuffered.header.Target);
-					if (txProceed == 0) {
-						obj.Attributes.TCP |= rxBuffered.header.Parity;    //force TCP mode if requested
-						LC_SendMessage(node, &obj, rxBuffered.header.MsgID);
+			if (rxBuffered.header.Request) {
+				if (rxBuffered.header.RTS_CTS == 0 && rxBuffered.header.EoM == 0) {
+					//Remote transfer request, try to create new TX object
+					if (findMap(node, rxBuffered.header.MsgID)) {
+						LC_SendMap(node, rxBuffered.header.MsgID, rxBuffered.header.Source, LC_Priority_Low);
+						continue;
+					}
+					LC_ObjectRecord_t obj = findObjectRecord(node, rxBuffered.header.MsgID, rxBuffered.length, Read, rxBuffered.header.Source);
+					obj.NodeID = rxBuffered.header.Source;    //receiver
+					if (obj.Attributes.Function && obj.Address) {
+						//function call before sending
+						//unpack header
+						LC_Header_t unpack = LC_HeaderUnpack(rxBuffered.header);
+						//call object
+						((LC_FunctionCall_t) obj.Address)(node, unpack, 0, 0);
 					} else {
-#ifdef LEVCAN_TRACE
-						trace_printf("RX dual request denied:%d, from node:%d \n", rxBuffered.header.MsgID, rxBuffered.header.Source);
-#endif
+						//check for existing objects, dual request denied
+						//ToDo is this best way? maybe reset tx?
+						lc_objBuffered *txProceed = findObject(node, LC_TX, rxBuffered.header.MsgID, rxBuffered.header.Source, rxBuffered.header.Target);
+						if (txProceed == 0) {
+							obj.Attributes.TCP |= rxBuffered.header.Parity;    //force TCP mode if requested
+							LC_SendMessage(node, &obj, rxBuffered.header.MsgID);
+						} else {
+							node->TxRxObjects.Statistics.DualRequests++;
+							countMessage(node, rxBuffered.header.MsgID, statErrors);
+							lc_trace(node, LC_TraceRXDualRequest, rxBuffered.header.MsgID, rxBuffered.header.Source, rxBuffered.header.Target, 0);
+						}
 					}
+				} else {
+					//find existing TX object, tcp clear-to-send and end-of-msg-ack
+					lc_objBuffered *TXobj = findObject(node, LC_TX, rxBuffered.header.MsgID, rxBuffered.header.Source, rxBuffered.header.Target);
+					if (TXobj) {
+						objectTXproceed(node, TXobj, &rxBuffered, LC_Ok);
+						//granted window goes in priority order with other transfers, sent by network manager
+						objectTimer(node, TXobj, LC_TX);
+					} else
+						lc_trace(node, LC_TraceRXUnknown, rxBuffered.header.MsgID, rxBuffered.header.Source, rxBuffered.header.Target, 0);
 				}
 			} else {
-				//find existing TX object, tcp clear-to-send and end-of-msg-ack
-				lc_objBuffered *TXobj = findObject((void*) node->TxRxObjects.objTXbuf_start, rxBuffered.header.MsgID, rxBuffered.header.Source, rxBuffered.header.Target);
-				if (TXobj) {
-					objectTXproceed(node, TXobj, &rxBuffered.header, LC_Ok);
-				} else {
-#ifdef LEVCAN_TRACE
-						trace_printf("RX unknown data:%d, from node:%d \n", rxBuffered.header.MsgID, rxBuffered.header.Source);
+				//we got data
+				if (rxBuffered.header.RTS_CTS) {
+					//address valid?
+					if (rxBuffered.header.Source >= LC_Null_Address) {
+						//get next buffer index
+						continue;
+					}
+					if (rxBuffered.header.EoM && rxBuffered.header.Parity == 0) {
+						//fast receive for udp
+						//failure is counted and traced inside
+						objectRXfinish(node, rxBuffered.header, (char*) &rxBuffered.data, rxBuffered.length, 0);
+					} else {
+						//find existing RX object, delete in case we get new RequestToSend
+						lc_objBuffered *RXobj = findObject(node, LC_RX, rxBuffered.header.MsgID, rxBuffered.header.Target, rxBuffered.header.Source);
+						if (RXobj) {
+							RXobj->FlagsTotal = toDeleteMark; //garbage collector mark
+							objectTimer(node, RXobj, LC_RX);
+							//lcfree(RXobj->Pointer);
+							//deleteObject(node, RXobj, (void*) &objRXbuf_start, (void*) &objRXbuf_end);
+						}
+						//announced transfer length, 0 - unknown
+						uint32_t announced = 0;
+						if (isAnnounce(&rxBuffered) && rxBuffered.length >= announceSize) {
+							uint8_t *bytes = (uint8_t*) rxBuffered.data;
+							for (int i = 0; i < 4; i++)
+								announced |= (uint32_t) bytes[1 + i] << (i * 8);
+						}
+						int32_t size = LEVCAN_OBJECT_DATASIZE;
+#ifndef LEVCAN_MEM_STATIC
+						if (announced > LEVCAN_RX_MAXSIZE) {
+#else
+						if (announced > LEVCAN_OBJECT_DATASIZE) {
 #endif
-				}
-			}
-		} else {
-			//we got data
-			if (rxBuffered.header.RTS_CTS) {
-				//address valid?
-				if (rxBuffered.header.Source >= LC_Null_Address) {
-					//get next buffer index
-					continue;
-				}
-				if (rxBuffered.header.EoM && rxBuffered.header.Parity == 0) {
-					//fast receive for udp
-					if (objectRXfinish(node, rxBuffered.header, (char*) &rxBuffered.data, rxBuffered.length, 0)) {
-#ifdef LEVCAN_TRACE
-						trace_printf("RX fast failed:%d \n", rxBuffered.header.MsgID);
+							//will not fit anyway
+							if (rxBuffered.header.Parity)
+								sendReject(node, rxBuffered.header);
+							continue;
+						}
+#ifndef LEVCAN_MEM_STATIC
+						//at least one full frame, wrong announce just grows buffer
+						if (announced)
+							size = (announced > LEVCAN_MAX_FRAME) ? announced : LEVCAN_MAX_FRAME;
 #endif
-					}
-				} else {
-					//find existing RX object, delete in case we get new RequestToSend
-					lc_objBuffered *RXobj = findObject((lc_objBuffered*) node->TxRxObjects.objRXbuf_start, rxBuffered.header.MsgID, rxBuffered.header.Target,
-							rxBuffered.header.Source);
-					if (RXobj) {
-						RXobj->FlagsTotal = toDeleteMark; //garbage collector mark
-						//lcfree(RXobj->Pointer);
-						//deleteObject(node, RXobj, (void*) &objRXbuf_start, (void*) &objRXbuf_end);
-					}
-					//create new receive object
+						//create new receive object
 #ifndef LEVCAN_MEM_STATIC
-					lc_objBuffered *newRXobj = (lc_objBuffered*) lcmalloc(sizeof(lc_objBuffered));
+						lc_objBuffered *newRXobj = (lc_objBuffered*) lc_slabAlloc(sizeof(lc_objBuffered));
 #else
-					lc_objBuffered *newRXobj = getFreeObject(node);
+						lc_objBuffered *newRXobj = getFreeObject(node);
 #endif
-					if (newRXobj == 0) {
-						//get next buffer index
-						continue;
-					}
-					//data alloc
+						if (newRXobj == 0) {
+							node->TxRxObjects.Statistics.MallocFail++;
+							countMessage(node, rxBuffered.header.MsgID, statErrors);
+							//get next buffer index
+							continue;
+						}
+						//data alloc, exact size if announced
 #ifndef LEVCAN_MEM_STATIC
-					newRXobj->Pointer = lcmalloc(LEVCAN_OBJECT_DATASIZE);
-					if (newRXobj->Pointer == 0) {
-						lcfree(newRXobj);
-						continue;
-					}
+						newRXobj->Pointer = lc_slabAlloc(size);
+						if (newRXobj->Pointer == 0) {
+							node->TxRxObjects.Statistics.MallocFail++;
+							countMessage(node, rxBuffered.header.MsgID, statErrors);
+							lc_slabFree(newRXobj);
+							if (announced && rxBuffered.header.Parity)
+								sendReject(node, rxBuffered.header);
+							continue;
+						}
 #endif
-					newRXobj->Length = LEVCAN_OBJECT_DATASIZE;
-					newRXobj->Header = rxBuffered.header;
-					newRXobj->FlagsTotal = 0;
-					newRXobj->Flags.TCP = rxBuffered.header.Parity;    //setup rx mode
-					newRXobj->Position = 0;
-					newRXobj->Attempt = 0;
-					newRXobj->Time_since_comm = 0;
-					newRXobj->Next = 0;
-					newRXobj->Previous = 0;
-					//for future-proof anti-collision, processing first
-					objectRXproceed(node, newRXobj, &rxBuffered);
-
-					lc_disable_irq();
-					//critical add to end
-					if (node->TxRxObjects.objRXbuf_start == 0) {
-						//no objects in rx array
-						node->TxRxObjects.objRXbuf_start = newRXobj;
-						node->TxRxObjects.objRXbuf_end = newRXobj;
-					} else {
-						//add to the end
-						newRXobj->Previous = (intptr_t*) node->TxRxObjects.objRXbuf_end;
-						((lc_objBuffered*) node->TxRxObjects.objRXbuf_end)->Next = (intptr_t*) newRXobj;
-						node->TxRxObjects.objRXbuf_end = newRXobj;
+						newRXobj->Length = size;
+						newRXobj->Header = rxBuffered.header;
+						newRXobj->FlagsTotal = 0;
+						newRXobj->Flags.TCP = rxBuffered.header.Parity;    //setup rx mode
+						//sender fills every frame but last, parity mode steps by first one
+						newRXobj->FrameSize = (rxBuffered.length > 8) ? rxBuffered.length : 8;
+						memset(&newRXobj->Window, 0, sizeof(newRXobj->Window));
+						newRXobj->Position = 0;
+						newRXobj->Attempt = 0;
+						newRXobj->LastComm = lc_now(node);
+						lc_timerSetup(&newRXobj->Timer, rxTimeout, newRXobj);
+						newRXobj->Next = 0;
+						newRXobj->Previous = 0;
+						//for future-proof anti-collision, processing first
+						objectRXproceed(node, newRXobj, &rxBuffered);
+
+						lc_disable_irq();
+						insertObject(node, newRXobj, LC_RX);
+						lc_enable_irq();
+						objectTimer(node, newRXobj, LC_RX);
+						lc_trace(node, LC_TraceRXStart, newRXobj->Header.MsgID, newRXobj->Header.Source, newRXobj->Header.Target, announced);
+					}
+				} else {
+					//find existing RX object
+					lc_objBuffered *RXobj = findObject(node, LC_RX, rxBuffered.header.MsgID, rxBuffered.header.Target, rxBuffered.header.Source);
+					if (RXobj) {
+						objectRXproceed(node, RXobj, &rxBuffered);
+						objectTimer(node, RXobj, LC_RX);
 					}
-					lc_enable_irq();
-					//	trace_printf("New RX object created:%d\n", newRXobj->Header.MsgID);
 				}
-			} else {
-				//find existing RX object
-				lc_objBuffered *RXobj = findObject((void*) node->TxRxObjects.objRXbuf_start, rxBuffered.header.MsgID, rxBuffered.header.Target, rxBuffered.header.Source);
-				if (RXobj)
-					objectRXproceed(node, RXobj, &rxBuffered);
 			}
+#ifndef LEVCAN_USE_RTOS_QUEUE
 		}
+#endif
 	}
 }
 
+#ifndef LEVCAN_USE_RTOS_QUEUE
+uint16_t rxDequeue(LC_NodeDescriptor_t *node, lc_msgBuffered *buffer, uint16_t max) {
+	//single consumer: only receive manager writes rxFIFO_out
+	uint16_t out = node->TxRxObjects.rxFIFO_out;
+	uint16_t count = lc_load_acquire(&node->TxRxObjects.rxFIFO_in) - out;
+	if (count > max)
+		count = max;
+	for (uint16_t i = 0; i < count; i++)
+		buffer[i] = node->TxRxObjects.rxFIFO[(uint16_t) (out + i) & (LEVCAN_RX_SIZE - 1)];
+	//slots may be reused only after messages copied
+	if (count)
+		lc_store_release(&node->TxRxObjects.rxFIFO_out, (uint16_t) (out + count));
+	return count;
+}
+#endif
+
+/// Returns number of received messages dropped because RX buffer was full
+/// @param node
+/// @return
+uint32_t LC_GetReceiveOverflow(LC_NodeDescriptor_t *node) {
+	if (node == 0)
+		return 0;
+	return node->TxRxObjects.Statistics.RXOverflow;
+}
+
+/// Copies protocol statistics at once, counters can be cleared in the same critical section
+/// @param node
+/// @param stats Node counters, can be 0
+/// @param msgStats Copy of node->MsgStatistics, MsgStatisticsSize entries, can be 0
+/// @param reset 1 - clear counters after copy
+/// @return LC_Ok, LC_DataError if no node
+LC_Return_t LC_GetStatistics(LC_NodeDescriptor_t *node, LC_Statistics_t *stats, LC_MsgStatistics_t *msgStats, uint8_t reset) {
+	if (node == 0)
+		return LC_DataError;
+	lc_disable_irq();
+	if (stats)
+		*stats = node->TxRxObjects.Statistics;
+	if (msgStats && node->MsgStatisticsSize)
+		memcpy(msgStats, node->MsgStatistics, sizeof(LC_MsgStatistics_t) * node->MsgStatisticsSize);
+	if (reset) {
+		memset(&node->TxRxObjects.Statistics, 0, sizeof(node->TxRxObjects.Statistics));
+		for (int i = 0; i < node->MsgStatisticsSize; i++) {
+			node->MsgStatistics[i].FramesRX = 0;
+			node->MsgStatistics[i].FramesTX = 0;
+			node->MsgStatistics[i].Errors = 0;
+		}
+	}
+	lc_enable_irq();
+	return LC_Ok;
+}
+
 LC_NodeShortName_t LC_GetNode(LC_NodeDescriptor_t *node, uint16_t nodeID) {
 	int i = 0;
 
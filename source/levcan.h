@@ -6,6 +6,7 @@
  /* Application specific configuration options. */
 
 #include "levcan_config.h"
+#include "levcan_timer.h"
 
 #pragma once
 
@@ -41,6 +42,88 @@ typedef struct {
 	void *Address; //pointer to memory data. if LC_ObjectAttributes_t.Pointer=1, this is pointer to pointer
 } LC_ObjectRecord_t;
 
+//LC_SendMessageV data segment
+typedef struct {
+	const void *Data;
+	uint32_t Size;
+} LC_Segment_t;
+
+//LC_PublishEntry_t.Phase: spread evenly with other entries using it
+#define LC_PublishAutoPhase UINT16_MAX
+
+//LC_PublishEntry_t.DeadbandType: object is compared as array of these elements
+typedef enum {
+	LC_Deadband_Exact, //any changed byte, for flags and bitfields like LC_Obj_Buttons_t
+	LC_Deadband_Int8,
+	LC_Deadband_Uint8,
+	LC_Deadband_Int16,
+	LC_Deadband_Uint16,
+	LC_Deadband_Int32,
+	LC_Deadband_Uint32,
+	LC_Deadband_Float,
+} LC_Deadband_t;
+
+typedef struct {
+	uint16_t MsgID; //dictionary object, sent same way as answer to read request
+	uint16_t Period; //ms, 0 - entry disabled. Keep-alive period in change-of-state mode
+	uint16_t Phase; //ms after LC_PublishStart to the first send, or LC_PublishAutoPhase
+	uint8_t Priority; //LC_Priority_t
+	uint8_t Target; //receiver node ID, LC_Broadcast_Address for all
+	//change-of-state mode, enabled by Snapshot
+	void *Snapshot; //last sent value, buffer of object size
+	uint16_t Inhibit; //ms, minimum time between sends, object checked for changes at this rate
+	uint8_t DeadbandType; //LC_Deadband_t
+	float Deadband; //smaller or equal change of every element is not sent, 0 - any change
+	uint32_t LastSent; //private
+	lc_timer_t Timer; //private
+} LC_PublishEntry_t;
+
+typedef struct {
+	uint16_t MsgID; //dictionary object, Size should match it
+	uint8_t Size; //bytes taken in frame
+} LC_MapField_t;
+
+//Frame, RX overflow, TX buffer and LC_MsgStatistics_t counters are atomic. Others are counted by managers
+//and LC_SendMessage without locking, approximate if they run in different threads
+typedef struct {
+	uint32_t FramesRX; //frames given to LC_ReceiveHandler
+	uint32_t FramesTX; //frames taken by driver
+	uint32_t RXOverflow; //received frames lost, RX buffer full
+	uint32_t TXBufferFull; //frames rejected by driver, LC_BufferFull
+	uint32_t Retransmits; //TCP frames or window repeated after timeout or partial acknowledge
+	uint32_t ParityRollbacks; //TCP parity mode, receiver asked for previous frame again
+	uint32_t TXTimeouts; //transfers deleted by timeout or attempts
+	uint32_t RXTimeouts; //incomplete receptions deleted by timeout
+	uint32_t MallocFail; //transfer object or data didn't fit memory
+	uint32_t Collisions; //LC_SendMessage while same object still sending
+	uint32_t DualRequests; //request denied, same object still sending
+	uint32_t RXNoObject; //received data has no writable object in dictionary
+	uint32_t RequestTimeouts; //LC_SendRequestAsync without response in time
+} LC_Statistics_t;
+
+typedef struct {
+	uint16_t MsgID;
+	uint32_t FramesRX;
+	uint32_t FramesTX;
+	uint32_t Errors; //overflows, timeouts, memory, collisions and missing objects of this MsgID
+} LC_MsgStatistics_t;
+
+typedef struct {
+	uint32_t Time; //LEVCAN_TRACE_TIME
+	int32_t Position; //transfer position or event argument, see LC_TraceEvent_t
+	uint16_t MsgID;
+	uint8_t Event; //LC_TraceEvent_t
+	uint8_t Source;
+	uint8_t Target;
+	uint8_t reserved[3];
+} LC_TraceRecord_t;
+
+typedef struct {
+	uint16_t MsgID; //frame ID, used instead of dictionary for both sending and receiving
+	uint8_t FieldsSize;
+	const LC_MapField_t *Fields; //packed one after another, up to 8 bytes total
+} LC_Map_t;
+
 typedef struct {
 	uint8_t Source; //7 bits
 	uint8_t Target; //7 bits
@@ -89,7 +172,9 @@ typedef struct {
 			uint32_t Events : 1; 		//3 Have LEVCAN events
 			uint32_t FileServer : 1;	//4 Have file server running
 			uint32_t CodePage : 16;		//5-20 https://docs.microsoft.com/en-us/dotnet/api/system.text.encoding?view=netcore-3.1
-			uint32_t reserved1 : (32 - 5 - 16 - 1);		//21-30
+			uint32_t ExtTransfer : 1;	//21 Supports length announce and windowed TCP transfers
+			uint32_t CanFD : 1;			//22 Receives CAN FD frames up to 64 bytes
+			uint32_t reserved1 : (32 - 6 - 16 - 2);		//23-30
 			uint32_t DynamicID : 1;		//31 1-Yes, 0-No, MSB bit, defines priority on CAN bus
 			//32b align
 			uint32_t DeviceType : 10;	//32-41 LC_Device_t
@@ -132,6 +217,20 @@ enum {
 #ifndef LEVCAN_SYS_OBJ_SIZ
 #define LEVCAN_SYS_OBJ_SIZ (LC_SYS_End - LC_SYS_NodeName)
 #endif
+//Hash buckets for active TX and RX objects, power of two
+#ifndef LEVCAN_OBJECT_HASH_SIZE
+#define LEVCAN_OBJECT_HASH_SIZE 16
+#endif
+//Static memory: maximum indexed dictionary records (objects + record array elements), 0 - no index, linear search
+#ifndef LEVCAN_OBJECT_INDEX_SIZE
+#define LEVCAN_OBJECT_INDEX_SIZE 0
+#endif
+//Largest frame data length: 8 - classic CAN, CAN FD - 12, 16, 20, 24, 32, 48 or 64
+#ifndef LEVCAN_MAX_FRAME
+#define LEVCAN_MAX_FRAME 8
+#endif
+//Binary trace records per node, power of two, undefined - no trace ring. See levcan_trace.h
+//#define LEVCAN_TRACE_SIZE 256
 
 typedef struct {
 	uint8_t Hour; //24H
@@ -169,19 +268,30 @@ enum {
 };
 
 
+typedef struct {
+	LC_HeaderPacked_t header;
+	uint32_t data[LEVCAN_MAX_FRAME / 4];
+	uint8_t length;
+} lc_msgBuffered;
+
+//length above 8 is CAN FD frame, always one of valid FD data lengths
 typedef LC_Return_t(*HAL_Send_t)(LC_HeaderPacked_t header, uint32_t* data, uint8_t length);
 typedef LC_Return_t(*HAL_Filter_t)(LC_HeaderPacked_t* reg, LC_HeaderPacked_t* mask, uint16_t count);
 typedef LC_Return_t(*HAL_TxHalfFull_t)(void);
+//queues frames in order till buffer is full, returns number of frames taken
+typedef uint16_t(*HAL_SendBatch_t)(const lc_msgBuffered* frames, uint16_t count);
 
 typedef struct {
 	HAL_Send_t Send;
 	HAL_Filter_t Filter;
 	HAL_TxHalfFull_t TxHalfFull;
+	HAL_SendBatch_t SendBatch;	//optional, 0 - frames are sent one by one with Send
 } LC_DriverCalls_t;
 
 typedef struct {
 	LC_NodeShortName_t ShortName;
-	uint32_t LastRXtime;
+	uint32_t LastRX;	//node->Timers tick of last claim
+	lc_timer_t Timer;
 } LC_NodeTableEntry_t;
 
 typedef struct {
@@ -190,12 +300,6 @@ typedef struct {
 	//uint16_t FreeSlots;
 } LC_NodeTable_t;
 
-typedef struct {
-	LC_HeaderPacked_t header;
-	uint32_t data[2];
-	uint8_t length;
-} lc_msgBuffered;
-
 typedef struct {
 	union {
 		char *Pointer;
@@ -207,33 +311,80 @@ typedef struct {
 	};
 	intptr_t *Next;
 	intptr_t *Previous;
+	intptr_t *HashNext;
+	intptr_t *HashPrevious;
 	int32_t Length;
-	int32_t Position;    //get parity - divide by 8 and &1
+	int32_t Position;    //get parity - divide by FrameSize and &1
 	LC_HeaderPacked_t Header;
-	uint16_t Time_since_comm;
+	uint32_t LastComm;	//node->Timers tick of last communication
+	lc_timer_t Timer;
+	intptr_t *ReadyNext;	//TX scheduler queue of its priority
+	uint8_t Ready;		//linked in TX scheduler queue
+	uint8_t Credits;	//frames scheduler allows to send in this call, 0 - single frame
 	uint8_t Attempt;
+	uint8_t FrameSize;	//data bytes per frame on this link
 	union {
 		struct {
 			uint8_t TCP :1;
 			uint8_t TXcleanup :1;
 			uint8_t ReadyToRX :1;
+			uint8_t Segmented :1;	//TX: Pointer is LC_SendMessageV segment list
 			uint8_t ToDelete :1;
 		} Flags;
 		uint8_t FlagsTotal;
 	};
+	//windowed TCP and length announce, Size=0 for parity (stop-and-wait) mode
+	struct {
+		uint16_t Frame;		//TX: first frame of window, RX: next expected frame
+		uint8_t Size;		//frames granted per CTS
+		uint8_t Count;		//TX: frames sent in window, RX: frames received in window
+		uint8_t Acked;		//RX: frames acknowledged by last CTS
+		uint8_t Parity :1;	//toggles with every CTS
+		uint8_t Granted :1;	//TX: receiver accepted announce
+		uint8_t Announce :1;	//TX: UDP transfer starts with length announce
+	} Window;
 } lc_objBuffered;
 
+typedef struct {
+	uint16_t MsgID;
+	uint16_t Start;
+	uint16_t Count;
+} lc_objIndexSlot_t;
+
+typedef struct {
+	uint16_t Object; //system objects first, then node->Objects
+	uint16_t Record; //index in LC_ObjectRecord_t[] for record objects
+} lc_objIndexRef_t;
+
+//MsgID dispatch index of the dictionary, see LC_UpdateObjectIndex
+typedef struct {
+	lc_objIndexSlot_t *Slots;
+	lc_objIndexRef_t *Refs;
+	LC_Object_t *Objects; //dictionary the index was built for
+	uint16_t ObjectsSize;
+	uint16_t SystemSize;
+	uint16_t Mask;
+	uint16_t Users; //lookups in progress, retired index is released by last of them
+	uint8_t Retired; //no longer published
+} lc_objIndex_t;
+
 typedef struct {
 	const void* Driver;
 	const char *NodeName;
 	const char *DeviceName;
 	const char *VendorName;
 	LC_Object_t *Objects;
+	LC_PublishEntry_t *Publish;	//cyclic sending table, see LC_PublishStart
+	const LC_Map_t *Maps;	//small objects packed in one frame, see LC_SendMap
+	LC_MsgStatistics_t *MsgStatistics;	//optional counters of selected MsgIDs, see LC_GetStatistics
 	void *Directories;
 	LC_NodeShortName_t ShortName;
 	uint32_t Serial[4];
 	uint32_t LastTXtime;
 	uint16_t ObjectsSize;
+	uint16_t PublishSize;
+	uint16_t MapsSize;
+	uint16_t MsgStatisticsSize;
 	uint16_t SystemSize;
 	uint16_t DirectoriesSize;
 	uint16_t LastID;
@@ -243,42 +394,93 @@ typedef struct {
 	struct {
 #ifdef LEVCAN_MEM_STATIC
 		lc_objBuffered objectBuffer[LEVCAN_OBJECT_SIZE];
-		int16_t objectBuffer_freeID;
+		lc_objBuffered *objectFree;		//free objects chained by Next
 #endif
 #ifdef LEVCAN_USE_RTOS_QUEUE
 		void *rxQueue;
 #else
 		lc_msgBuffered rxFIFO[LEVCAN_RX_SIZE];
-		volatile uint16_t rxFIFO_in, rxFIFO_out;
+		uint16_t rxFIFO_in, rxFIFO_out;		//free running, written by ISR and receive manager only
+#endif
+		LC_Statistics_t Statistics;
+#ifdef LEVCAN_TRACE_SIZE
+		//binary event ring, see levcan_trace.h
+		LC_TraceRecord_t Trace[LEVCAN_TRACE_SIZE];
+		uint32_t TraceHead;		//free running, records written
 #endif
 		volatile void *objTXbuf_start;
 		volatile void *objTXbuf_end;
 		volatile void *objRXbuf_start;
 		volatile void *objRXbuf_end;
+		//(MsgID, Source, Target) hash buckets of the lists above
+		volatile void *objTXhash[LEVCAN_OBJECT_HASH_SIZE];
+		volatile void *objRXhash[LEVCAN_OBJECT_HASH_SIZE];
+		//TX objects with frames to send, one queue per LC_Priority_t
+		volatile void *txReady_start[LC_Priority_High + 1];
+		volatile void *txReady_end[LC_Priority_High + 1];
+		//pending LC_Request_t chained by Next
+		volatile void *requests;
 	} TxRxObjects;
+	//transfer and node table timeouts, advanced by LC_NetworkManager
+	lc_timerWheel_t Timers;
+#ifdef LEVCAN_CLOCK
+	uint32_t ClockSync;    //LEVCAN_CLOCK reading that matches Timers.Now
+#endif
 	LC_NodeTable_t* NodeTable;
 	void* Extensions;
 	LC_Object_t SystemObjects[LEVCAN_SYS_OBJ_SIZ];
+	lc_objIndex_t *volatile ObjectIndex; //published dispatch index, 0 - linear search
 #ifdef LEVCAN_MEM_STATIC
 	LC_NodeTable_t NodeTableStatic;
 	LC_NodeTableEntry_t NodeTableEntryStatic[LEVCAN_MAX_TABLE_NODES];
+#if LEVCAN_OBJECT_INDEX_SIZE > 0
+	lc_objIndex_t ObjectIndexStatic;
+	lc_objIndexSlot_t ObjectIndexSlotsStatic[LEVCAN_OBJECT_INDEX_SIZE * 2];
+	lc_objIndexRef_t ObjectIndexRefsStatic[LEVCAN_OBJECT_INDEX_SIZE];
+#endif
 #endif
 } LC_NodeDescriptor_t;
 
+//LC_NetworkManagerTickless result, nothing to wait for
+#define LC_NoDeadline UINT32_MAX
+
 typedef void(*LC_FunctionCall_t)(LC_NodeDescriptor_t *node, LC_Header_t header, void *data, int32_t size);
 
+//LC_SendRequestAsync handle, caller memory should stay valid till Callback or LC_CancelRequest
+typedef struct LC_Request_t {
+	//status: LC_Ok - response data, LC_ObjectError - target has no such object (empty response), LC_Timeout.
+	//Called from LC_ReceiveManager or LC_NetworkManager, data is valid during call only
+	void (*Callback)(LC_NodeDescriptor_t *node, struct LC_Request_t *request, LC_Return_t status, uint8_t source, void *data, int32_t size);
+	void *Context; //user data
+	uint16_t MsgID; //private
+	uint8_t Target; //private
+	lc_timer_t Timer; //private
+	struct LC_Request_t *Next; //private
+} LC_Request_t;
+
 LC_EXPORT LC_Return_t LC_InitNodeDescriptor(LC_NodeDescriptor_t *node);
 LC_EXPORT LC_Return_t LC_CreateNode(LC_NodeDescriptor_t *node);
+//Rebuild MsgID dispatch index, call after node->Objects or any object MsgID, Size, attributes changed
+LC_EXPORT LC_Return_t LC_UpdateObjectIndex(LC_NodeDescriptor_t *node);
+//Restart cyclic and change-of-state sending of node->Publish, call after table changed. Not thread safe with LC_NetworkManager
+LC_EXPORT LC_Return_t LC_PublishStart(LC_NodeDescriptor_t *node);
 //Handlers should be called from CAN HAL ISR
 LC_EXPORT void LC_ReceiveHandler(LC_NodeDescriptor_t* node, LC_HeaderPacked_t header, uint32_t *data, uint8_t length);
 
 //Managers should be called from separate tasks, if LEVCAN_USE_RTOS_QUEUE set
 LC_EXPORT void LC_NetworkManager(LC_NodeDescriptor_t* node, uint32_t time); //low priority
+LC_EXPORT uint32_t LC_NetworkManagerTickless(LC_NodeDescriptor_t* node, uint32_t time); //returns time to next call
 LC_EXPORT void LC_ReceiveManager(LC_NodeDescriptor_t* node); //high priority
+LC_EXPORT uint32_t LC_GetReceiveOverflow(LC_NodeDescriptor_t* node);
+LC_EXPORT LC_Return_t LC_GetStatistics(LC_NodeDescriptor_t* node, LC_Statistics_t *stats, LC_MsgStatistics_t *msgStats, uint8_t reset);
 
 LC_EXPORT LC_Return_t LC_SendMessage(LC_NodeDescriptor_t* node, LC_ObjectRecord_t *object, uint16_t index);
+LC_EXPORT LC_Return_t LC_SendMessageV(LC_NodeDescriptor_t* node, LC_ObjectRecord_t *object, const LC_Segment_t *segments, uint8_t count, uint16_t index);
 LC_EXPORT LC_Return_t LC_SendRequest(LC_NodeDescriptor_t* node, uint16_t target, uint16_t index);
 LC_EXPORT LC_Return_t LC_SendRequestSpec(LC_NodeDescriptor_t* node, uint16_t target, uint16_t index, uint8_t size, uint8_t TCP);
+LC_EXPORT LC_Return_t LC_SendRequestAsync(LC_NodeDescriptor_t* node, LC_Request_t *request, uint16_t target, uint16_t index, uint32_t timeout);
+LC_EXPORT LC_Return_t LC_CancelRequest(LC_NodeDescriptor_t* node, LC_Request_t *request);
+LC_EXPORT LC_Return_t LC_SendMap(LC_NodeDescriptor_t* node, uint16_t index, uint8_t target, uint8_t priority);
 
 LC_EXPORT LC_NodeShortName_t LC_GetActiveNodes(LC_NodeDescriptor_t* node, uint16_t *last_pos);
 LC_EXPORT LC_NodeShortName_t LC_GetNode(LC_NodeDescriptor_t* node, uint16_t nodeID);
@@ -4,6 +4,7 @@
 #include "levcan.h"
 #include "levcan_internal.h"
 #include "levcan_address.h"
+#include "levcan_trace.h"
 
 #ifndef LEVCAN_MIN_BYTE_SIZE
 #define LEVCAN_MIN_BYTE_SIZE 1
@@ -15,11 +16,20 @@ int16_t lc_compareNodes(LC_NodeShortName_t a, LC_NodeShortName_t b);
 uint16_t lc_searchIndexCollision(LC_NodeDescriptor_t *node, uint16_t nodeID);
 void lc_claimFreeID(LC_NodeDescriptor_t *node);
 LC_Return_t lc_sendDiscoveryRequest(LC_NodeDescriptor_t *node, uint16_t target);
+void lc_nodeTimeout(void *context, lc_timer_t *timer);
+void lc_nodeSeen(LC_NodeDescriptor_t *node, LC_NodeTableEntry_t *entry);
+uint32_t lc_pingDeadline(LC_NodeDescriptor_t *node, LC_NodeTableEntry_t *entry);
 
 extern LC_Return_t lc_sendDataToQueue(LC_NodeDescriptor_t *node, LC_HeaderPacked_t hdr, uint32_t data[], uint8_t length);
-//### Private variables
-
-LC_RemoteNodeCallback_t lc_addressCallback = 0;
+extern LC_Return_t lc_sendFrame(LC_NodeDescriptor_t *node, LC_HeaderPacked_t header, uint32_t *data, uint8_t length);
+/// Sets function called when remote node is added, changed or deleted from node table
+/// @param node
+/// @param callback
+void LC_SetAddressCallback(LC_NodeDescriptor_t *node, LC_RemoteNodeCallback_t callback) {
+	if (node == 0 || node->Extensions == 0)
+		return;
+	((lc_Extensions_t*) node->Extensions)->addressCallback = callback;
+}
 
 LC_Return_t LC_AddressInit(LC_NodeDescriptor_t *node) {
 	LC_Object_t *initObject = lc_registerSystemObjects(node, 1);
@@ -45,25 +55,34 @@ void LC_AddressManager(LC_NodeDescriptor_t *node, uint32_t time) {
 			//we ready to begin address claim
 			//todo move to claimFreeID
 			uint16_t freeid = node->LastID;
+			uint16_t tries = 0;
 			while (lc_searchIndexCollision(node, freeid)) {
 				freeid++;
 				if (freeid > LC_NodeFreeIDmax || freeid < LC_NodeFreeIDmin)
 					freeid = LC_NodeFreeIDmin;
+				if (++tries > LC_NodeFreeIDmax - LC_NodeFreeIDmin + 1) {
+					//network is full
+					freeid = LC_Null_Address;
+					node->LastID = LC_Null_Address;
+					break;
+				}
 			}
 			node->State = LCNodeState_WaitingClaim;
 			node->LastTXtime = 0;
 			node->ShortName.NodeID = freeid;
 			LC_ConfigureFilters(node);
-			lc_addressClaimHandler(node, node->ShortName, LC_TX);
-#ifdef LEVCAN_TRACE
-			trace_printf("Discovery finish id:%d\n", node->ShortName.NodeID);
-#endif
+			if (freeid != LC_Null_Address) {
+				lc_addressClaimHandler(node, node->ShortName, LC_TX);
+				lc_trace(node, LC_TraceDiscovery, LC_SYS_AddressClaimed, node->ShortName.NodeID, LC_Broadcast_Address, 0);
+			}
 		}
 	} else if (node->ShortName.NodeID == LC_Null_Address) {
-		//we've lost id, get new one
-		//look for free id
-		node->LastTXtime = 0;
-		lc_claimFreeID(node);
+		//we've lost id, get new one. No free id last time, look again after some node could time out
+		node->LastTXtime += time;
+		if (node->LastID != LC_Null_Address || node->LastTXtime > LEVCAN_NODE_TIMEOUT) {
+			node->LastTXtime = 0;
+			lc_claimFreeID(node);
+		}
 	} else if (node->ShortName.NodeID < LC_Broadcast_Address) {
 
 		if (node->State == LCNodeState_WaitingClaim) {
@@ -72,65 +91,83 @@ void LC_AddressManager(LC_NodeDescriptor_t *node, uint32_t time) {
 				node->State = LCNodeState_Online;
 				LC_ConfigureFilters(node);
 				node->LastTXtime = 0;
-#ifdef LEVCAN_TRACE
-				trace_printf("We are online ID:%d\n", node->ShortName.NodeID);
-#endif
+				lc_trace(node, LC_TraceOnline, LC_SYS_AddressClaimed, node->ShortName.NodeID, LC_Broadcast_Address, 0);
 			}
 		} else if (node->State == LCNodeState_Online) {
-#ifdef LEVCAN_TRACE
-			static int alone = 0;
-#endif
 			//we are online! why nobody asking for it?
 			node->LastTXtime += time;
 			if (node->LastTXtime > 2500) {
 				node->LastTXtime = 0;
 				lc_addressClaimHandler(node, node->ShortName, LC_TX);
-#ifdef LEVCAN_TRACE
-				if (alone == 0) {
-					trace_printf("Are we alone?:%d\n", node->ShortName.NodeID);
-				}
-				alone = 3000;
-#endif
-			} else {
-#ifdef LEVCAN_TRACE
-				if (alone) {
-					alone -= time;
-				}
-#endif
+				lc_trace(node, LC_TraceAlone, LC_SYS_AddressClaimed, node->ShortName.NodeID, LC_Broadcast_Address, 0);
 			}
 		}
 	}
+}
 
-#if (LEVCAN_MAX_TABLE_NODES) > 0
-	//now look for dead nodes...
-	static uint32_t offline_tick = 0;
-	const uint16_t off_period = 250;    //0.25s
-	offline_tick += time;
-	if (offline_tick > off_period) {
-		LC_NodeTableEntry_t *node_table = node->NodeTable->Table;
-		for (int i = 0; i < LEVCAN_MAX_TABLE_NODES; i++) {
-			//send every node id
-			if (node_table[i].ShortName.NodeID < LC_Null_Address) {
-				node_table[i].LastRXtime += offline_tick;
-				if (node_table[i].LastRXtime > 1500) {
-					//timeout, delete node
-#ifdef LEVCAN_TRACE
-					trace_printf("Node lost, timeout:%d\n", node_table[i].ShortName.NodeID);
-#endif
-					if (lc_addressCallback) {
-						lc_addressCallback(node_table[i].ShortName, i, LC_AdressDeleted);
-					}
-					node_table[i].ShortName.NodeID = LC_Broadcast_Address;
-				} else if (node_table[i].LastRXtime > 1000) {
-					//ask node, is it online?
-					lc_sendDiscoveryRequest(node, node_table[i].ShortName.NodeID);
-				}
-			}
+/// Returns time until address manager has something to do
+/// @param node
+/// @return Time, ms. LC_NoDeadline if node is disabled
+uint32_t LC_AddressDeadline(LC_NodeDescriptor_t *node) {
+	if (node == 0 || node->State == LCNodeState_Disabled)
+		return LC_NoDeadline;
+	uint32_t period;
+	if (node->State == LCNodeState_NetworkDiscovery)
+		period = 100;
+	else if (node->ShortName.NodeID == LC_Null_Address && node->LastID != LC_Null_Address)
+		return 0;    //claim new id now
+	else if (node->ShortName.NodeID == LC_Null_Address)
+		period = LEVCAN_NODE_TIMEOUT;    //network is full, retry
+	else if (node->ShortName.NodeID < LC_Broadcast_Address && node->State == LCNodeState_WaitingClaim)
+		period = 250;
+	else if (node->ShortName.NodeID < LC_Broadcast_Address && node->State == LCNodeState_Online)
+		period = 2500;
+	else
+		return LC_NoDeadline;
+	if (node->LastTXtime > period)
+		return 0;
+	return period + 1 - node->LastTXtime;
+}
+
+void lc_nodeTimeout(void *context, lc_timer_t *timer) {
+	LC_NodeDescriptor_t *node = context;
+	LC_NodeTableEntry_t *entry = timer->Owner;
+	if (entry->ShortName.NodeID >= LC_Null_Address)
+		return;    //deleted already
+
+	//LastRX may be ahead of Now, stamped by lc_now while manager was sleeping
+	int32_t elapsed = (int32_t) (node->Timers.Now - entry->LastRX);
+	if (elapsed > LEVCAN_NODE_TIMEOUT) {
+		//timeout, delete node
+		lc_trace(node, LC_TraceNodeLost, LC_SYS_AddressClaimed, entry->ShortName.NodeID, node->ShortName.NodeID, elapsed);
+		if (((lc_Extensions_t*) node->Extensions)->addressCallback) {
+			((lc_Extensions_t*) node->Extensions)->addressCallback(entry->ShortName, entry - node->NodeTable->Table, LC_AdressDeleted);
 		}
-		offline_tick = offline_tick % off_period;
-	}
-#endif
+		entry->ShortName.NodeID = LC_Broadcast_Address;
+	} else if (elapsed > LEVCAN_NODE_PING) {
+		//ask node, is it online?
+		lc_sendDiscoveryRequest(node, entry->ShortName.NodeID);
+		lc_timerStart(&node->Timers, timer, 250);
+	} else
+		lc_timerStartAt(&node->Timers, timer, lc_pingDeadline(node, entry));
+}
 
+/// Time to ask silent node. Every node hears same frame and would ping at same tick with exact
+/// tickless timers, own id spreads them so first reply refreshes the rest
+/// @param node
+/// @param entry Remote node
+/// @return Absolute Timers tick
+uint32_t lc_pingDeadline(LC_NodeDescriptor_t *node, LC_NodeTableEntry_t *entry) {
+	return entry->LastRX + LEVCAN_NODE_PING + 1 + (node->ShortName.NodeID & 0x1F);
+}
+
+void lc_nodeSeen(LC_NodeDescriptor_t *node, LC_NodeTableEntry_t *entry) {
+	entry->LastRX = lc_now(node);
+	//running timer checks LastRX and arms itself again
+	if (entry->Timer.Link == 0) {
+		lc_timerStartAt(&node->Timers, &entry->Timer, lc_pingDeadline(node, entry));
+		LC_NetworkManagerWakeup(node);
+	}
 }
 
 void lc_processAddressClaim(LC_NodeDescriptor_t *node, LC_Header_t header, void *data, int32_t size) {
@@ -196,17 +233,14 @@ void lc_addressClaimHandler(LC_NodeDescriptor_t *node, LC_NodeShortName_t claim,
 					node->ShortName.NodeID = LC_Null_Address;
 					node->State = LCNodeState_WaitingClaim;
 					LC_ConfigureFilters(node);
-#ifdef LEVCAN_TRACE
-						trace_printf("Lost ID:%d\n", claim.NodeID);
-#endif
+					LC_NetworkManagerWakeup(node);
+					lc_trace(node, LC_TraceIDLost, LC_SYS_AddressClaimed, claim.NodeID, LC_Broadcast_Address, 0);
 				} else {
 					//send own data to break other nodeName id
 					header.Source = node->ShortName.NodeID;
 					data[0] = node->ShortName.ToUint32[0];
 					data[1] = node->ShortName.ToUint32[1];
-#ifdef LEVCAN_TRACE
-						trace_printf("Collision found ID:%d\n", claim.NodeID);
-#endif
+					lc_trace(node, LC_TraceIDCollision, LC_SYS_AddressClaimed, claim.NodeID, LC_Broadcast_Address, 0);
 				}
 				//break;
 			}
@@ -216,11 +250,9 @@ void lc_addressClaimHandler(LC_NodeDescriptor_t *node, LC_NodeShortName_t claim,
 			for (int i = 0; i < nodeTableSize; i++)
 				if (lc_compareNodes(node_table[i].ShortName, claim) == 0) {
 					//compare by short name, if found - delete this instance
-#ifdef LEVCAN_TRACE
-					trace_printf("Lost S/N:%08X ID:%d\n", claim.SerialNumber, node_table[i].ShortName.NodeID);
-#endif
-					if (lc_addressCallback) {
-						lc_addressCallback(node_table[i].ShortName, i, LC_AdressDeleted);
+					lc_trace(node, LC_TraceSerialLost, LC_SYS_AddressClaimed, node_table[i].ShortName.NodeID, LC_Broadcast_Address, claim.SerialNumber);
+					if (((lc_Extensions_t*) node->Extensions)->addressCallback) {
+						((lc_Extensions_t*) node->Extensions)->addressCallback(node_table[i].ShortName, i, LC_AdressDeleted);
 					}
 
 					node_table[i].ShortName.NodeID = LC_Broadcast_Address;
@@ -243,32 +275,27 @@ void lc_addressClaimHandler(LC_NodeDescriptor_t *node, LC_NodeShortName_t claim,
 					if (eql == 1) {
 						//less value - more priority. our table not less, setup new short name
 						node_table[i].ShortName = claim;
-						node_table[i].LastRXtime = 0;
+						lc_nodeSeen(node, &node_table[i]);
 
-						if (lc_addressCallback) {
-							lc_addressCallback(claim, i, LC_AdressChanged);
+						if (((lc_Extensions_t*) node->Extensions)->addressCallback) {
+							((lc_Extensions_t*) node->Extensions)->addressCallback(claim, i, LC_AdressChanged);
 						}
-#ifdef LEVCAN_TRACE
-						trace_printf("Replaced ID: %d from S/N: 0x%04X to S/N: 0x%04X\n", node_table[i].ShortName.NodeID, node_table[i].ShortName.SerialNumber,
-							claim.SerialNumber);
-#endif
+						lc_trace(node, LC_TraceNodeReplaced, LC_SYS_AddressClaimed, claim.NodeID, LC_Broadcast_Address, claim.SerialNumber);
 					} else if (eql == 0) {
 						//	trace_printf("Claim Update ID: %d\n", node_table[i].ShortName.NodeID);
-						node_table[i].LastRXtime = 0;
+						lc_nodeSeen(node, &node_table[i]);
 					}
 					return; //replaced or not, return anyway. do not add
 				}
 			//we can add new nodeName
 			if (empty != 255) {
 				node_table[empty].ShortName = claim;
-				node_table[empty].LastRXtime = 0;
+				lc_nodeSeen(node, &node_table[empty]);
 
-				if (lc_addressCallback) {
-					lc_addressCallback(claim, empty, LC_AdressNew);
+				if (((lc_Extensions_t*) node->Extensions)->addressCallback) {
+					((lc_Extensions_t*) node->Extensions)->addressCallback(claim, empty, LC_AdressNew);
 				}
-#ifdef LEVCAN_TRACE
-				trace_printf("New node detected ID:%d\n", claim.NodeID);
-#endif
+				lc_trace(node, LC_TraceNodeNew, LC_SYS_AddressClaimed, claim.NodeID, LC_Broadcast_Address, 0);
 			}
 			if (!idlost)
 				return;
@@ -282,7 +309,7 @@ void lc_addressClaimHandler(LC_NodeDescriptor_t *node, LC_NodeShortName_t claim,
 		data[0] = claim.ToUint32[0];
 		data[1] = claim.ToUint32[1];
 	}
-	((LC_DriverCalls_t*) node->Driver)->Send(header, data, 8 / LEVCAN_MIN_BYTE_SIZE);
+	lc_sendFrame(node, header, data, 8 / LEVCAN_MIN_BYTE_SIZE);
 }
 
 void lc_claimFreeID(LC_NodeDescriptor_t *node) {
@@ -293,17 +320,24 @@ void lc_claimFreeID(LC_NodeDescriptor_t *node) {
 	}
 	if (freeid > LC_NodeFreeIDmax)
 		freeid = LC_NodeFreeIDmin;
-	//todo fix endless loop
+	uint16_t tries = 0;
 	while (lc_searchIndexCollision(node, freeid)) {
 		freeid++;
 		if (freeid > LC_NodeFreeIDmax)
 			freeid = LC_NodeFreeIDmin;
+		if (++tries > LC_NodeFreeIDmax - LC_NodeFreeIDmin + 1) {
+			//every free id taken, stay without address till some node times out
+			node->ShortName.NodeID = LC_Null_Address;
+			node->LastID = LC_Null_Address;
+			node->LastTXtime = 0;
+			node->State = LCNodeState_WaitingClaim;
+			LC_ConfigureFilters(node);
+			return;
+		}
 	}
 	node->LastID = freeid;
 	node->ShortName.NodeID = freeid;
-#ifdef LEVCAN_TRACE
-	trace_printf("Trying claim ID:%d\n", freeid);
-#endif
+	lc_trace(node, LC_TraceClaim, LC_SYS_AddressClaimed, freeid, LC_Broadcast_Address, 0);
 	lc_addressClaimHandler(node, node->ShortName, LC_TX);
 	node->LastTXtime = 0;
 	node->State = LCNodeState_WaitingClaim;
@@ -393,5 +427,5 @@ LC_Return_t lc_sendDiscoveryRequest(LC_NodeDescriptor_t *node, uint16_t target)
 	hdr.Source = LC_Broadcast_Address;
 	hdr.Target = target;
 
-	return ((LC_DriverCalls_t*) node->Driver)->Send(hdr, 0, 0);
+	return lc_sendFrame(node, hdr, 0, 0);
 }
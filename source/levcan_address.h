@@ -5,6 +5,7 @@
 
 LC_Return_t LC_AddressInit(LC_NodeDescriptor_t* node);
 void LC_AddressManager(LC_NodeDescriptor_t* node, uint32_t time);
+uint32_t LC_AddressDeadline(LC_NodeDescriptor_t* node);
 LC_EXPORT void LC_ConfigureFilters(LC_NodeDescriptor_t* node);
 
 typedef enum {
@@ -16,4 +17,4 @@ typedef enum {
 
 typedef void(*LC_RemoteNodeCallback_t)(LC_NodeShortName_t shortname, uint16_t index, uint16_t state);
 
-extern LC_RemoteNodeCallback_t lc_addressCallback;
+LC_EXPORT void LC_SetAddressCallback(LC_NodeDescriptor_t* node, LC_RemoteNodeCallback_t callback);
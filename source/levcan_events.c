@@ -9,8 +9,9 @@
 
 #include "levcan_events.h"
 #include "levcan_internal.h"
-#ifndef LC_EVENT_SIZE
-#define LC_EVENT_SIZE 256
+
+#ifndef LEVCAN_EVENTS
+#error "You should define LEVCAN_EVENTS for levcan_events.c!"
 #endif
 
 typedef struct {
@@ -20,9 +21,6 @@ typedef struct {
 	char Text[];
 } eventSend_t;
 
-volatile uint8_t lc_eventButtonPressed = LC_EB_None;
-char lc_event_buffer[LC_EVENT_SIZE];
-
 LC_Return_t lc_sendEventMsg(LC_NodeDescriptor_t *node, uint16_t buffersize, uint8_t receiver);
 
 LC_Return_t LC_EventInit(LC_NodeDescriptor_t *node) {
@@ -33,10 +31,12 @@ LC_Return_t LC_EventInit(LC_NodeDescriptor_t *node) {
 	if (initObject == 0) {
 		return LC_MallocFail;
 	}
-	initObject->Address = (void*) &lc_eventButtonPressed;
+	((lc_Extensions_t*) node->Extensions)->eventButtonPressed = LC_EB_None;
+	initObject->Address = (void*) &((lc_Extensions_t*) node->Extensions)->eventButtonPressed;
 	initObject->Attributes.Writable = 1;
 	initObject->MsgID = LC_SYS_Events;
-	initObject->Size = sizeof(lc_eventButtonPressed);
+	initObject->Size = sizeof(uint8_t);
+	lc_indexSystemObjects(node);
 
 	return LC_Ok;
 }
@@ -45,8 +45,9 @@ LC_EventResult_t LC_EventSend(LC_NodeDescriptor_t *node, const char *text, const
 	if (text == 0 || receiver > LC_Broadcast_Address)
 		return LC_ER_None;
 
-	eventSend_t *evnt = (eventSend_t*) lc_event_buffer;
-	size_t maxtxtsize = sizeof(lc_event_buffer) - sizeof(eventSend_t);
+	lc_Extensions_t *ext = node->Extensions;
+	eventSend_t *evnt = (eventSend_t*) ext->eventBuffer;
+	size_t maxtxtsize = sizeof(ext->eventBuffer) - sizeof(eventSend_t);
 
 	uint32_t texts = strnlen(text, maxtxtsize) + 1;
 	uint32_t caps = 0;
@@ -65,15 +66,16 @@ LC_EventResult_t LC_EventSend(LC_NodeDescriptor_t *node, const char *text, const
 
 	lc_sendEventMsg(node, buffersize, receiver);
 
-	return lc_eventButtonPressed;
+	return ext->eventButtonPressed;
 }
 
 LC_EventResult_t LC_EventSendF(LC_NodeDescriptor_t *node, LC_EventButtons_t buttons, uint8_t receiver, const char *caption, const char *text, ...) {
 	if (text == 0 || receiver > LC_Broadcast_Address)
 		return LC_ER_None;
 
-	eventSend_t *evnt = (eventSend_t*) lc_event_buffer;
-	size_t maxtxtsize = sizeof(lc_event_buffer) - sizeof(eventSend_t);
+	lc_Extensions_t *ext = node->Extensions;
+	eventSend_t *evnt = (eventSend_t*) ext->eventBuffer;
+	size_t maxtxtsize = sizeof(ext->eventBuffer) - sizeof(eventSend_t);
 
 	va_list ap;
 	va_start(ap, text);
@@ -99,7 +101,7 @@ LC_EventResult_t LC_EventSendF(LC_NodeDescriptor_t *node, LC_EventButtons_t butt
 	memcpy(&evnt->Text[texts], caption, caps);
 
 	lc_sendEventMsg(node, buffersize, receiver);
-	return lc_eventButtonPressed;
+	return ext->eventButtonPressed;
 }
 
 LC_Return_t lc_sendEventMsg(LC_NodeDescriptor_t *node, uint16_t buffersize, uint8_t receiver) {
@@ -108,7 +110,7 @@ LC_Return_t lc_sendEventMsg(LC_NodeDescriptor_t *node, uint16_t buffersize, uint
 		receiver = LC_FindEventServer(node, 0).NodeID;
 
 	LC_ObjectRecord_t rec = { 0 };
-	rec.Address = lc_event_buffer;
+	rec.Address = ((lc_Extensions_t*) node->Extensions)->eventBuffer;
 	rec.Size = buffersize;
 	rec.Attributes.TCP = 1;
 	rec.Attributes.Priority = LC_Priority_Low;
@@ -130,7 +132,7 @@ void LC_EventReset(LC_NodeDescriptor_t *node, uint8_t receiver) {
 		rec.NodeID = receiver;
 		LC_SendMessage(node, &rec, LC_SYS_Events);
 	}
-	lc_eventButtonPressed = LC_EB_None;
+	((lc_Extensions_t*) node->Extensions)->eventButtonPressed = LC_EB_None;
 }
 /// Returns event server short name
 /// @param scnt Pointer to stored position for search, can be null
@@ -11,26 +11,17 @@
 #include "levcan_filedef.h"
 #include "levcan_internal.h"
 
-#ifndef LEVCAN_FILE_DATASIZE
-				#define LEVCAN_FILE_DATASIZE LEVCAN_OBJECT_DATASIZE
-				#endif
-
 #if LEVCAN_OBJECT_DATASIZE < 16
 				#error "Too small LEVCAN_OBJECT_DATASIZE size for file io!"
 				#endif
 //extern functions
 //private functions
 LC_FileResult_t lc_client_sendwait(LC_NodeDescriptor_t *node, void *data, uint16_t size, fOpAck_t *askOut);
+LC_FileResult_t lc_client_sendwaitV(LC_NodeDescriptor_t *node, const LC_Segment_t *segments, uint8_t count, fOpAck_t *askOut);
 void processReceivedData(volatile fRead_t *rxtoread, fOpData_t *opdata, int32_t rsize);
 #ifndef LEVCAN_USE_RTOS_QUEUE
 void proceedFileClient(LC_NodeDescriptor_t *node, LC_Header_t header, void *data, int32_t size);
 #endif
-//private variables
-#ifdef LEVCAN_BUFFER_FILEPRINTF
-char lc_printf_buffer[LEVCAN_FILE_DATASIZE - sizeof(fOpData_t)];
-uint32_t lc_printf_size = 0;
-#endif
-
 LC_Return_t LC_FileClientInit(LC_NodeDescriptor_t *node) {
 #ifdef LEVCAN_FILECLIENT
 	//File client
@@ -60,6 +51,7 @@ LC_Return_t LC_FileClientInit(LC_NodeDescriptor_t *node) {
 	initObject->Size = -LEVCAN_FILE_DATASIZE;      //anysize
 
 #endif
+	lc_indexSystemObjects(node);
 #endif
 	((lc_Extensions_t*) node->Extensions)->fnode = LC_Broadcast_Address;
 	((lc_Extensions_t*) node->Extensions)->fpos = 0;
@@ -276,12 +268,14 @@ LC_FileResult_t LC_FileWrite(LC_NodeDescriptor_t *node, const char *buffer, uint
 	uint32_t bufsize = LEVCAN_FILE_DATASIZE - sizeof(fOpData_t);
 	if (btw < bufsize)
 		bufsize = btw;
-	//careful with memory allocation
+#ifdef LEVCAN_MEM_STATIC
+	//segment list may not fit in static object data, careful with memory allocation
 	char writedata[bufsize + sizeof(fOpData_t)];
+#endif
 	//reset
 	*bw = 0;
-	fOpData_t *writef = (fOpData_t*) &writedata;
-	writef->Operation = fOpData;
+	fOpData_t writef = { 0 };
+	writef.Operation = fOpData;
 
 	for (uint32_t position = 0; position < btw;) {
 		uint32_t towritenow = btw - position;
@@ -290,13 +284,20 @@ LC_FileResult_t LC_FileWrite(LC_NodeDescriptor_t *node, const char *buffer, uint
 		if (towritenow > LEVCAN_FILE_DATASIZE - sizeof(fOpData_t))
 			towritenow = LEVCAN_FILE_DATASIZE - sizeof(fOpData_t);
 
+		writef.Position = globalpos;
+		writef.TotalBytes = towritenow;
+#ifdef LEVCAN_MEM_STATIC
 		//copy data to fOpData_t
-		writef->Position = globalpos;
-		writef->TotalBytes = towritenow;
-		memcpy(&writef->Data[0], &buffer[position], towritenow);
-		//setup packet size
+		memcpy(writedata, &writef, offsetof(fOpData_t, Data));
+		memcpy(&writedata[offsetof(fOpData_t, Data)], &buffer[position], towritenow);
+		LC_Segment_t segments[] = { { writedata, sizeof(fOpData_t) + towritenow } };
+#else
+		//header from stack, data straight from user buffer, struct padding ends message
+		LC_Segment_t segments[] = { { &writef, offsetof(fOpData_t, Data) }, { &buffer[position], towritenow }, {
+				&writef.Data[0], sizeof(fOpData_t) - offsetof(fOpData_t, Data) } };
+#endif
 		fOpAck_t ask_result = { 0 };
-		ret = lc_client_sendwait(node, writef, sizeof(fOpData_t) + towritenow, &ask_result);
+		ret = lc_client_sendwaitV(node, segments, sizeof(segments) / sizeof(segments[0]), &ask_result);
 
 		if (ask_result.Operation == fOpAck) {
 			//rxtoread->Position is bytes written
@@ -322,37 +323,40 @@ LC_FileResult_t LC_FileWrite(LC_NodeDescriptor_t *node, const char *buffer, uint
 /// @param sender_node Own network node
 /// @return LC_FileResult_t
 LC_FileResult_t LC_FilePrintf(LC_NodeDescriptor_t *node, const char *format, ...) {
+	lc_Extensions_t *ext = node->Extensions;
 	va_list ap;
 	va_start(ap, format);
-	static char buf[(LEVCAN_FILE_DATASIZE > 256) ? 256 : LEVCAN_FILE_DATASIZE];
+	char *buf = ext->printfFormat;
 
 	LC_FileResult_t result = 0;
 	uint32_t size = 0;
-	// Print to the local buffer
-	size = vsnprintf(buf, sizeof(buf), format, ap);
+	// Print to the node buffer
+	size = vsnprintf(buf, sizeof(ext->printfFormat), format, ap);
+	if (size >= sizeof(ext->printfFormat))
+		size = sizeof(ext->printfFormat) - 1;    //truncated
 #ifdef LEVCAN_BUFFER_FILEPRINTF
 	char *bufref = buf;
 	uint32_t copysize = 0;
 	uint32_t maxsize = 0;
 	do {
 		//send only full buffer
-		if (lc_printf_size == sizeof(lc_printf_buffer)) {
-			result = LC_FileWrite(node, lc_printf_buffer, lc_printf_size, &lc_printf_size);
-			lc_printf_size = 0;
+		if (ext->printfSize == sizeof(ext->printfBuffer)) {
+			result = LC_FileWrite(node, ext->printfBuffer, ext->printfSize, &ext->printfSize);
+			ext->printfSize = 0;
 		}
 		//fill buffer
 		if (size > 0) {
-			maxsize = sizeof(lc_printf_buffer) - lc_printf_size;
+			maxsize = sizeof(ext->printfBuffer) - ext->printfSize;
 			if (size > maxsize)
 				copysize = maxsize;
 			else
 				copysize = size;
-			memcpy(&lc_printf_buffer[lc_printf_size], bufref, copysize);
-			lc_printf_size += copysize;
+			memcpy(&ext->printfBuffer[ext->printfSize], bufref, copysize);
+			ext->printfSize += copysize;
 			size -= copysize;
 			bufref += copysize;
 		}
-	} while (lc_printf_size == sizeof(lc_printf_buffer));
+	} while (ext->printfSize == sizeof(ext->printfBuffer));
 #else
 	if (size > 0) {
 		// Transfer the buffer to the server
@@ -365,12 +369,13 @@ LC_FileResult_t LC_FilePrintf(LC_NodeDescriptor_t *node, const char *format, ...
 
 #ifdef LEVCAN_BUFFER_FILEPRINTF
 LC_FileResult_t LC_FilePrintFlush(LC_NodeDescriptor_t *node) {
+	lc_Extensions_t *ext = node->Extensions;
 	LC_FileResult_t res = 0;
 	uint32_t size = 0;
 
-	if (lc_printf_size > 0)
-		res = LC_FileWrite(node, lc_printf_buffer, lc_printf_size, &size);
-	lc_printf_size = 0;
+	if (ext->printfSize > 0)
+		res = LC_FileWrite(node, ext->printfBuffer, ext->printfSize, &size);
+	ext->printfSize = 0;
 	return res;
 }
 #endif
@@ -493,6 +498,11 @@ LC_NodeShortName_t LC_FindFileServer(LC_NodeDescriptor_t *node, uint16_t *scnt)
 }
 
 LC_FileResult_t lc_client_sendwait(LC_NodeDescriptor_t *node, void *data, uint16_t size, fOpAck_t *askOut) {
+	LC_Segment_t segment = { data, size };
+	return lc_client_sendwaitV(node, &segment, 1, askOut);
+}
+
+LC_FileResult_t lc_client_sendwaitV(LC_NodeDescriptor_t *node, const LC_Segment_t *segments, uint8_t count, fOpAck_t *askOut) {
 	LC_NodeShortName_t server;
 
 	if (node == 0 || node->Extensions == 0
@@ -517,8 +527,8 @@ LC_FileResult_t lc_client_sendwait(LC_NodeDescriptor_t *node, void *data, uint16
 		return LC_FR_NodeOffline;
 	//prepare message
 	LC_ObjectRecord_t rec = { 0 };
-	rec.Address = data;
-	rec.Size = size;
+	rec.Address = (void*) segments[0].Data;
+	rec.Size = segments[0].Size;
 	rec.Attributes.TCP = 1;
 	rec.Attributes.Priority = LC_Priority_Low;
 	rec.NodeID = server.NodeID;
@@ -527,7 +537,12 @@ LC_FileResult_t lc_client_sendwait(LC_NodeDescriptor_t *node, void *data, uint16
 #ifdef LEVCAN_USE_RTOS_QUEUE
 		LC_QueueReset(((lc_Extensions_t* ) node->Extensions)->frxQueue);
 #endif
-		LC_Return_t sr = LC_SendMessage(node, &rec, LC_SYS_FileClient);
+		LC_Return_t sr;
+		//single buffer doesn't need segment list
+		if (count == 1)
+			sr = LC_SendMessage(node, &rec, LC_SYS_FileClient);
+		else
+			sr = LC_SendMessageV(node, &rec, segments, count, LC_SYS_FileClient);
 		//send error?
 		if (sr) {
 			if (sr == LC_BufferFull)
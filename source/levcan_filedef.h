@@ -88,3 +88,14 @@ typedef struct {
 	uint16_t Error;
 } fRead_t;
 
+//file server request, queued till LC_FileServer call
+typedef struct {
+	uint16_t Operation;
+	uint16_t Size;
+	union {
+		uint32_t Position;
+		LC_FileAccess_t Mode;
+	};
+	uint8_t NodeID;
+	char *Data;
+} fOpDataAdress_t;
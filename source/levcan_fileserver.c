@@ -8,6 +8,7 @@
 
 #include "levcan.h"
 #include "levcan_internal.h"
+#include "levcan_slab.h"
 #include "levcan_fileclient.h"
 #include "levcan_fileserver.h"
 #include "levcan_filedef.h"
@@ -17,50 +18,37 @@
 #error "You should define lcmalloc, lcfree for levcan_fileserver.c!"
 #endif
 
-typedef struct {
-	uint16_t Operation;
-	uint16_t Size;
-	union {
-		uint32_t Position;
-		LC_FileAccess_t Mode;
-	};
-	uint8_t NodeID;
-	char *Data;
-} fOpDataAdress_t;
-
 typedef struct {
 	void *FileObject;
-	uint16_t Timeout;
+	uint32_t LastAccess;	//fsTimers second
+	lc_timer_t Timer;
 	uint16_t LastError;
 	uint8_t NodeID;
 	void *Next;
 	void *Previous;
 } fSrvObj;
 
+#ifndef LEVCAN_FILESERVER
+#error "You should define LEVCAN_FILESERVER for levcan_fileserver.c!"
+#endif
+
 //private functions
-fSrvObj* findFile(uint8_t source);
+fSrvObj* findFile(LC_NodeDescriptor_t *node, uint8_t source);
 LC_FileResult_t sendAck(LC_NodeDescriptor_t *node, uint32_t position, uint16_t error, uint8_t receiver);
-LC_FileResult_t deleteFSObject(fSrvObj *obj);
-
-//server request fifo
-fOpDataAdress_t fsFIFO[LEVCAN_MAX_TABLE_NODES];
-volatile uint16_t fsFIFO_in, fsFIFO_out;
-
-//server stored open files
-volatile fSrvObj *file_start;
-volatile fSrvObj *file_end;
-volatile int initFS = 0;
+LC_FileResult_t deleteFSObject(LC_NodeDescriptor_t *node, fSrvObj *obj);
+void fileTimeout(void *context, lc_timer_t *timer);
 
 void proceedFileServer(LC_NodeDescriptor_t *node, LC_Header_t header, void *data, int32_t size) {
-	if (size < 2 || initFS == 0)
+	lc_Extensions_t *ext = node->Extensions;
+	if (size < 2 || ext->fsInit == 0)
 		return;
 	uint16_t *op = data;
 	uint16_t gotfifo = 0;
-	if (fsFIFO_in == ((fsFIFO_out - 1 + LEVCAN_MAX_TABLE_NODES) % LEVCAN_MAX_TABLE_NODES)) {
+	if (ext->fsFIFO_in == ((ext->fsFIFO_out - 1 + LEVCAN_MAX_TABLE_NODES) % LEVCAN_MAX_TABLE_NODES)) {
 		sendAck(node, 0, LC_FR_MemoryFull, header.Source);
 		return; //buffer full
 	}
-	fOpDataAdress_t *fsinput = &fsFIFO[fsFIFO_in];
+	fOpDataAdress_t *fsinput = &ext->fsFIFO[ext->fsFIFO_in];
 
 	//fill in data
 	switch (*op) {
@@ -139,7 +127,7 @@ void proceedFileServer(LC_NodeDescriptor_t *node, LC_Header_t header, void *data
 	if (gotfifo) {
 		fsinput->Operation = *op;
 		fsinput->NodeID = header.Source;
-		fsFIFO_in = (fsFIFO_in + 1) % LEVCAN_MAX_TABLE_NODES;
+		ext->fsFIFO_in = (ext->fsFIFO_in + 1) % LEVCAN_MAX_TABLE_NODES;
 		//send request to process messages.
 		//make your own implementation of LC_FileServerOnReceive to use semaphore for main file process
 		//this should speed-up communication
@@ -167,28 +155,32 @@ LC_Return_t LC_FileServerInit(LC_NodeDescriptor_t *node) {
 	initObject->Attributes.TCP = 1;
 	initObject->MsgID = LC_SYS_FileClient;		//get client requests
 	initObject->Size = INT32_MIN;		//anysize
+	lc_indexSystemObjects(node);
 
 	node->ShortName.FileServer = 1;
 	return LC_Ok;
 }
 
 LC_Return_t LC_FileServer(LC_NodeDescriptor_t *node, uint32_t tick) {
-	if (initFS == 0) {
-		fsFIFO_in = 0;
-		fsFIFO_out = 0;
-		memset(fsFIFO, 0, sizeof(fsFIFO));
-		file_start = 0;
-		file_end = 0;
-		initFS = 1;
-	}
-	if (node == 0 || node->Driver == 0)
+	if (node == 0 || node->Driver == 0 || node->Extensions == 0)
 		return LC_DataError;
+	lc_Extensions_t *ext = node->Extensions;
+	if (ext->fsInit == 0) {
+		ext->fsFIFO_in = 0;
+		ext->fsFIFO_out = 0;
+		memset(ext->fsFIFO, 0, sizeof(ext->fsFIFO));
+		ext->fileStart = 0;
+		ext->fileEnd = 0;
+		lc_timerInit(&ext->fsTimers);
+		ext->fsTimersMs = 0;
+		ext->fsInit = 1;
+	}
 	if (node->State != LCNodeState_Online)
 		return LC_NodeOffline;
 
-	for (; fsFIFO_in != fsFIFO_out; fsFIFO_out = (fsFIFO_out + 1) % LEVCAN_MAX_TABLE_NODES) {
+	for (; ext->fsFIFO_in != ext->fsFIFO_out; ext->fsFIFO_out = (ext->fsFIFO_out + 1) % LEVCAN_MAX_TABLE_NODES) {
 		//proceed FS FIFO
-		fOpDataAdress_t *fsinput = &fsFIFO[fsFIFO_out];
+		fOpDataAdress_t *fsinput = &ext->fsFIFO[ext->fsFIFO_out];
 		LC_ObjectRecord_t rec = { 0 };
 		rec.NodeID = fsinput->NodeID;
 		rec.Attributes.TCP = 1;
@@ -196,7 +188,7 @@ LC_Return_t LC_FileServer(LC_NodeDescriptor_t *node, uint32_t tick) {
 
 		switch (fsinput->Operation) {
 		case fOpOpen: {
-			if (findFile(fsinput->NodeID)) {
+			if (findFile(node, fsinput->NodeID)) {
 				//free name
 				lcfree(fsinput->Data);
 				fsinput->Data = 0;
@@ -222,20 +214,22 @@ LC_Return_t LC_FileServer(LC_NodeDescriptor_t *node, uint32_t tick) {
 					fileNode->FileObject = file;
 					fileNode->LastError = res;
 					fileNode->NodeID = fsinput->NodeID;
-					fileNode->Timeout = 0;
+					fileNode->LastAccess = ext->fsTimers.Now;
+					lc_timerSetup(&fileNode->Timer, fileTimeout, fileNode);
+					lc_timerStartAt(&ext->fsTimers, &fileNode->Timer, fileNode->LastAccess + 60 * 5 + 1);
 					//put in array
-					if (file_start == 0) {
+					if (ext->fileStart == 0) {
 						//no objects in tx array
 						fileNode->Previous = 0;
 						fileNode->Next = 0;
-						file_start = fileNode;
-						file_end = fileNode;
+						ext->fileStart = fileNode;
+						ext->fileEnd = fileNode;
 					} else {
 						//add to the end
-						fileNode->Previous = (intptr_t*) file_end;
+						fileNode->Previous = ext->fileEnd;
 						fileNode->Next = 0;
-						file_end->Next = (intptr_t*) fileNode;
-						file_end = fileNode;
+						((fSrvObj*) ext->fileEnd)->Next = (intptr_t*) fileNode;
+						ext->fileEnd = fileNode;
 					}
 					//done!
 				}
@@ -246,10 +240,10 @@ LC_Return_t LC_FileServer(LC_NodeDescriptor_t *node, uint32_t tick) {
 		}
 			break;
 		case fOpRead: {
-			fSrvObj *fileNode = findFile(fsinput->NodeID);
+			fSrvObj *fileNode = findFile(node, fsinput->NodeID);
 			//do we have opened/created file for this node?
 			if (fileNode) {
-				fileNode->Timeout = 0;
+				fileNode->LastAccess = ext->fsTimers.Now;
 				//get current position
 				uint32_t filepos = lcftell(fileNode->FileObject);
 				LC_FileResult_t result = 0;
@@ -267,33 +261,35 @@ LC_Return_t LC_FileServer(LC_NodeDescriptor_t *node, uint32_t tick) {
 				if (fsinput->Position != filepos)
 					btr = 0; //pointer not moved
 
-				fOpData_t *buffer = lcmalloc(sizeof(fOpData_t) + btr);
+				char *buffer = lc_slabAlloc(btr);
 				if (buffer == 0) {
 					sendAck(node, 0, LC_FR_MemoryFull, fsinput->NodeID); //file error
 					continue;
 				}
-				buffer->Operation = fOpData;
-				result = lcfread(fileNode->FileObject, &buffer->Data[0], btr, &btr);
-				buffer->Error = result;
-				buffer->Position = filepos;
-				buffer->TotalBytes = btr;
-				//send
-				rec.Address = buffer;
-				rec.Size = sizeof(fOpData_t) + btr;
+				result = lcfread(fileNode->FileObject, buffer, btr, &btr);
+				fOpData_t head = { 0 };
+				head.Operation = fOpData;
+				head.Error = result;
+				head.Position = filepos;
+				head.TotalBytes = btr;
+				//send header from stack, file data goes without copy, struct padding ends message
+				LC_Segment_t segments[] = { { &head, offsetof(fOpData_t, Data) }, { buffer, btr }, { &head.Data[0], sizeof(fOpData_t)
+						- offsetof(fOpData_t, Data) } };
 				rec.Attributes.Cleanup = 1;
 
-				if (LC_SendMessage(node, &rec, LC_SYS_FileServer))
-					lcfree(buffer);
+				//short data is copied to segment list, not freed by transfer
+				if (LC_SendMessageV(node, &rec, segments, sizeof(segments) / sizeof(segments[0]), LC_SYS_FileServer) || btr <= LEVCAN_SEGMENT_INLINE)
+					lc_slabFree(buffer);
 			} else {
 				sendAck(node, 0, LC_FR_FileNotOpened, fsinput->NodeID);
 			}
 		}
 			break;
 		case fOpData: {
-			fSrvObj *fileNode = findFile(fsinput->NodeID);
+			fSrvObj *fileNode = findFile(node, fsinput->NodeID);
 			//do we have opened/created file for this node?
 			if (fileNode) {
-				fileNode->Timeout = 0;
+				fileNode->LastAccess = ext->fsTimers.Now;
 
 				if (fsinput->Size == 0) {
 					sendAck(node, 0, LC_FR_NetworkError, fsinput->NodeID);
@@ -329,18 +325,18 @@ LC_Return_t LC_FileServer(LC_NodeDescriptor_t *node, uint32_t tick) {
 		}
 			break;
 		case fOpClose: {
-			fSrvObj *fileNode = findFile(fsinput->NodeID);
+			fSrvObj *fileNode = findFile(node, fsinput->NodeID);
 			//do we have opened file for this node?
 			LC_FileResult_t rslt = LC_FR_Ok;
 			if (fileNode) {
-				rslt = deleteFSObject(fileNode);
+				rslt = deleteFSObject(node, fileNode);
 			} else
 				rslt = LC_FR_FileNotOpened;
 			sendAck(node, 0, rslt, fsinput->NodeID);
 		}
 			break;
 		case fOpLseek: {
-			fSrvObj *fileNode = findFile(fsinput->NodeID);
+			fSrvObj *fileNode = findFile(node, fsinput->NodeID);
 			//do we have opened file for this node?
 			LC_FileResult_t rslt = LC_FR_Denied;
 			uint32_t filepos = 0;
@@ -353,7 +349,7 @@ LC_Return_t LC_FileServer(LC_NodeDescriptor_t *node, uint32_t tick) {
 		}
 			break;
 		case fOpAckSize: {
-			fSrvObj *fileNode = findFile(fsinput->NodeID);
+			fSrvObj *fileNode = findFile(node, fsinput->NodeID);
 			//do we have opened file for this node?
 			LC_FileResult_t rslt = LC_FR_Ok;
 			uint32_t filesize = 0;
@@ -365,7 +361,7 @@ LC_Return_t LC_FileServer(LC_NodeDescriptor_t *node, uint32_t tick) {
 		}
 			break;
 		case fOpTruncate: {
-			fSrvObj *fileNode = findFile(fsinput->NodeID);
+			fSrvObj *fileNode = findFile(node, fsinput->NodeID);
 			//do we have opened file for this node?
 			LC_FileResult_t rslt = LC_FR_Ok;
 			if (fileNode) {
@@ -377,23 +373,31 @@ LC_Return_t LC_FileServer(LC_NodeDescriptor_t *node, uint32_t tick) {
 			break;
 		}
 	}
-	static uint16_t timesec = 0;
-	timesec += tick;
-	if (timesec >= 1000) {
-		timesec -= 1000;
-		fSrvObj *next;
-		for (fSrvObj *obj = (fSrvObj*) file_start; obj != 0; obj = next) {
-			next = (fSrvObj*) obj->Next;
-			obj->Timeout++;
-			//5 minute delete
-			if (obj->Timeout > 60 * 5)
-				deleteFSObject(obj);
-		}
+	ext->fsTimersMs += tick;
+	if (ext->fsTimersMs >= 1000) {
+		lc_timerAdvance(&ext->fsTimers, ext->fsTimersMs / 1000, node);
+		ext->fsTimersMs %= 1000;
 	}
 
 	return LC_Ok;
 }
 
+/// Returns time until LC_FileServer has something to do: queued request or open file timeout.
+/// Not part of LC_NetworkManagerTickless result, task running file server with network manager takes the minimum
+/// @param node Pointer to node descriptor
+/// @return Time, ms. LC_NoDeadline if there are no open files
+uint32_t LC_FileServerDeadline(LC_NodeDescriptor_t *node) {
+	if (node == 0 || node->Extensions == 0)
+		return LC_NoDeadline;
+	lc_Extensions_t *ext = node->Extensions;
+	if (ext->fsInit == 0 || ext->fsFIFO_in != ext->fsFIFO_out)
+		return 0;
+	uint32_t next = lc_timerNext(&ext->fsTimers);
+	if (next == LC_TIMER_IDLE)
+		return LC_NoDeadline;
+	return next * 1000 - ext->fsTimersMs;
+}
+
 LC_FileResult_t sendAck(LC_NodeDescriptor_t *node, uint32_t position, uint16_t error, uint8_t receiver) {
 	LC_ObjectRecord_t rec = { 0 };
 	rec.NodeID = receiver;
@@ -419,7 +423,7 @@ LC_FileResult_t sendAck(LC_NodeDescriptor_t *node, uint32_t position, uint16_t e
 		LC_SendMessage(node, &rec, LC_SYS_FileServer);
 		return LC_FR_Ok;
 	}
-	fOpAck_t *ack = lcmalloc(sizeof(fOpAck_t));
+	fOpAck_t *ack = lc_slabAlloc(sizeof(fOpAck_t));
 	if (ack == 0) {
 		//can't do anything, memory fail
 		rec.Address = (void*) &fask_mem_out;
@@ -436,12 +440,12 @@ LC_FileResult_t sendAck(LC_NodeDescriptor_t *node, uint32_t position, uint16_t e
 	rec.Size = sizeof(fOpAck_t);
 	rec.Attributes.Cleanup = 1;
 	if (LC_SendMessage(node, &rec, LC_SYS_FileServer))
-		lcfree(ack); //can't send, clean now
+		lc_slabFree(ack); //can't send, clean now
 	return LC_FR_Ok;
 }
 
-fSrvObj* findFile(uint8_t source) {
-	fSrvObj *obj = (fSrvObj*) file_start;
+fSrvObj* findFile(LC_NodeDescriptor_t *node, uint8_t source) {
+	fSrvObj *obj = ((lc_Extensions_t*) node->Extensions)->fileStart;
 	while (obj) {
 		//search file for specified nodeID
 		if (obj->NodeID == source) {
@@ -452,30 +456,43 @@ fSrvObj* findFile(uint8_t source) {
 	return 0;
 }
 
-LC_FileResult_t deleteFSObject(fSrvObj *obj) {
+void fileTimeout(void *context, lc_timer_t *timer) {
+	LC_NodeDescriptor_t *node = context;
+	lc_Extensions_t *ext = node->Extensions;
+	fSrvObj *obj = timer->Owner;
+	//5 minute delete
+	if (ext->fsTimers.Now - obj->LastAccess > 60 * 5)
+		deleteFSObject(node, obj);
+	else
+		lc_timerStartAt(&ext->fsTimers, timer, obj->LastAccess + 60 * 5 + 1);
+}
+
+LC_FileResult_t deleteFSObject(LC_NodeDescriptor_t *node, fSrvObj *obj) {
+	lc_Extensions_t *ext = node->Extensions;
+	lc_timerStop(&ext->fsTimers, &obj->Timer);
 	if (obj->Previous)
 		((fSrvObj*) obj->Previous)->Next = obj->Next; //junction
 	else {
 #ifdef LEVCAN_TRACE
-		if (file_start != obj) {
+		if (ext->fileStart != obj) {
 			trace_printf("Start object error\n");
 		}
 #endif
-		file_start = (fSrvObj*) obj->Next; //Starting
-		if (file_start != 0)
-			file_start->Previous = 0;
+		ext->fileStart = obj->Next; //Starting
+		if (ext->fileStart != 0)
+			((fSrvObj*) ext->fileStart)->Previous = 0;
 	}
 	if (obj->Next) {
 		((fSrvObj*) obj->Next)->Previous = obj->Previous;
 	} else {
 #ifdef LEVCAN_TRACE
-		if (file_end != obj) {
+		if (ext->fileEnd != obj) {
 			trace_printf("End object error\n");
 		}
 #endif
-		file_end = (fSrvObj*) obj->Previous; //ending
-		if (file_end != 0)
-			file_end->Next = 0;
+		ext->fileEnd = obj->Previous; //ending
+		if (ext->fileEnd != 0)
+			((fSrvObj*) ext->fileEnd)->Next = 0;
 	}
 
 	LC_FileResult_t resul = lcfclose(obj->FileObject);
@@ -7,3 +7,4 @@
 
 LC_EXPORT LC_Return_t LC_FileServerInit(LC_NodeDescriptor_t* node);
 LC_EXPORT LC_Return_t LC_FileServer(LC_NodeDescriptor_t* node, uint32_t tick);
+LC_EXPORT uint32_t LC_FileServerDeadline(LC_NodeDescriptor_t* node);
@@ -5,9 +5,20 @@
 
 #include "levcan_filedef.h"
 #include "levcan_paramserver.h"
+#include "levcan_paraminternal.h"
+#include "levcan_address.h"
+
+#ifndef LC_EVENT_SIZE
+#define LC_EVENT_SIZE 256
+#endif
+
+#ifndef LEVCAN_FILE_DATASIZE
+#define LEVCAN_FILE_DATASIZE LEVCAN_OBJECT_DATASIZE
+#endif
 
 
 typedef struct {
+	LC_RemoteNodeCallback_t addressCallback;
 #ifdef LEVCAN_PARAMETERS_CLIENT
 	void *paramClientQueue;
 	LC_ObjectRecord_t paramClientRecord;
@@ -15,6 +26,9 @@ typedef struct {
 #ifdef LEVCAN_PARAMETERS_SERVER
 	uint8_t paramServerLastAccessNodeId;
 	lc_param_callback_t paramCallback;
+#ifdef LEVCAN_MEM_STATIC
+	lc_entry_data_t paramEntryData;
+#endif
 #endif
 #ifdef LEVCAN_FILECLIENT
 	uint8_t fnode;
@@ -25,6 +39,27 @@ typedef struct {
 #else
 	volatile fOpAck_t rxack;
 #endif
+	char printfFormat[(LEVCAN_FILE_DATASIZE > 256) ? 256 : LEVCAN_FILE_DATASIZE];
+#ifdef LEVCAN_BUFFER_FILEPRINTF
+	char printfBuffer[LEVCAN_FILE_DATASIZE - sizeof(fOpData_t)];
+	uint32_t printfSize;
+#endif
+#endif
+#ifdef LEVCAN_FILESERVER
+	//server request fifo
+	fOpDataAdress_t fsFIFO[LEVCAN_MAX_TABLE_NODES];
+	volatile uint16_t fsFIFO_in, fsFIFO_out;
+	//server stored open files
+	void *volatile fileStart;
+	void *volatile fileEnd;
+	//open file timeouts, one tick per second
+	lc_timerWheel_t fsTimers;
+	uint32_t fsTimersMs;
+	volatile uint8_t fsInit;
+#endif
+#ifdef LEVCAN_EVENTS
+	volatile uint8_t eventButtonPressed;
+	uint32_t eventBuffer[(LC_EVENT_SIZE + 3) / 4];
 #endif
 } lc_Extensions_t;
 
@@ -37,9 +72,74 @@ extern lc_Extensions_t lc_ExtensionsStatic[LEVCAN_MAX_OWN_NODES];
 #endif
 
 extern LC_Object_t* lc_registerSystemObjects(LC_NodeDescriptor_t *node, uint8_t count);
+extern void lc_indexSystemObjects(LC_NodeDescriptor_t *node);
 
 
 #define LEVCAN_COMM_TIMEOUT 100
 //message should be 3x time more than communication
 #define LEVCAN_MESSAGE_TIMEOUT 350
 #define LEVCAN_NODE_TIMEOUT 1500
+//silent node is asked for its address after
+#define LEVCAN_NODE_PING 1000
+
+//Called when new TX or timeout work appears outside of network manager, wake up task sleeping after LC_NetworkManagerTickless.
+//Frames after the first one of a transfer are sent by network manager only, periodic manager without this hook
+//sends them at its call rate
+#ifndef LC_NetworkManagerWakeup
+#define LC_NetworkManagerWakeup(node)
+#endif
+//Optional free running ms counter, same time source as given to network manager. Required for LC_NetworkManagerTickless:
+//received frames and new transfers are time stamped while manager sleeps, see lc_now
+//#define LEVCAN_CLOCK() xTaskGetTickCount()
+
+extern uint32_t lc_now(LC_NodeDescriptor_t *node);
+
+//Largest received transfer, announced or grown while receiving. Static memory is limited by LEVCAN_OBJECT_DATASIZE
+#ifndef LEVCAN_RX_MAXSIZE
+#define LEVCAN_RX_MAXSIZE 0x10000
+#endif
+
+//Messages taken from RX FIFO at once by receive manager
+#ifndef LEVCAN_RX_BURST
+#define LEVCAN_RX_BURST 8
+#endif
+
+//RX FIFO index ordering between CAN ISR and receive manager, override for non-GCC compilers
+#ifndef lc_load_acquire
+#define lc_load_acquire(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define lc_store_release(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#endif
+//Trace ring slot reservation and counters shared with CAN ISR, override for non-GCC compilers or cores without atomics
+#ifndef lc_fetch_inc
+#define lc_fetch_inc(ptr) __atomic_fetch_add(ptr, 1, __ATOMIC_RELAXED)
+#endif
+
+//TX scheduler frames per round for each LC_Priority_t: Low, Mid, Control, High
+#ifndef LEVCAN_TX_QUANTUM
+#define LEVCAN_TX_QUANTUM { 4, 8, 16, 32 }
+#endif
+
+//Frames prepared at once for driver SendBatch, taken from stack
+#ifndef LEVCAN_TX_BATCH
+#define LEVCAN_TX_BATCH 8
+#endif
+
+//Maximum frames sent per CTS in windowed TCP mode (1-8), 0 - use only parity mode
+#ifndef LEVCAN_TCP_WINDOW
+#define LEVCAN_TCP_WINDOW 8
+#endif
+//credits are granted in CTS data length code
+#if LEVCAN_TCP_WINDOW > 8
+#error "LEVCAN_TCP_WINDOW is limited to 8 frames"
+#endif
+
+//LC_SendMessageV segments up to this size are copied, so they can be taken from stack
+#ifndef LEVCAN_SEGMENT_INLINE
+#define LEVCAN_SEGMENT_INLINE 16
+#endif
+
+//LC_SendMessageV transfer: segment list followed by copies of short segments
+typedef struct {
+	uint8_t Count;
+	LC_Segment_t Segment[];
+} lc_txSegments_t;
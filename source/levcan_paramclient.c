@@ -3,6 +3,7 @@
 
 #include "levcan.h"
 #include "levcan_internal.h"
+#include "levcan_slab.h"
 #include "levcan_paramclient.h"
 #include "levcan_paraminternal.h"
 #include <string.h>
@@ -47,6 +48,7 @@ LC_Return_t LCP_ParameterClientInit(LC_NodeDescriptor_t *node) {
 		initObject[objID].Size = 1;
 	}
 	((lc_Extensions_t*) node->Extensions)->paramClientQueue = clientQueue;
+	lc_indexSystemObjects(node);
 	return LC_Ok;
 }
 
@@ -267,7 +269,7 @@ static LC_Return_t requestData(LC_NodeDescriptor_t *node, uint8_t from_node, uin
 LC_Return_t LCP_SetValue(LC_NodeDescriptor_t *node, uint8_t remote_node, uint16_t directory_index, uint16_t entry_index, intptr_t *value, uint16_t valueSize) {
 	LC_ObjectRecord_t sendReq = { .NodeID = remote_node, .Attributes.Priority = LC_Priority_Low, .Attributes.TCP = 1 };
 	uint32_t sizeValSet = sizeof(lc_value_set_t) + valueSize;
-	lc_value_set_t *valSet = lcmalloc(sizeValSet);
+	lc_value_set_t *valSet = lc_slabAlloc(sizeValSet);
 	if (valSet == 0)
 		return LC_MallocFail;
 	if (value == 0 || valueSize > LEVCAN_PARAM_MAX_TEXTSIZE + LEVCAN_PARAM_MAX_NAMESIZE)
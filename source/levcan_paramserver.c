@@ -11,6 +11,7 @@
 #include "levcan_paraminternal.h"
 #include "levcan_paramcommon.h"
 #include "levcan_internal.h"
+#include "levcan_slab.h"
 
 #ifndef LEVCAN_PARAMETERS_SERVER
 #error "Define LEVCAN_PARAMETERS_SERVER in \"levcan_config.h\"!"
@@ -42,6 +43,7 @@ LC_Return_t LCP_ParameterServerInit(LC_NodeDescriptor_t *node, lc_param_callback
 	initObject->Attributes.TCP = 1;
 	initObject->MsgID = LC_SYS_ParametersRequest;
 	initObject->Size = -LEVCAN_FILE_DATASIZE; //up to size
+	lc_indexSystemObjects(node);
 	((lc_Extensions_t*) node->Extensions)->paramServerLastAccessNodeId = LC_Broadcast_Address;
 	((lc_Extensions_t*) node->Extensions)->paramCallback = callback;
 	node->ShortName.Configurable = 1;
@@ -127,13 +129,11 @@ void lc_proceedParameterRequest(LC_NodeDescriptor_t *node, LC_Header_t header, v
 						char *name = (void*) extractEntryName(directories, dirsize, entry);
 
 						if (request.Command & lcp_reqData) {
-							//todo fix static
 #ifdef LEVCAN_MEM_STATIC
-							static lc_entry_data_t entrydataStatic;
-							lc_entry_data_t* entrydata = &entrydataStatic;
+							lc_entry_data_t *entrydata = &((lc_Extensions_t*) node->Extensions)->paramEntryData;
 #else //dynamic mem
 							lc_entry_data_t *entrydata = 0;
-							entrydata = lcmalloc(sizeof(lc_entry_data_t));
+							entrydata = lc_slabAlloc(sizeof(lc_entry_data_t));
 							if (entrydata == 0) {
 								status = LC_MallocFail;
 								break;
@@ -0,0 +1,126 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include "levcan.h"
+#include "levcan_slab.h"
+
+#include "string.h"
+
+#ifndef LEVCAN_MEM_STATIC
+#if	defined(lcmalloc) && defined(lcfree)
+#else
+#error "You should define lcmalloc, lcfree for levcan_slab.c!"
+#endif
+
+//block size keeps 8 byte alignment
+#define slabRound(size) (((size) + 7) & ~7)
+#define slabObjectSize slabRound(sizeof(lc_objBuffered))
+#define slabArenaSize (slabObjectSize * LEVCAN_SLAB_OBJECTS + 64 * LEVCAN_SLAB_64 + 256 * LEVCAN_SLAB_256 + 512 * LEVCAN_SLAB_512)
+
+typedef struct {
+	char *Start;
+	void *Free;		//released blocks, next pointer stored in block
+	uint16_t Bump;	//blocks never used before
+	LC_SlabStats_t Stats;
+} lc_slabClass_t;
+
+//### Private functions ###
+lc_slabClass_t* lc_slabClass(const void *ptr);
+
+//### Private variables
+static uint64_t slabArena[slabArenaSize / 8 + 1];
+static lc_slabClass_t slabClasses[LC_SlabClasses] = {
+	{ .Start = (char*) slabArena, .Stats = { .Size = slabObjectSize, .Blocks = LEVCAN_SLAB_OBJECTS } },
+	{ .Start = (char*) slabArena + slabObjectSize * LEVCAN_SLAB_OBJECTS, .Stats = { .Size = 64, .Blocks = LEVCAN_SLAB_64 } },
+	{ .Start = (char*) slabArena + slabObjectSize * LEVCAN_SLAB_OBJECTS + 64 * LEVCAN_SLAB_64, .Stats = { .Size = 256, .Blocks = LEVCAN_SLAB_256 } },
+	{ .Start = (char*) slabArena + slabObjectSize * LEVCAN_SLAB_OBJECTS + 64 * LEVCAN_SLAB_64 + 256 * LEVCAN_SLAB_256, .Stats = { .Size = 512, .Blocks = LEVCAN_SLAB_512 } },
+};
+
+void* lc_slabAlloc(uint32_t size) {
+	lc_slabClass_t *fit = 0, *from = 0;
+	void *block = 0;
+
+	lc_disable_irq();
+	for (int i = 0; i < LC_SlabClasses; i++) {
+		lc_slabClass_t *cls = &slabClasses[i];
+		if (cls->Stats.Blocks == 0 || cls->Stats.Size < size)
+			continue;
+		//smallest fitting class counts fallbacks
+		if (fit == 0 || cls->Stats.Size < fit->Stats.Size)
+			fit = cls;
+		//smallest fitting class with free block serves, larger ones take over when pool is empty
+		if ((cls->Free || cls->Bump < cls->Stats.Blocks) && (from == 0 || cls->Stats.Size < from->Stats.Size))
+			from = cls;
+	}
+	if (from) {
+		if (from->Free) {
+			block = from->Free;
+			from->Free = *(void**) block;
+		} else
+			block = &from->Start[from->Stats.Size * from->Bump++];
+		from->Stats.Used++;
+		from->Stats.Allocs++;
+		if (from->Stats.Used > from->Stats.Peak)
+			from->Stats.Peak = from->Stats.Used;
+	} else if (fit)
+		fit->Stats.Fallbacks++;
+	lc_enable_irq();
+
+	if (block == 0)
+		block = lcmalloc(size);
+	return block;
+}
+
+void lc_slabFree(void *ptr) {
+	if (ptr == 0)
+		return;
+	lc_slabClass_t *cls = lc_slabClass(ptr);
+	if (cls == 0) {
+		lcfree(ptr);
+		return;
+	}
+	lc_disable_irq();
+	*(void**) ptr = cls->Free;
+	cls->Free = ptr;
+	cls->Stats.Used--;
+	lc_enable_irq();
+}
+
+uint8_t lc_slabOwns(const void *ptr) {
+	return lc_slabClass(ptr) != 0;
+}
+
+lc_slabClass_t* lc_slabClass(const void *ptr) {
+	const char *p = ptr;
+	if (p < (char*) slabArena || p >= (char*) slabArena + slabArenaSize)
+		return 0;
+	for (int i = LC_SlabClasses - 1; i >= 0; i--)
+		if (p >= slabClasses[i].Start && slabClasses[i].Stats.Blocks)
+			return &slabClasses[i];
+	return 0;
+}
+
+/// Copies allocator statistics for every slab class
+/// @param stats Array of LC_SlabClasses entries
+/// @return LC_Ok or LC_DataError
+LC_Return_t LC_GetSlabStats(LC_SlabStats_t stats[LC_SlabClasses]) {
+	if (stats == 0)
+		return LC_DataError;
+	lc_disable_irq();
+	for (int i = 0; i < LC_SlabClasses; i++)
+		stats[i] = slabClasses[i].Stats;
+	lc_enable_irq();
+	return LC_Ok;
+}
+
+/// Clears counters and peak usage, pools stay untouched
+void LC_ResetSlabStats(void) {
+	lc_disable_irq();
+	for (int i = 0; i < LC_SlabClasses; i++) {
+		slabClasses[i].Stats.Peak = slabClasses[i].Stats.Used;
+		slabClasses[i].Stats.Allocs = 0;
+		slabClasses[i].Stats.Fallbacks = 0;
+	}
+	lc_enable_irq();
+}
+#endif
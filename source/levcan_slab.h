@@ -0,0 +1,48 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include "levcan.h"
+#include "levcan_config.h"
+
+#pragma once
+
+//Dynamic memory: blocks per slab class, 0 - class disabled, served by lcmalloc
+#ifndef LEVCAN_SLAB_OBJECTS
+#define LEVCAN_SLAB_OBJECTS 0
+#endif
+#ifndef LEVCAN_SLAB_64
+#define LEVCAN_SLAB_64 0
+#endif
+#ifndef LEVCAN_SLAB_256
+#define LEVCAN_SLAB_256 0
+#endif
+#ifndef LEVCAN_SLAB_512
+#define LEVCAN_SLAB_512 0
+#endif
+
+enum {
+	LC_SlabObjects, LC_Slab64, LC_Slab256, LC_Slab512, LC_SlabClasses
+};
+
+typedef struct {
+	uint16_t Size;		//block size
+	uint16_t Blocks;	//blocks in pool
+	uint16_t Used;		//blocks allocated now
+	uint16_t Peak;		//maximum blocks allocated at once
+	uint32_t Allocs;	//allocations served from pool
+	uint32_t Fallbacks;	//allocations of this class served by lcmalloc, pool was empty
+} LC_SlabStats_t;
+
+#ifdef LEVCAN_MEM_STATIC
+//no pools for static memory, modules with own heap use it directly
+#define lc_slabAlloc(size) lcmalloc(size)
+#define lc_slabFree(ptr) lcfree(ptr)
+#define lc_slabOwns(ptr) 0
+#else
+void* lc_slabAlloc(uint32_t size);
+void lc_slabFree(void *ptr);
+uint8_t lc_slabOwns(const void *ptr);
+
+LC_EXPORT LC_Return_t LC_GetSlabStats(LC_SlabStats_t stats[LC_SlabClasses]);
+LC_EXPORT void LC_ResetSlabStats(void);
+#endif
@@ -0,0 +1,147 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include "levcan.h"
+#include "levcan_timer.h"
+
+#include "string.h"
+
+#define slotMask (LC_TIMER_SLOTS - 1)
+
+//### Private functions ###
+void lc_timerLink(lc_timerWheel_t *wheel, lc_timer_t *timer);
+void lc_timerUnlink(lc_timer_t *timer);
+
+void lc_timerInit(lc_timerWheel_t *wheel) {
+	memset(wheel, 0, sizeof(lc_timerWheel_t));
+}
+
+void lc_timerSetup(lc_timer_t *timer, void (*callback)(void *context, lc_timer_t *timer), void *owner) {
+	timer->Next = 0;
+	timer->Link = 0;
+	timer->Expires = 0;
+	timer->Callback = callback;
+	timer->Owner = owner;
+}
+
+/// Starts or restarts timer, callback will be called after delay ticks (at least one)
+void lc_timerStart(lc_timerWheel_t *wheel, lc_timer_t *timer, uint32_t delay) {
+	lc_disable_irq();
+	lc_timerUnlink(timer);
+	timer->Expires = wheel->Now + ((delay) ? delay : 1);
+	lc_timerLink(wheel, timer);
+	lc_enable_irq();
+}
+
+/// Starts or restarts timer at absolute tick, past ticks expire on next tick
+void lc_timerStartAt(lc_timerWheel_t *wheel, lc_timer_t *timer, uint32_t expires) {
+	lc_disable_irq();
+	lc_timerUnlink(timer);
+	if ((int32_t) (expires - wheel->Now) <= 0)
+		expires = wheel->Now + 1;
+	timer->Expires = expires;
+	lc_timerLink(wheel, timer);
+	lc_enable_irq();
+}
+
+void lc_timerStop(lc_timerWheel_t *wheel, lc_timer_t *timer) {
+	(void) wheel;
+	lc_disable_irq();
+	lc_timerUnlink(timer);
+	lc_enable_irq();
+}
+
+/// Moves wheel time forward and calls expired timers, cost depends on expired timers only
+/// @param wheel
+/// @param time Ticks passed
+/// @param context Passed to callbacks
+void lc_timerAdvance(lc_timerWheel_t *wheel, uint32_t time, void *context) {
+	while (time--) {
+		lc_disable_irq();
+		uint32_t now = ++wheel->Now;
+		if ((now & slotMask) == 0) {
+			//next level slot comes down to the first level
+			lc_timer_t *timer = wheel->Slots[1][(now >> LEVCAN_TIMER_BITS) & slotMask];
+			wheel->Slots[1][(now >> LEVCAN_TIMER_BITS) & slotMask] = 0;
+			while (timer) {
+				lc_timer_t *next = timer->Next;
+				lc_timerLink(wheel, timer);
+				timer = next;
+			}
+		}
+		lc_enable_irq();
+
+		lc_timer_t **slot = &wheel->Slots[0][now & slotMask];
+		for (;;) {
+			lc_disable_irq();
+			lc_timer_t *timer = *slot;
+			if (timer)
+				lc_timerUnlink(timer);
+			lc_enable_irq();
+			if (timer == 0)
+				break;
+			//callback may start this timer again or free it
+			timer->Callback(context, timer);
+		}
+	}
+}
+
+/// Returns ticks until wheel should be advanced next time: nearest first level timer or next level cascade
+/// @param wheel
+/// @return Ticks to wait, LC_TIMER_IDLE if there are no timers
+uint32_t lc_timerNext(lc_timerWheel_t *wheel) {
+	uint32_t next = LC_TIMER_IDLE;
+	lc_disable_irq();
+	uint32_t now = wheel->Now;
+	for (uint32_t i = 1; i <= LC_TIMER_SLOTS; i++) {
+		if (wheel->Slots[0][(now + i) & slotMask]) {
+			next = i;
+			break;
+		}
+	}
+	//second level timers are not sorted, wake up on cascade
+	uint32_t block = now >> LEVCAN_TIMER_BITS;
+	for (uint32_t i = 1; i <= LC_TIMER_SLOTS; i++) {
+		if (wheel->Slots[1][(block + i) & slotMask]) {
+			uint32_t cascade = ((block + i) << LEVCAN_TIMER_BITS) - now;
+			if (cascade < next)
+				next = cascade;
+			break;
+		}
+	}
+	lc_enable_irq();
+	return next;
+}
+
+void lc_timerLink(lc_timerWheel_t *wheel, lc_timer_t *timer) {
+	uint32_t delta = timer->Expires - wheel->Now;
+	lc_timer_t **slot;
+
+	if ((int32_t) delta < 0) {
+		//already expired, next tick
+		timer->Expires = wheel->Now + 1;
+		delta = 1;
+	}
+	//delta 0 only from cascade, current slot is processed right after it
+	if (delta < LC_TIMER_SLOTS)
+		slot = &wheel->Slots[0][timer->Expires & slotMask];
+	else if (delta < LC_TIMER_SLOTS * LC_TIMER_SLOTS)
+		slot = &wheel->Slots[1][(timer->Expires >> LEVCAN_TIMER_BITS) & slotMask];
+	else
+		slot = &wheel->Slots[1][((wheel->Now >> LEVCAN_TIMER_BITS) + slotMask) & slotMask];    //farthest slot, placed again on cascade
+	timer->Next = *slot;
+	if (timer->Next)
+		timer->Next->Link = &timer->Next;
+	timer->Link = slot;
+	*slot = timer;
+}
+
+void lc_timerUnlink(lc_timer_t *timer) {
+	if (timer->Link == 0)
+		return;
+	*timer->Link = timer->Next;
+	if (timer->Next)
+		timer->Next->Link = timer->Link;
+	timer->Next = 0;
+	timer->Link = 0;
+}
@@ -0,0 +1,36 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include "stdint.h"
+
+#pragma once
+
+//Timer wheel slots per level (power of two exponent). Two levels cover 1 << (2 * bits) ticks, longer timers cascade again
+#ifndef LEVCAN_TIMER_BITS
+#define LEVCAN_TIMER_BITS 5
+#endif
+
+#define LC_TIMER_SLOTS (1 << LEVCAN_TIMER_BITS)
+//lc_timerNext result for empty wheel
+#define LC_TIMER_IDLE UINT32_MAX
+
+typedef struct lc_timer_t {
+	struct lc_timer_t *Next;
+	struct lc_timer_t **Link;	//pointer that refers to this timer, 0 - stopped
+	uint32_t Expires;			//absolute tick
+	void (*Callback)(void *context, struct lc_timer_t *timer);
+	void *Owner;
+} lc_timer_t;
+
+typedef struct {
+	lc_timer_t *Slots[2][LC_TIMER_SLOTS];
+	uint32_t Now;
+} lc_timerWheel_t;
+
+void lc_timerInit(lc_timerWheel_t *wheel);
+void lc_timerSetup(lc_timer_t *timer, void (*callback)(void *context, lc_timer_t *timer), void *owner);
+void lc_timerStart(lc_timerWheel_t *wheel, lc_timer_t *timer, uint32_t delay);
+void lc_timerStartAt(lc_timerWheel_t *wheel, lc_timer_t *timer, uint32_t expires);
+void lc_timerStop(lc_timerWheel_t *wheel, lc_timer_t *timer);
+void lc_timerAdvance(lc_timerWheel_t *wheel, uint32_t time, void *context);
+uint32_t lc_timerNext(lc_timerWheel_t *wheel);
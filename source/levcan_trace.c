@@ -0,0 +1,97 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include "levcan.h"
+#include "levcan_internal.h"
+#include "levcan_trace.h"
+
+#ifdef LEVCAN_TRACE_SIZE
+#if (LEVCAN_TRACE_SIZE & (LEVCAN_TRACE_SIZE - 1)) || LEVCAN_TRACE_SIZE < 2
+#error "LEVCAN_TRACE_SIZE should be power of two"
+#endif
+
+//records written to file at once
+#define traceChunk 8
+
+/// Stores event in node trace ring, safe from any context. Oldest record is overwritten
+/// @param node
+/// @param event LC_TraceEvent_t
+/// @param msgID
+/// @param source
+/// @param target
+/// @param position Transfer position or event argument
+void lc_traceEvent(LC_NodeDescriptor_t *node, uint8_t event, uint16_t msgID, uint8_t source, uint8_t target, int32_t position) {
+	//each producer owns reserved slot, no lock needed
+	uint32_t head = lc_fetch_inc(&node->TxRxObjects.TraceHead);
+	LC_TraceRecord_t *record = &node->TxRxObjects.Trace[head & (LEVCAN_TRACE_SIZE - 1)];
+	record->Time = LEVCAN_TRACE_TIME(node);
+	record->Position = position;
+	record->MsgID = msgID;
+	record->Event = event;
+	record->Source = source;
+	record->Target = target;
+}
+
+/// Copies latest trace records, oldest first. Tracing is not stopped, records written meanwhile could be torn
+/// @param node
+/// @param buffer Records destination
+/// @param max Buffer size in records
+/// @param lost Optional, records written but not copied
+/// @return Records copied
+uint32_t LC_TraceRead(LC_NodeDescriptor_t *node, LC_TraceRecord_t *buffer, uint32_t max, uint32_t *lost) {
+	if (node == 0 || buffer == 0)
+		return 0;
+	uint32_t head = lc_load_acquire(&node->TxRxObjects.TraceHead);
+	uint32_t count = (head < LEVCAN_TRACE_SIZE) ? head : LEVCAN_TRACE_SIZE;
+	if (count > max)
+		count = max;
+	for (uint32_t i = 0, pos = head - count; i < count; i++, pos++)
+		buffer[i] = node->TxRxObjects.Trace[pos & (LEVCAN_TRACE_SIZE - 1)];
+	if (lost)
+		*lost = head - count;
+	return count;
+}
+
+#ifdef LEVCAN_FILECLIENT
+/// Writes trace ring to file server: LC_TraceFileHeader_t and records, oldest first
+/// @param node
+/// @param name File name
+/// @param server_node File server ID
+/// @return LC_FileResult_t
+LC_FileResult_t LC_TraceDump(LC_NodeDescriptor_t *node, char *name, uint8_t server_node) {
+	if (node == 0 || name == 0)
+		return LC_FR_InvalidParameter;
+	uint32_t head = lc_load_acquire(&node->TxRxObjects.TraceHead);
+	uint32_t count = (head < LEVCAN_TRACE_SIZE) ? head : LEVCAN_TRACE_SIZE;
+	LC_TraceFileHeader_t header = { .Magic = { 'L', 'C', 'T', 'R' }, .Version = LC_TraceVersion, .RecordSize = sizeof(LC_TraceRecord_t), .Count = count,
+		.Lost = head - count };
+
+	LC_FileResult_t result = LC_FileOpen(node, name, LC_FA_Write | LC_FA_CreateAlways, server_node);
+	if (result != LC_FR_Ok)
+		return result;
+	uint32_t written;
+	result = LC_FileWrite(node, (char*) &header, sizeof(header), &written);
+	//file transfer is slow, copy small chunks to keep stack low
+	LC_TraceRecord_t chunk[traceChunk];
+	for (uint32_t pos = head - count; result == LC_FR_Ok && pos != head;) {
+		uint32_t n = 0;
+		for (; n < traceChunk && pos != head; n++, pos++)
+			chunk[n] = node->TxRxObjects.Trace[pos & (LEVCAN_TRACE_SIZE - 1)];
+		result = LC_FileWrite(node, (char*) chunk, n * sizeof(LC_TraceRecord_t), &written);
+	}
+	LC_FileResult_t closed = LC_FileClose(node, server_node);
+	if (result == LC_FR_Ok)
+		result = closed;
+	return result;
+}
+#endif
+
+#elif defined(LEVCAN_TRACE)
+//text fallback, same order as LC_TraceEvent_t
+const char *const lc_traceNames[LC_TraceEvents] = {
+	"TX start", "TX done", "TX timeout", "TX attempts", "TX rejected", "TX length mismatch", "TX rollback", "TX retransmit", "TX collision",
+	"RX start", "RX done", "RX timeout", "RX overflow", "RX memory", "RX no object", "RX dual request", "RX unknown", "List error",
+	"Discovery finish", "Online", "Alone", "Node lost", "ID lost", "ID collision", "S/N lost", "Replaced", "New node", "Claim",
+	"Request timeout",
+};
+#endif
@@ -0,0 +1,76 @@
+//  SPDX-FileCopyrightText: 2023 Nucular Limited
+//  SPDX-License-Identifier: Apache-2.0
+
+#include "levcan.h"
+#include "levcan_config.h"
+#include "levcan_fileclient.h"
+
+#pragma once
+
+//Binary event tracer. LEVCAN_TRACE_SIZE (power of two) enables per-node ring of LC_TraceRecord_t,
+//without it LEVCAN_TRACE prints events using trace_printf. Ring is decoded offline by tools/levcan_trace.py
+
+//Record timestamp, cycle counter could be used for precise timing
+#ifndef LEVCAN_TRACE_TIME
+#define LEVCAN_TRACE_TIME(node) ((node)->Timers.Now)
+#endif
+
+//Event identifiers are stored in dumps, append only
+typedef enum {
+	LC_TraceTXStart, //Position - transfer size
+	LC_TraceTXDone,
+	LC_TraceTXTimeout, //Position - sent bytes
+	LC_TraceTXAttempts,
+	LC_TraceTXRejected,
+	LC_TraceTXLength, //Position - sent bytes, receiver got different length
+	LC_TraceTXRollback, //Position - new position
+	LC_TraceTXRetransmit,
+	LC_TraceTXCollision,
+	LC_TraceRXStart, //Position - announced size, 0 - unknown
+	LC_TraceRXDone, //Position - received size
+	LC_TraceRXTimeout, //Position - received bytes
+	LC_TraceRXOverflow, //RX FIFO full, frame lost
+	LC_TraceRXMemory, //Position - received bytes, object didn't fit memory
+	LC_TraceRXNoObject, //Position - received size
+	LC_TraceRXDualRequest,
+	LC_TraceRXUnknown,
+	LC_TraceListError, //Position - 0 start, 1 end, 2 free list
+	LC_TraceDiscovery, //Source - chosen ID
+	LC_TraceOnline,
+	LC_TraceAlone,
+	LC_TraceNodeLost,
+	LC_TraceIDLost,
+	LC_TraceIDCollision,
+	LC_TraceSerialLost, //Position - serial number
+	LC_TraceNodeReplaced, //Position - new serial number
+	LC_TraceNodeNew,
+	LC_TraceClaim,
+	LC_TraceRequestTimeout,
+	LC_TraceEvents,
+} LC_TraceEvent_t;
+
+//Dump file header, records follow oldest first. Little endian
+typedef struct {
+	char Magic[4]; //"LCTR"
+	uint16_t Version;
+	uint16_t RecordSize;
+	uint32_t Count;
+	uint32_t Lost; //records overwritten before dump
+} LC_TraceFileHeader_t;
+
+#define LC_TraceVersion 1
+
+#ifdef LEVCAN_TRACE_SIZE
+void lc_traceEvent(LC_NodeDescriptor_t *node, uint8_t event, uint16_t msgID, uint8_t source, uint8_t target, int32_t position);
+#define lc_trace(node, event, msgID, source, target, position) lc_traceEvent(node, event, msgID, source, target, position)
+
+LC_EXPORT uint32_t LC_TraceRead(LC_NodeDescriptor_t *node, LC_TraceRecord_t *buffer, uint32_t max, uint32_t *lost);
+#ifdef LEVCAN_FILECLIENT
+LC_EXPORT LC_FileResult_t LC_TraceDump(LC_NodeDescriptor_t *node, char *name, uint8_t server_node);
+#endif
+#elif defined(LEVCAN_TRACE)
+extern const char *const lc_traceNames[LC_TraceEvents];
+#define lc_trace(node, event, msgID, source, target, position) trace_printf("%s msg:%d %d>%d pos:%ld\n", lc_traceNames[event], (int) (msgID), (int) (source), (int) (target), (long) (position))
+#else
+#define lc_trace(...) do {} while (0)
+#endif
@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+#  SPDX-FileCopyrightText: 2023 Nucular Limited
+#  SPDX-License-Identifier: Apache-2.0
+"""Decodes LEVCAN binary trace written by LC_TraceDump (or raw LC_TraceRecord_t array with --raw)."""
+
+import argparse
+import struct
+import sys
+
+# same order as LC_TraceEvent_t in source/levcan_trace.h
+EVENTS = [
+    "TX start", "TX done", "TX timeout", "TX attempts", "TX rejected", "TX length mismatch", "TX rollback", "TX retransmit", "TX collision",
+    "RX start", "RX done", "RX timeout", "RX overflow", "RX memory", "RX no object", "RX dual request", "RX unknown", "List error",
+    "Discovery finish", "Online", "Alone", "Node lost", "ID lost", "ID collision", "S/N lost", "Replaced", "New node", "Claim",
+    "Request timeout",
+]
+
+HEADER = struct.Struct("<4sHHII")  # LC_TraceFileHeader_t
+RECORD = struct.Struct("<IiHBBB3x")  # LC_TraceRecord_t
+
+
+def decode(data, raw):
+    lost = 0
+    if not raw:
+        magic, version, size, count, lost = HEADER.unpack_from(data)
+        if magic != b"LCTR":
+            raise ValueError("not a LEVCAN trace dump")
+        if version != 1 or size != RECORD.size:
+            raise ValueError("unsupported trace version %d, record size %d" % (version, size))
+        data = data[HEADER.size:HEADER.size + count * size]
+    records = [RECORD.unpack_from(data, offset) for offset in range(0, len(data) - RECORD.size + 1, RECORD.size)]
+    return records, lost
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("file", help="trace dump, - for stdin")
+    parser.add_argument("--raw", action="store_true", help="records only, no file header")
+    parser.add_argument("--delta", action="store_true", help="print time since previous record")
+    args = parser.parse_args()
+
+    stream = sys.stdin.buffer if args.file == "-" else open(args.file, "rb")
+    with stream:
+        records, lost = decode(stream.read(), args.raw)
+    if lost:
+        print("# %d older records overwritten" % lost)
+    previous = None
+    for time, position, msgid, event, source, target in records:
+        name = EVENTS[event] if event < len(EVENTS) else "event %d" % event
+        stamp = time - previous if args.delta and previous is not None else time
+        previous = time
+        print("%10u  %-18s msg:0x%03X %3d>%-3d pos:%d" % (stamp & 0xFFFFFFFF, name, msgid, source, target, position))
+
+
+if __name__ == "__main__":
+    main()